@@ -0,0 +1,139 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       AllocationCounter.cpp
+
+    \brief
+    Counting replacement of the global operator new and delete, used to
+    check that the haptic tick does not touch the heap.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "AllocationCounter.h"
+//---------------------------------------------------------------------------
+#include <stdlib.h>
+#include <new>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// counting state of each thread; plain thread-local data, so counting
+// itself never allocates, locks or slows down the other threads
+static thread_local bool countingEnabled = false;
+static thread_local cAllocationCount threadCount = { 0, 0, 0 };
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// allocate from malloc, counting if enabled on this thread
+static void* countedAllocate(size_t a_size);
+
+// release to free, counting if enabled on this thread
+static void countedRelease(void* a_pointer);
+
+
+//===========================================================================
+/*
+    Start or stop counting on the calling thread.
+*/
+//===========================================================================
+
+void setAllocationCounting(bool a_enabled)
+{
+    countingEnabled = a_enabled;
+}
+
+
+//===========================================================================
+/*
+    Heap operations counted on the calling thread.
+*/
+//===========================================================================
+
+cAllocationCount getAllocationCount(void)
+{
+    return (threadCount);
+}
+
+//---------------------------------------------------------------------------
+
+static void* countedAllocate(size_t a_size)
+{
+    if (countingEnabled)
+    {
+        threadCount.m_numAllocations++;
+        threadCount.m_numBytes += a_size;
+    }
+
+    void* pointer = malloc((a_size > 0) ? a_size : 1);
+    if (pointer == NULL) { throw std::bad_alloc(); }
+    return (pointer);
+}
+
+//---------------------------------------------------------------------------
+
+static void countedRelease(void* a_pointer)
+{
+    if (a_pointer == NULL) { return; }
+
+    if (countingEnabled)
+    {
+        threadCount.m_numDeallocations++;
+    }
+    free(a_pointer);
+}
+
+
+//===========================================================================
+/*
+    Replacements of the global allocation functions.
+*/
+//===========================================================================
+
+void* operator new(size_t a_size)
+{
+    return (countedAllocate(a_size));
+}
+
+void* operator new[](size_t a_size)
+{
+    return (countedAllocate(a_size));
+}
+
+void* operator new(size_t a_size, const std::nothrow_t&) throw()
+{
+    try { return (countedAllocate(a_size)); }
+    catch (...) { return (NULL); }
+}
+
+void* operator new[](size_t a_size, const std::nothrow_t&) throw()
+{
+    try { return (countedAllocate(a_size)); }
+    catch (...) { return (NULL); }
+}
+
+void operator delete(void* a_pointer) throw()
+{
+    countedRelease(a_pointer);
+}
+
+void operator delete[](void* a_pointer) throw()
+{
+    countedRelease(a_pointer);
+}
+
+void operator delete(void* a_pointer, const std::nothrow_t&) throw()
+{
+    countedRelease(a_pointer);
+}
+
+void operator delete[](void* a_pointer, const std::nothrow_t&) throw()
+{
+    countedRelease(a_pointer);
+}
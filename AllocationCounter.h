@@ -0,0 +1,52 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       AllocationCounter.h
+
+    \brief
+    Counting replacement of the global operator new and delete, used to
+    check that the haptic tick does not touch the heap.
+
+    Linking AllocationCounter.cpp into an executable replaces the global
+    allocation functions of that executable; only the benchmark does.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef AllocationCounterH
+#define AllocationCounterH
+//---------------------------------------------------------------------------
+#include <stddef.h>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// heap operations of the calling thread while counting was enabled
+struct cAllocationCount
+{
+    // calls to operator new / new[], and the bytes they requested
+    unsigned long m_numAllocations;
+    size_t m_numBytes;
+
+    // calls to operator delete / delete[] with a non-NULL pointer
+    unsigned long m_numDeallocations;
+};
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// start or stop counting the heap operations of the calling thread; other
+// threads are never counted
+void setAllocationCounting(bool a_enabled);
+
+// heap operations counted on the calling thread so far
+cAllocationCount getAllocationCount(void);
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
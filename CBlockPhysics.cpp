@@ -0,0 +1,694 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CBlockPhysics.cpp
+
+    \brief
+    Fixed-timestep simulation of many blocks sliding on the rail network
+    and colliding with each other, with a sweep-and-prune broadphase and
+    a narrowphase spread over worker threads.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CBlockPhysics.h"
+//---------------------------------------------------------------------------
+#include <algorithm>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of blocks, or of pairs, a worker takes at once
+const int BLOCK_PHYSICS_CHUNK = 64;
+
+// fraction of the penetration removed at each step; the rest is left to
+// the next steps so that stacks of contacts do not overshoot
+const double BLOCK_PHYSICS_CORRECTION = 0.8;
+
+
+//===========================================================================
+/*!
+    Constructor of cBlockPhysics. The blocks default to the mass and
+    damping of the object of cRailPhysics.
+*/
+//===========================================================================
+cBlockPhysics::cBlockPhysics()
+{
+    m_mass = 0.02;
+    m_damping = 0.4;
+    m_maxSpeed = 10.0;
+    m_restitution = 0.2;
+    m_solverIterations = 4;
+    m_timeStep = 0.001;
+    m_maxSubsteps = 20;
+    m_maxExtrapolation = 0.01;
+    m_nearMargin = 0.1;
+
+    m_rails = NULL;
+    m_numChannels = 1;
+    m_numBlocks = 0;
+    m_obstacleHalfSize = 0.0;
+    m_obstacleTarget.zero();
+    m_maxHalfSize = 0.0;
+    m_sweepAxis = 0;
+    m_numContacts = 0;
+    m_accumulator = 0.0;
+    m_numSteps = 0;
+}
+
+
+//===========================================================================
+/*!
+    Add a block at rest. Must be called before initialize().
+
+    \param      a_pos       Position of the center of the block.
+    \param      a_halfSize  Half the side of the block.
+    \return     Return the index of the block, or -1 if there are already
+                MAX_BLOCKS blocks.
+*/
+//===========================================================================
+int cBlockPhysics::addBlock(const cVector3d& a_pos, double a_halfSize)
+{
+    if (m_numBlocks >= MAX_BLOCKS) { return (-1); }
+
+    m_pos.resize(m_numBlocks);
+    m_pos.push_back(a_pos);
+    m_halfSize.resize(m_numBlocks);
+    m_halfSize.push_back(a_halfSize);
+
+    return (m_numBlocks++);
+}
+
+
+//===========================================================================
+/*!
+    Set the rails and the number of haptic loops, find the initial pairs,
+    and publish the initial state to each loop and to the display. Must
+    be called after the blocks are added and the size of the obstacle is
+    set, before the threads are started.
+
+    \param      a_rails        Rails constraining the blocks.
+    \param      a_numChannels  Number of haptic loops, at most MAX_PHYSICS_CHANNELS.
+*/
+//===========================================================================
+void cBlockPhysics::initialize(const cRailNetwork* a_rails, int a_numChannels)
+{
+    m_rails = a_rails;
+    m_numChannels = cClamp(a_numChannels, 1, MAX_PHYSICS_CHANNELS);
+
+    // the obstacle follows the blocks, at rest where it was placed
+    int numBodies = m_numBlocks + 1;
+    m_pos.resize(numBodies);
+    m_pos[m_numBlocks] = m_obstacleTarget;
+    m_vel.assign(numBodies, cVector3d(0,0,0));
+    m_force.assign(numBodies, cVector3d(0,0,0));
+    m_halfSize.resize(numBodies);
+    m_halfSize[m_numBlocks] = m_obstacleHalfSize;
+    m_maxHalfSize = 0.0;
+    for (int i=0; i<numBodies; i++)
+    {
+        m_maxHalfSize = cMax(m_maxHalfSize, m_halfSize[i]);
+    }
+
+    // sweep along the axis the blocks are the most spread on, where the
+    // fewest of them overlap
+    m_sweepAxis = 0;
+    double largestSpread = -1.0;
+    for (int k=0; k<3; k++)
+    {
+        double lowest = 0.0, highest = 0.0;
+        for (int i=0; i<m_numBlocks; i++)
+        {
+            lowest = (i == 0) ? m_pos[i][k] : cMin(lowest, m_pos[i][k]);
+            highest = (i == 0) ? m_pos[i][k] : cMax(highest, m_pos[i][k]);
+        }
+        if (highest - lowest > largestSpread)
+        {
+            largestSpread = highest - lowest;
+            m_sweepAxis = k;
+        }
+    }
+
+    // every body takes part in the sweep, the obstacle only if it has a size
+    m_order.clear();
+    for (int i=0; i<numBodies; i++)
+    {
+        if ((i < m_numBlocks) || (m_obstacleHalfSize > 0.0))
+        {
+            m_order.push_back(i);
+        }
+    }
+    m_lower.assign(numBodies, 0.0);
+    m_active.reserve(numBodies);
+    m_contacts.clear();
+    m_numContacts = 0;
+
+    for (int i=0; i<m_numChannels; i++)
+    {
+        cBlockChannel& channel = m_channels[i];
+        channel.m_lastInput = cBlockInput();
+        channel.m_appliedImpulse.assign(m_numBlocks, cVector3d(0,0,0));
+        channel.m_numForces = 0;
+        channel.m_sentInput = cBlockInput();
+        channel.m_impulse.assign(m_numBlocks, cVector3d(0,0,0));
+        channel.m_receivedBlocks = cNearBlocks();
+        channel.m_stateAge = 0.0;
+    }
+
+    m_accumulator = 0.0;
+    m_numSteps = 0;
+
+    findPairs();
+    publish();
+}
+
+
+//===========================================================================
+/*!
+    Advance the simulation by the fixed steps fitting in the elapsed time.
+    The time left over is kept for the next call. Runs on the physics
+    thread.
+
+    \param      a_elapsed  Wall-clock time since the previous call [s].
+    \return     Number of steps taken.
+*/
+//===========================================================================
+int cBlockPhysics::update(double a_elapsed)
+{
+    readInputs();
+
+    // clamp the elapsed time so that a hiccup costs a bounded amount of work
+    double maxElapsed = m_maxSubsteps * m_timeStep;
+    m_accumulator += cClamp(a_elapsed, 0.0, maxElapsed);
+    if (m_accumulator > maxElapsed) { m_accumulator = maxElapsed; }
+
+    // the obstacle reaches its new position at the end of the last step
+    int numSteps = (int)(m_accumulator / m_timeStep);
+    cVector3d& obstacleVel = m_vel[m_numBlocks];
+    if (numSteps > 0)
+    {
+        obstacleVel = (1.0 / (numSteps * m_timeStep)) * (m_obstacleTarget - m_pos[m_numBlocks]);
+    }
+
+    for (int i=0; i<numSteps; i++)
+    {
+        m_pos[m_numBlocks] += m_timeStep * obstacleVel;
+        step();
+        m_accumulator -= m_timeStep;
+    }
+
+    if (numSteps > 0)
+    {
+        m_pos[m_numBlocks] = m_obstacleTarget;
+        obstacleVel.zero();
+        publish();
+    }
+
+    return (numSteps);
+}
+
+
+//===========================================================================
+/*!
+    Read the latest input of each haptic loop, and turn the impulses it
+    applied since the previous input into forces, held until the next
+    input of that loop.
+*/
+//===========================================================================
+void cBlockPhysics::readInputs()
+{
+    for (int i=0; i<m_numBlocks; i++)
+    {
+        m_force[i].zero();
+    }
+
+    for (int i=0; i<m_numChannels; i++)
+    {
+        cBlockChannel& channel = m_channels[i];
+        const cBlockInput& input = channel.m_input.read();
+        double inputTime = input.m_time - channel.m_lastInput.m_time;
+        if (inputTime > 0.0)
+        {
+            // the totals of a block keep growing while it is away from the
+            // tool, so the difference with the last total applied is
+            // what the tool did since
+            channel.m_numForces = input.m_numBlocks;
+            for (int j=0; j<input.m_numBlocks; j++)
+            {
+                int block = input.m_index[j];
+                cVector3d impulse = input.m_impulse[j] - channel.m_appliedImpulse[block];
+                channel.m_appliedImpulse[block] = input.m_impulse[j];
+                channel.m_forceIndex[j] = block;
+                channel.m_force[j] = (1.0 / inputTime) * impulse;
+            }
+        }
+        channel.m_lastInput = input;
+
+        for (int j=0; j<channel.m_numForces; j++)
+        {
+            m_force[channel.m_forceIndex[j]] += channel.m_force[j];
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Advance every block by one fixed step: motion on the rails, then
+    collisions.
+*/
+//===========================================================================
+void cBlockPhysics::step()
+{
+    m_workers.run(integrateBlocks, this, m_numBlocks, BLOCK_PHYSICS_CHUNK);
+
+    findPairs();
+    m_workers.run(computeContacts, this, (int)m_contacts.size(), BLOCK_PHYSICS_CHUNK);
+    solveContacts();
+
+    m_numSteps++;
+}
+
+
+//===========================================================================
+/*!
+    Semi-implicit Euler step of a range of blocks, as in cRailPhysics,
+    followed by the projection of their motion onto the rails. Blocks at
+    rest and left alone are not moved. Each block is only touched by the
+    worker given its range.
+
+    \param      a_data   The cBlockPhysics.
+    \param      a_begin  First block.
+    \param      a_end    Block after the last one.
+*/
+//===========================================================================
+void cBlockPhysics::integrateBlocks(void* a_data, int a_begin, int a_end)
+{
+    cBlockPhysics* physics = (cBlockPhysics*)a_data;
+    const double dt = physics->m_timeStep;
+
+    for (int i=a_begin; i<a_end; i++)
+    {
+        cVector3d& pos = physics->m_pos[i];
+        cVector3d& vel = physics->m_vel[i];
+        const cVector3d& force = physics->m_force[i];
+        if ((vel.x == 0.0) && (vel.y == 0.0) && (vel.z == 0.0) &&
+            (force.x == 0.0) && (force.y == 0.0) && (force.z == 0.0)) { continue; }
+
+        cVector3d acc = (1.0 / physics->m_mass) * (force - physics->m_damping * vel);
+        vel += dt * acc;
+
+        double speed = vel.length();
+        if (speed > physics->m_maxSpeed)
+        {
+            vel.mul(physics->m_maxSpeed / speed);
+        }
+
+        cVector3d newPos = pos;
+        if ((physics->m_rails != NULL) &&
+            physics->m_rails->moveAlongRails(pos, dt * vel, newPos))
+        {
+            vel = (1.0 / dt) * (newPos - pos);
+            pos = newPos;
+        }
+        else
+        {
+            vel.zero();
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Broadphase. The bodies are kept sorted by the lower end of their
+    bounds on the sweep axis; since they barely move between two steps,
+    an insertion sort of the previous order takes about one pass. The
+    sweep then keeps the bodies whose bounds contain the current lower
+    end, and pairs the next body with those of them it overlaps on the
+    two other axes.
+*/
+//===========================================================================
+void cBlockPhysics::findPairs()
+{
+    const int axis = m_sweepAxis;
+    const int numSorted = (int)m_order.size();
+
+    for (int i=0; i<numSorted; i++)
+    {
+        int body = m_order[i];
+        m_lower[body] = m_pos[body][axis] - m_halfSize[body];
+    }
+
+    for (int i=1; i<numSorted; i++)
+    {
+        int body = m_order[i];
+        double lower = m_lower[body];
+        int j = i - 1;
+        while ((j >= 0) && (m_lower[m_order[j]] > lower))
+        {
+            m_order[j+1] = m_order[j];
+            j--;
+        }
+        m_order[j+1] = body;
+    }
+
+    const int axis1 = (axis + 1) % 3;
+    const int axis2 = (axis + 2) % 3;
+    m_active.clear();
+    m_contacts.clear();
+    for (int i=0; i<numSorted; i++)
+    {
+        int body = m_order[i];
+        double lower = m_lower[body];
+
+        // drop the bodies ending before this one starts
+        for (int k=(int)m_active.size()-1; k>=0; k--)
+        {
+            int other = m_active[k];
+            if (m_lower[other] + 2.0 * m_halfSize[other] < lower)
+            {
+                m_active[k] = m_active.back();
+                m_active.pop_back();
+            }
+        }
+
+        for (unsigned int k=0; k<m_active.size(); k++)
+        {
+            int other = m_active[k];
+            double extent = m_halfSize[body] + m_halfSize[other];
+            if ((fabs(m_pos[body][axis1] - m_pos[other][axis1]) <= extent) &&
+                (fabs(m_pos[body][axis2] - m_pos[other][axis2]) <= extent))
+            {
+                cBlockContact contact;
+                contact.m_a = cMin(body, other);
+                contact.m_b = cMax(body, other);
+                contact.m_depth = 0.0;
+                m_contacts.push_back(contact);
+            }
+        }
+
+        m_active.push_back(body);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Narrowphase of a range of pairs: depth and normal of the contact
+    between two cubes aligned with the axes, along the axis on which they
+    overlap the least. Each pair is only touched by the worker given its
+    range.
+
+    \param      a_data   The cBlockPhysics.
+    \param      a_begin  First pair.
+    \param      a_end    Pair after the last one.
+*/
+//===========================================================================
+void cBlockPhysics::computeContacts(void* a_data, int a_begin, int a_end)
+{
+    cBlockPhysics* physics = (cBlockPhysics*)a_data;
+
+    for (int i=a_begin; i<a_end; i++)
+    {
+        cBlockContact& contact = physics->m_contacts[i];
+        cVector3d offset = physics->m_pos[contact.m_b] - physics->m_pos[contact.m_a];
+        double extent = physics->m_halfSize[contact.m_a] + physics->m_halfSize[contact.m_b];
+
+        int axis = 0;
+        double depth = extent - fabs(offset[0]);
+        for (int k=1; k<3; k++)
+        {
+            double overlap = extent - fabs(offset[k]);
+            if (overlap < depth)
+            {
+                depth = overlap;
+                axis = k;
+            }
+        }
+
+        contact.m_depth = depth;
+        contact.m_normal.zero();
+        contact.m_normal[axis] = (offset[axis] >= 0.0) ? 1.0 : -1.0;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Solve the contacts: a few passes of inelastic impulses along their
+    normals, then a few passes pushing the bodies apart, by shares of the
+    penetration left after the previous pushes. The obstacle has an
+    infinite mass.
+*/
+//===========================================================================
+void cBlockPhysics::solveContacts()
+{
+    const double inverseMass = 1.0 / m_mass;
+    m_numContacts = 0;
+
+    for (int n=0; n<m_solverIterations; n++)
+    {
+        for (unsigned int i=0; i<m_contacts.size(); i++)
+        {
+            const cBlockContact& contact = m_contacts[i];
+            if (contact.m_depth <= 0.0) { continue; }
+
+            double inverseMassB = (contact.m_b == m_numBlocks) ? 0.0 : inverseMass;
+            double approach = cDot(m_vel[contact.m_b] - m_vel[contact.m_a], contact.m_normal);
+            if (approach >= 0.0) { continue; }
+
+            double impulse = -(1.0 + m_restitution) * approach / (inverseMass + inverseMassB);
+            m_vel[contact.m_a] -= (impulse * inverseMass) * contact.m_normal;
+            m_vel[contact.m_b] += (impulse * inverseMassB) * contact.m_normal;
+        }
+    }
+
+    for (unsigned int i=0; i<m_contacts.size(); i++)
+    {
+        if (m_contacts[i].m_depth > 0.0) { m_numContacts++; }
+    }
+
+    // each push changes the penetration of the next contacts of the body,
+    // which is measured again along the normal of each contact
+    for (int n=0; n<m_solverIterations; n++)
+    {
+        for (unsigned int i=0; i<m_contacts.size(); i++)
+        {
+            const cBlockContact& contact = m_contacts[i];
+            if (contact.m_depth <= 0.0) { continue; }
+
+            double extent = m_halfSize[contact.m_a] + m_halfSize[contact.m_b];
+            double depth = extent - cDot(m_pos[contact.m_b] - m_pos[contact.m_a], contact.m_normal);
+            if (depth <= 0.0) { continue; }
+
+            double push = BLOCK_PHYSICS_CORRECTION * depth;
+            if (contact.m_b == m_numBlocks)
+            {
+                moveBody(contact.m_a, -push * contact.m_normal);
+            }
+            else
+            {
+                moveBody(contact.m_a, (-0.5 * push) * contact.m_normal);
+                moveBody(contact.m_b, (0.5 * push) * contact.m_normal);
+            }
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Move a block along the rails; a block off the rails stays where it is.
+
+    \param      a_body    Index of the block.
+    \param      a_offset  Displacement asked for.
+*/
+//===========================================================================
+void cBlockPhysics::moveBody(int a_body, const cVector3d& a_offset)
+{
+    cVector3d& pos = m_pos[a_body];
+    cVector3d newPos = pos;
+    if ((m_rails != NULL) && m_rails->moveAlongRails(pos, a_offset, newPos))
+    {
+        pos = newPos;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Hand each haptic loop the blocks nearest to its tool, and the display
+    the positions of all blocks. The blocks near a tool are looked up in
+    the sorted bounds of the broadphase, among those starting close
+    enough to the tool on the sweep axis.
+*/
+//===========================================================================
+void cBlockPhysics::publish()
+{
+    const int axis = m_sweepAxis;
+
+    for (int i=0; i<m_numChannels; i++)
+    {
+        cBlockChannel& channel = m_channels[i];
+        const cVector3d& toolPos = channel.m_lastInput.m_toolPos;
+
+        // first body whose bounds may reach the tool
+        double lowest = toolPos[axis] - m_nearMargin - 2.0 * m_maxHalfSize;
+        double highest = toolPos[axis] + m_nearMargin;
+        int begin = 0, end = (int)m_order.size();
+        while (begin < end)
+        {
+            int middle = (begin + end) / 2;
+            if (m_lower[m_order[middle]] < lowest) { begin = middle + 1; }
+            else { end = middle; }
+        }
+
+        // nearest blocks first
+        double distances[MAX_NEAR_BLOCKS];
+        cNearBlocks& near = channel.m_output.writeBuffer();
+        near.m_numBlocks = 0;
+        for (int j=begin; (j<(int)m_order.size()) && (m_lower[m_order[j]] <= highest); j++)
+        {
+            int block = m_order[j];
+            if (block == m_numBlocks) { continue; }
+
+            // distance from the tool to the bounds of the block
+            double squareDistance = 0.0;
+            for (int k=0; k<3; k++)
+            {
+                double gap = fabs(toolPos[k] - m_pos[block][k]) - m_halfSize[block];
+                if (gap > 0.0) { squareDistance += gap * gap; }
+            }
+            if (squareDistance > m_nearMargin * m_nearMargin) { continue; }
+
+            int slot = near.m_numBlocks;
+            if (slot == MAX_NEAR_BLOCKS)
+            {
+                if (squareDistance >= distances[MAX_NEAR_BLOCKS-1]) { continue; }
+                slot--;
+            }
+            else
+            {
+                near.m_numBlocks++;
+            }
+            while ((slot > 0) && (distances[slot-1] > squareDistance))
+            {
+                distances[slot] = distances[slot-1];
+                near.m_blocks[slot] = near.m_blocks[slot-1];
+                slot--;
+            }
+            distances[slot] = squareDistance;
+            cNearBlock& nearBlock = near.m_blocks[slot];
+            nearBlock.m_index = block;
+            nearBlock.m_pos = m_pos[block];
+            nearBlock.m_vel = m_vel[block];
+            nearBlock.m_halfSize = m_halfSize[block];
+        }
+        channel.m_output.publish();
+    }
+
+    cBlockPoses& poses = m_poses.writeBuffer();
+    poses.m_numBlocks = m_numBlocks;
+    poses.m_numSteps = m_numSteps;
+    for (int i=0; i<m_numBlocks; i++)
+    {
+        poses.m_pos[i] = m_pos[i];
+    }
+    m_poses.publish();
+}
+
+
+//===========================================================================
+/*!
+    Contact force of the blocks handed to a haptic loop on its tool, a
+    sphere pushed out of the bounds of each block by a spring. The blocks
+    are moved at their last published velocity for the time elapsed since
+    they were received, up to m_maxExtrapolation; the opposite impulses
+    are sent to the physics. Runs on the haptics thread owning the channel,
+    without touching the heap.
+
+    \param      a_channel       Channel of the haptic loop.
+    \param      a_toolPos       Position of the tool in global coordinates.
+    \param      a_radius        Radius of the tool.
+    \param      a_stiffness     Stiffness of the blocks [N/m].
+    \param      a_timeInterval  Duration of the tick [s].
+    \return     Force applied by the blocks on the tool [N].
+*/
+//===========================================================================
+cVector3d cBlockPhysics::computeToolForce(int a_channel, const cVector3d& a_toolPos, double a_radius,
+                                          double a_stiffness, double a_timeInterval)
+{
+    cBlockChannel& channel = m_channels[a_channel];
+
+    bool isNew;
+    const cNearBlocks& blocks = channel.m_output.read(isNew);
+    if (isNew)
+    {
+        channel.m_receivedBlocks = blocks;
+        channel.m_stateAge = 0.0;
+    }
+    else
+    {
+        channel.m_stateAge = cMin(channel.m_stateAge + a_timeInterval, m_maxExtrapolation);
+    }
+
+    cBlockInput& input = channel.m_sentInput;
+    input.m_toolPos = a_toolPos;
+    input.m_time += a_timeInterval;
+    input.m_numBlocks = channel.m_receivedBlocks.m_numBlocks;
+
+    cVector3d force(0,0,0);
+    for (int i=0; i<channel.m_receivedBlocks.m_numBlocks; i++)
+    {
+        const cNearBlock& block = channel.m_receivedBlocks.m_blocks[i];
+        cVector3d offset = a_toolPos - (block.m_pos + channel.m_stateAge * block.m_vel);
+
+        // closest point of the block to the tool, relative to its center
+        cVector3d closest;
+        for (int k=0; k<3; k++)
+        {
+            closest[k] = cClamp(offset[k], -block.m_halfSize, block.m_halfSize);
+        }
+
+        cVector3d contactForce(0,0,0);
+        cVector3d outside = offset - closest;
+        double distance = outside.length();
+        if (distance > 0.0)
+        {
+            if (distance < a_radius)
+            {
+                contactForce = (a_stiffness * (a_radius - distance) / distance) * outside;
+            }
+        }
+        else
+        {
+            // the center of the tool is inside: out through the nearest face
+            int axis = 0;
+            double depth = block.m_halfSize - fabs(offset[0]);
+            for (int k=1; k<3; k++)
+            {
+                if (block.m_halfSize - fabs(offset[k]) < depth)
+                {
+                    depth = block.m_halfSize - fabs(offset[k]);
+                    axis = k;
+                }
+            }
+            contactForce[axis] = a_stiffness * (depth + a_radius) * ((offset[axis] >= 0.0) ? 1.0 : -1.0);
+        }
+
+        force += contactForce;
+        cVector3d& impulse = channel.m_impulse[block.m_index];
+        impulse -= a_timeInterval * contactForce;
+        input.m_index[i] = block.m_index;
+        input.m_impulse[i] = impulse;
+    }
+
+    channel.m_input.writeBuffer() = input;
+    channel.m_input.publish();
+
+    return (force);
+}
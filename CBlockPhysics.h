@@ -0,0 +1,345 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CBlockPhysics.h
+
+    \brief
+    Fixed-timestep simulation of many blocks sliding on the rail network
+    and colliding with each other, with a sweep-and-prune broadphase and
+    a narrowphase spread over worker threads.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CBlockPhysicsH
+#define CBlockPhysicsH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTripleBuffer.h"
+#include "CRailNetwork.h"
+#include "CRailPhysics.h"
+#include "CWorkerPool.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// maximum number of blocks
+const int MAX_BLOCKS = 1024;
+
+// maximum number of blocks a haptic loop touches at once
+const int MAX_NEAR_BLOCKS = 16;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// a block handed to a haptic loop
+struct cNearBlock
+{
+    // index of the block
+    int m_index;
+
+    // position and velocity of its center
+    cVector3d m_pos;
+    cVector3d m_vel;
+
+    // half the side of the block
+    double m_halfSize;
+};
+
+// blocks close to the tool of a haptic loop, published by the physics
+struct cNearBlocks
+{
+    cNearBlocks() : m_numBlocks(0) {}
+
+    int m_numBlocks;
+    cNearBlock m_blocks[MAX_NEAR_BLOCKS];
+};
+
+// input sent by a haptic loop; impulses and time are running totals so
+// that no force is lost when the physics misses intermediate samples
+struct cBlockInput
+{
+    cBlockInput() : m_toolPos(0,0,0), m_time(0.0), m_numBlocks(0) {}
+
+    // position of the tool, around which the near blocks are chosen
+    cVector3d m_toolPos;
+
+    // total haptic time [s]
+    double m_time;
+
+    // total impulse applied by the tool on each block it was handed [N*s]
+    int m_numBlocks;
+    int m_index[MAX_NEAR_BLOCKS];
+    cVector3d m_impulse[MAX_NEAR_BLOCKS];
+};
+
+// positions of every block, published by the physics for the display
+struct cBlockPoses
+{
+    cBlockPoses() : m_numBlocks(0), m_numSteps(0) {}
+
+    int m_numBlocks;
+    unsigned long m_numSteps;
+    cVector3d m_pos[MAX_BLOCKS];
+};
+
+// link between the block physics and one haptic loop
+struct cBlockChannel
+{
+    cBlockChannel() : m_numForces(0), m_stateAge(0.0) {}
+
+    // mailboxes between the haptics thread and the physics thread
+    cTripleBuffer<cBlockInput> m_input;
+    cTripleBuffer<cNearBlocks> m_output;
+
+    // physics thread: last input read, impulse of each block already
+    // applied, and force applied until the next input
+    cBlockInput m_lastInput;
+    std::vector<cVector3d> m_appliedImpulse;
+    int m_numForces;
+    int m_forceIndex[MAX_NEAR_BLOCKS];
+    cVector3d m_force[MAX_NEAR_BLOCKS];
+
+    // haptics thread: running totals sent, impulse applied on each block,
+    // last blocks received and their age
+    cBlockInput m_sentInput;
+    std::vector<cVector3d> m_impulse;
+    cNearBlocks m_receivedBlocks;
+    double m_stateAge;
+};
+
+// two bodies whose bounds overlap, and their contact once checked
+struct cBlockContact
+{
+    // bodies; b is the obstacle when it is one of them
+    int m_a;
+    int m_b;
+
+    // penetration depth (0 or less when they do not touch) and normal
+    // from a to b
+    double m_depth;
+    cVector3d m_normal;
+};
+
+
+//===========================================================================
+/*!
+    \class      cBlockPhysics
+    \brief      Mass-damper blocks constrained to a cRailNetwork, colliding
+                with each other and pushed by an obstacle.
+
+    Each block is a cube aligned with the axes, which slides on the rails
+    as the object of cRailPhysics does. update() advances every block by
+    fixed steps. Each step:
+
+    - integrates the motion of the blocks on the rails, in parallel;
+    - sorts the bounds of the bodies along one axis, then sweeps them to
+      list the pairs overlapping on all three axes (sweep and prune); the
+      order of the previous step is sorted again by insertion, which costs
+      little since the blocks barely move between two steps;
+    - computes the contact of each pair, in parallel;
+    - solves the contacts on the physics thread: inelastic impulses, then
+      a push apart moved along the rails.
+
+    The parallel loops run on a cWorkerPool started by startWorkers().
+
+    The obstacle is a body of infinite mass placed with setObstacle(),
+    the cube of cRailPhysics, which pushes the blocks but is not pushed
+    back. It moves to its new position at constant speed over the steps of
+    the next update, so that the blocks it hits take its velocity.
+
+    Haptic loops do not see all the blocks. Each loop sends the position
+    of its tool with its input; after each update the physics hands every
+    loop the few blocks around its tool, found from the sorted bounds.
+    computeToolForce() then renders those blocks alone, with a penalty on
+    their bounds, and sends the opposite impulses back. A block leaves
+    the set handed to a loop only when it is further from the tool than
+    m_nearMargin, far enough that the tool cannot have touched it since
+    the previous update.
+
+    As in cRailPhysics, a channel is only used by its own haptics thread
+    and by the physics thread, through triple buffers; the display reads
+    the positions of the blocks through readPoses().
+*/
+//===========================================================================
+class cBlockPhysics
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cBlockPhysics.
+    cBlockPhysics();
+
+    //! Destructor of cBlockPhysics.
+    ~cBlockPhysics() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - SETUP:
+    //-----------------------------------------------------------------------
+
+    //! Add a block of half side a_halfSize at a_pos; returns its index, or -1 past MAX_BLOCKS.
+    int addBlock(const cVector3d& a_pos, double a_halfSize);
+
+    //! Set the rails and the number of haptic loops; call after the blocks are added, before starting the threads.
+    void initialize(const cRailNetwork* a_rails, int a_numChannels = 1);
+
+    //! Set the half side of the obstacle (0 for none).
+    void setObstacleSize(double a_halfSize) { m_obstacleHalfSize = a_halfSize; }
+
+    //! Start a_numWorkers threads running the loops besides the physics thread.
+    void startWorkers(int a_numWorkers) { m_workers.start(a_numWorkers); }
+
+    //! Number of blocks.
+    int getNumBlocks() const { return (m_numBlocks); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - PHYSICS THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Position the obstacle moves to during the next update; before initialize(), its initial position.
+    void setObstacle(const cVector3d& a_pos) { m_obstacleTarget = a_pos; }
+
+    //! Advance by the fixed steps fitting in a_elapsed seconds.
+    int update(double a_elapsed);
+
+    //! Number of pairs of bodies in contact after the last step.
+    int getNumContacts() const { return (m_numContacts); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - HAPTICS THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Force of the blocks near the tool on a sphere of radius a_radius at a_toolPos.
+    cVector3d computeToolForce(int a_channel, const cVector3d& a_toolPos, double a_radius,
+                               double a_stiffness, double a_timeInterval);
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - GRAPHICS THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Latest positions of the blocks; a_isNew is set when they changed.
+    const cBlockPoses& readPoses(bool& a_isNew) { return (m_poses.read(a_isNew)); }
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Mass of a block [kg].
+    double m_mass;
+
+    //! Viscous damping of a block on the rails [N/(m/s)].
+    double m_damping;
+
+    //! Maximum speed of a block [m/s].
+    double m_maxSpeed;
+
+    //! Fraction of the approach speed kept after a collision.
+    double m_restitution;
+
+    //! Number of passes over the contacts at each step.
+    int m_solverIterations;
+
+    //! Fixed integration step [s].
+    double m_timeStep;
+
+    //! Maximum number of steps per update; older time is dropped.
+    int m_maxSubsteps;
+
+    //! Maximum time the haptic side extrapolates past a physics state [s].
+    double m_maxExtrapolation;
+
+    //! Distance from the tool within which a block is handed to its haptic loop; exceeds the tool radius [m].
+    double m_nearMargin;
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Read the inputs of the haptic loops and update the force on each block.
+    void readInputs();
+
+    //! Advance every block by one fixed step.
+    void step();
+
+    //! Sort the bounds and list the overlapping pairs.
+    void findPairs();
+
+    //! Apply impulses and push apart the bodies in contact.
+    void solveContacts();
+
+    //! Move a body by a_offset along the rails.
+    void moveBody(int a_body, const cVector3d& a_offset);
+
+    //! Publish the blocks near the tool of each haptic loop, and the poses.
+    void publish();
+
+    //! Integrate the blocks [a_begin, a_end) (worker loop).
+    static void integrateBlocks(void* a_data, int a_begin, int a_end);
+
+    //! Compute the contacts of the pairs [a_begin, a_end) (worker loop).
+    static void computeContacts(void* a_data, int a_begin, int a_end);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Rails constraining the blocks.
+    const cRailNetwork* m_rails;
+
+    //! Links to the haptic loops.
+    cBlockChannel m_channels[MAX_PHYSICS_CHANNELS];
+    int m_numChannels;
+
+    //! Bodies: the blocks, then the obstacle at index m_numBlocks.
+    int m_numBlocks;
+    std::vector<cVector3d> m_pos;
+    std::vector<cVector3d> m_vel;
+    std::vector<cVector3d> m_force;
+    std::vector<double> m_halfSize;
+    double m_obstacleHalfSize;
+    cVector3d m_obstacleTarget;
+    double m_maxHalfSize;
+
+    //! Broadphase: axis of the sweep, bodies sorted by the lower end of
+    //! their bounds on it, and the bodies overlapping the one swept.
+    int m_sweepAxis;
+    std::vector<int> m_order;
+    std::vector<double> m_lower;
+    std::vector<int> m_active;
+
+    //! Pairs found by the broadphase, with their contact.
+    std::vector<cBlockContact> m_contacts;
+    int m_numContacts;
+
+    //! Threads running the loops over blocks and pairs.
+    cWorkerPool m_workers;
+
+    //! Physics thread: unconsumed time and number of steps taken.
+    double m_accumulator;
+    unsigned long m_numSteps;
+
+    //! Positions of the blocks for the display.
+    cTripleBuffer<cBlockPoses> m_poses;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
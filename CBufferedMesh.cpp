@@ -0,0 +1,285 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CBufferedMesh.cpp
+
+    \brief
+    Mesh keeping its geometry in OpenGL buffer objects, re-uploading only
+    the vertices that changed.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "GLEntryPoints.h"
+#include "CBufferedMesh.h"
+//---------------------------------------------------------------------------
+#include <stddef.h>
+//---------------------------------------------------------------------------
+#if (defined(_LINUX) || defined(_MACOSX)) && defined(GL_ARRAY_BUFFER)
+#define BUFFERED_MESH_USE_BUFFERS
+#endif
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cBufferedMesh.
+
+    \param      a_world  World the mesh belongs to.
+*/
+//===========================================================================
+cBufferedMesh::cBufferedMesh(cWorld* a_world) : cMesh(a_world)
+{
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_numBufferedVertices = 0;
+    m_numBufferedTriangles = 0;
+    m_numIndices = 0;
+    m_dirtyBegin = 0;
+    m_dirtyEnd = 0;
+    m_rebuild = true;
+    m_numUploadedVertices = 0;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cBufferedMesh.
+*/
+//===========================================================================
+cBufferedMesh::~cBufferedMesh()
+{
+    releaseBuffers();
+}
+
+
+//===========================================================================
+/*!
+    Mark a range of vertices as edited, so that they are uploaded again on
+    the next frame. Ranges marked between two frames are merged into the
+    smallest range covering them.
+
+    \param      a_first  Index of the first edited vertex.
+    \param      a_count  Number of edited vertices.
+*/
+//===========================================================================
+void cBufferedMesh::invalidateVertices(unsigned int a_first, unsigned int a_count)
+{
+    if (a_count == 0) { return; }
+
+    unsigned int end = a_first + a_count;
+    if (m_dirtyBegin == m_dirtyEnd)
+    {
+        m_dirtyBegin = a_first;
+        m_dirtyEnd = end;
+    }
+    else
+    {
+        m_dirtyBegin = cMin(m_dirtyBegin, a_first);
+        m_dirtyEnd = cMax(m_dirtyEnd, end);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Rebuild both buffers on the next frame, for edits that changed more
+    than vertex attributes, such as the vertices of a triangle.
+*/
+//===========================================================================
+void cBufferedMesh::invalidateBuffers()
+{
+    m_rebuild = true;
+}
+
+
+//===========================================================================
+/*!
+    Render the triangles of the mesh from the buffer objects, with the
+    material and texture of the mesh.
+
+    \param      a_renderMode  Rendering pass, as for cMesh.
+*/
+//===========================================================================
+void cBufferedMesh::renderMesh(const int a_renderMode)
+{
+    // vertex colors and transparency keep the path of cMesh
+    if (getUseVertexColors() || m_useTransparency || !updateBuffers())
+    {
+        cMesh::renderMesh(a_renderMode);
+        return;
+    }
+
+    #ifdef BUFFERED_MESH_USE_BUFFERS
+    if (m_numIndices == 0) { return; }
+
+    // material
+    if (m_useMaterialProperty)
+    {
+        m_material.render();
+    }
+
+    // texture
+    bool useTexture = (m_texture != NULL) && m_useTextureMapping;
+    if (useTexture)
+    {
+        glEnable(GL_TEXTURE_2D);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        m_texture->render();
+    }
+
+    // draw every triangle at once
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(cBufferedVertex), (const GLvoid*)offsetof(cBufferedVertex, m_pos));
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, sizeof(cBufferedVertex), (const GLvoid*)offsetof(cBufferedVertex, m_normal));
+    if (useTexture)
+    {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(cBufferedVertex), (const GLvoid*)offsetof(cBufferedVertex, m_texCoord));
+    }
+
+    glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
+
+    if (useTexture)
+    {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+    }
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Create the buffer objects on the first frame, rebuild them when the
+    mesh changed size, and otherwise upload the edited range of vertices.
+
+    \return     Return false if buffer objects are not available.
+*/
+//===========================================================================
+bool cBufferedMesh::updateBuffers()
+{
+    #ifdef BUFFERED_MESH_USE_BUFFERS
+    unsigned int numVertices = (unsigned int)m_vertices.size();
+    unsigned int numTriangles = (unsigned int)m_triangles.size();
+    if ((numVertices != m_numBufferedVertices) || (numTriangles != m_numBufferedTriangles))
+    {
+        m_rebuild = true;
+    }
+
+    if (m_rebuild)
+    {
+        if (m_vertexBuffer == 0)
+        {
+            glGenBuffers(1, &m_vertexBuffer);
+            glGenBuffers(1, &m_indexBuffer);
+        }
+
+        // vertices
+        m_packedVertices.resize(numVertices);
+        packVertices(0, numVertices);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(cBufferedVertex),
+                     m_packedVertices.empty() ? NULL : &m_packedVertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_numUploadedVertices += numVertices;
+
+        // indices of the triangles in use; a removed triangle keeps its
+        // slot in the mesh but is not drawn
+        std::vector<GLuint> indices;
+        indices.reserve(3 * numTriangles);
+        for (unsigned int i=0; i<numTriangles; i++)
+        {
+            const cTriangle& triangle = m_triangles[i];
+            if (!triangle.m_allocated) { continue; }
+            indices.push_back(triangle.getIndexVertex0());
+            indices.push_back(triangle.getIndexVertex1());
+            indices.push_back(triangle.getIndexVertex2());
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                     indices.empty() ? NULL : &indices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        m_numIndices = (unsigned int)indices.size();
+
+        m_numBufferedVertices = numVertices;
+        m_numBufferedTriangles = numTriangles;
+        m_dirtyBegin = 0;
+        m_dirtyEnd = 0;
+        m_rebuild = false;
+        return (true);
+    }
+
+    // only the edited range; edits past the end of the mesh are ignored
+    unsigned int end = cMin(m_dirtyEnd, numVertices);
+    if (m_dirtyBegin < end)
+    {
+        packVertices(m_dirtyBegin, end);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, m_dirtyBegin * sizeof(cBufferedVertex),
+                        (end - m_dirtyBegin) * sizeof(cBufferedVertex), &m_packedVertices[m_dirtyBegin]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_numUploadedVertices += end - m_dirtyBegin;
+    }
+    m_dirtyBegin = 0;
+    m_dirtyEnd = 0;
+    return (true);
+    #else
+    return (false);
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Convert a range of vertices of the mesh to their buffered form.
+
+    \param      a_first  Index of the first vertex.
+    \param      a_end    Index after the last vertex.
+*/
+//===========================================================================
+void cBufferedMesh::packVertices(unsigned int a_first, unsigned int a_end)
+{
+    for (unsigned int i=a_first; i<a_end; i++)
+    {
+        const cVertex& vertex = m_vertices[i];
+        cBufferedVertex& packed = m_packedVertices[i];
+        packed.m_pos[0] = (float)vertex.m_localPos.x;
+        packed.m_pos[1] = (float)vertex.m_localPos.y;
+        packed.m_pos[2] = (float)vertex.m_localPos.z;
+        packed.m_normal[0] = (float)vertex.m_normal.x;
+        packed.m_normal[1] = (float)vertex.m_normal.y;
+        packed.m_normal[2] = (float)vertex.m_normal.z;
+        packed.m_texCoord[0] = (float)vertex.m_texCoord.x;
+        packed.m_texCoord[1] = (float)vertex.m_texCoord.y;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Release the buffer objects; they are created again on the next frame.
+*/
+//===========================================================================
+void cBufferedMesh::releaseBuffers()
+{
+    #ifdef BUFFERED_MESH_USE_BUFFERS
+    if (m_vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_vertexBuffer);
+        glDeleteBuffers(1, &m_indexBuffer);
+    }
+    #endif
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_rebuild = true;
+}
@@ -0,0 +1,136 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CBufferedMesh.h
+
+    \brief
+    Mesh keeping its geometry in OpenGL buffer objects, re-uploading only
+    the vertices that changed.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CBufferedMeshH
+#define CBufferedMeshH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// a vertex as stored in the vertex buffer, interleaved in single precision
+struct cBufferedVertex
+{
+    float m_pos[3];
+    float m_normal[3];
+    float m_texCoord[2];
+};
+
+
+//===========================================================================
+/*!
+    \class      cBufferedMesh
+    \brief      cMesh drawn from buffer objects with a single glDrawElements.
+
+    cMesh submits every triangle again on each frame. cBufferedMesh copies
+    the positions, normals and texture coordinates of its vertices into a
+    vertex buffer once, and the indices of its triangles into an index
+    buffer, then draws from them.
+
+    The vertices are still edited through the cMesh interface (getVertex()
+    then setPos(), setNormal() or setTexCoord()), which the mesh cannot
+    see: whoever edits them calls invalidateVertices() with the range it
+    touched, and only that range is converted and re-uploaded, with
+    glBufferSubData, on the next frame. Adding or removing vertices or
+    triangles is detected from their count and rebuilds the buffers.
+
+    Material, texture and the other render passes of cMesh are unchanged.
+    Meshes using vertex colors or transparency, and builds without buffer
+    objects, fall back to the rendering of cMesh. All methods must be
+    called from the thread owning the GL context.
+*/
+//===========================================================================
+class cBufferedMesh : public cMesh
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cBufferedMesh.
+    cBufferedMesh(cWorld* a_world);
+
+    //! Destructor of cBufferedMesh.
+    virtual ~cBufferedMesh();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Re-upload a_count vertices from a_first on the next frame.
+    void invalidateVertices(unsigned int a_first, unsigned int a_count);
+
+    //! Re-upload every vertex and the triangle indices on the next frame.
+    void invalidateBuffers();
+
+    //! Number of vertices uploaded since the buffers were created.
+    unsigned long getNumUploadedVertices() const { return (m_numUploadedVertices); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Render the triangles from the buffer objects.
+    virtual void renderMesh(const int a_renderMode=0);
+
+    //! Create or update the buffer objects; returns false if they cannot be used.
+    bool updateBuffers();
+
+    //! Convert a range of vertices to their buffered form.
+    void packVertices(unsigned int a_first, unsigned int a_end);
+
+    //! Release the buffer objects.
+    void releaseBuffers();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Vertex and index buffer objects (0 until the first frame).
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+
+    //! Copy of the vertex buffer in its buffered form.
+    std::vector<cBufferedVertex> m_packedVertices;
+
+    //! Number of vertices and triangles the buffers were built from.
+    unsigned int m_numBufferedVertices;
+    unsigned int m_numBufferedTriangles;
+
+    //! Number of indices in the index buffer.
+    unsigned int m_numIndices;
+
+    //! Range of vertices to re-upload [m_dirtyBegin, m_dirtyEnd).
+    unsigned int m_dirtyBegin;
+    unsigned int m_dirtyEnd;
+
+    //! True when the buffers must be rebuilt.
+    bool m_rebuild;
+
+    //! Number of uploaded vertices.
+    unsigned long m_numUploadedVertices;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,334 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CCachedCollisionAABB.cpp
+
+    \brief
+    AABB collision tree stored in a cache file after it is built, and
+    loaded from it instead of being rebuilt on later launches.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CCachedCollisionAABB.h"
+#include "CMappedFile.h"
+#include <stdio.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// fold a_size bytes into a 64-bit FNV-1a hash
+static unsigned long long hashBytes(unsigned long long a_hash, const void* a_data, size_t a_size)
+{
+    const unsigned char* bytes = (const unsigned char*)a_data;
+    for (size_t i=0; i<a_size; i++)
+    {
+        a_hash ^= bytes[i];
+        a_hash *= 1099511628211ULL;
+    }
+    return (a_hash);
+}
+
+// fold a vector into a hash
+static unsigned long long hashVector(unsigned long long a_hash, const cVector3d& a_vector)
+{
+    double values[3] = { a_vector.x, a_vector.y, a_vector.z };
+    return (hashBytes(a_hash, values, sizeof(values)));
+}
+
+
+//===========================================================================
+/*!
+    Constructor of cCachedCollisionAABB.
+
+    \param      a_triangles     Triangles of the mesh.
+    \param      a_useNeighbors  Passed on to cCollisionAABB.
+    \param      a_cachePrefix   Path prefix of the cache files.
+*/
+//===========================================================================
+cCachedCollisionAABB::cCachedCollisionAABB(std::vector<cTriangle>* a_triangles, bool a_useNeighbors,
+                                           const std::string& a_cachePrefix)
+    : cCollisionAABB(a_triangles, a_useNeighbors)
+{
+    m_cachePrefix = a_cachePrefix;
+    m_loadedFromCache = false;
+}
+
+
+//===========================================================================
+/*!
+    Create a cached tree for a mesh and make it the collision detector of
+    the mesh. Children of the mesh are left alone.
+
+    \param      a_mesh          Mesh to collide with.
+    \param      a_radius        Radius the boxes are grown by.
+    \param      a_useNeighbors  Passed on to cCollisionAABB.
+    \param      a_cachePrefix   Path prefix of the cache files.
+    \return     Return the collision detector given to the mesh.
+*/
+//===========================================================================
+cCachedCollisionAABB* cCachedCollisionAABB::create(cMesh* a_mesh, double a_radius, bool a_useNeighbors,
+                                                   const std::string& a_cachePrefix)
+{
+    cCachedCollisionAABB* collisionDetector =
+        new cCachedCollisionAABB(a_mesh->pTriangles(), a_useNeighbors, a_cachePrefix);
+    collisionDetector->initialize(a_radius);
+
+    delete a_mesh->getCollisionDetector();
+    a_mesh->setCollisionDetector(collisionDetector);
+
+    return (collisionDetector);
+}
+
+
+//===========================================================================
+/*!
+    Load the tree for the current triangles and radius from the cache. On
+    a miss, build the tree as cCollisionAABB does and save it for the next
+    launch.
+
+    \param      a_radius  Radius the boxes are grown by.
+*/
+//===========================================================================
+void cCachedCollisionAABB::initialize(double a_radius)
+{
+    unsigned long long key = computeKey(a_radius);
+
+    char name[32];
+    sprintf(name, "aabb_%016llx.cache", key);
+    std::string filename = m_cachePrefix + name;
+
+    m_loadedFromCache = loadCache(filename, key, a_radius);
+    if (m_loadedFromCache) { return; }
+
+    cCollisionAABB::initialize(a_radius);
+    saveCache(filename, key, a_radius);
+}
+
+
+//===========================================================================
+/*!
+    Hash everything the tree depends on: the vertex positions of every
+    triangle, which triangles are in use, and the radius.
+
+    \param      a_radius  Radius the boxes are grown by.
+    \return     Return the hash.
+*/
+//===========================================================================
+unsigned long long cCachedCollisionAABB::computeKey(double a_radius) const
+{
+    unsigned long long hash = 14695981039346656037ULL;
+
+    unsigned int numTriangles = (unsigned int)m_triangles->size();
+    hash = hashBytes(hash, &numTriangles, sizeof(numTriangles));
+    hash = hashBytes(hash, &a_radius, sizeof(a_radius));
+
+    for (unsigned int i=0; i<numTriangles; i++)
+    {
+        const cTriangle& triangle = (*m_triangles)[i];
+        unsigned char allocated = triangle.m_allocated ? 1 : 0;
+        hash = hashBytes(hash, &allocated, sizeof(allocated));
+        if (!allocated) { continue; }
+
+        hash = hashVector(hash, triangle.getVertex0()->getPos());
+        hash = hashVector(hash, triangle.getVertex1()->getPos());
+        hash = hashVector(hash, triangle.getVertex2()->getPos());
+    }
+
+    return (hash);
+}
+
+
+//===========================================================================
+/*!
+    Child index of a node: i for internal node i, -(i+1) for leaf i.
+
+    \param      a_node  Node of this tree.
+    \return     Return the index of the node.
+*/
+//===========================================================================
+int cCachedCollisionAABB::getNodeIndex(const cCollisionAABBNode* a_node) const
+{
+    if (a_node->m_nodeType == AABB_NODE_LEAF)
+    {
+        return (-(int)((const cCollisionAABBLeaf*)a_node - m_leaves) - 1);
+    }
+    return ((int)((const cCollisionAABBInternal*)a_node - m_internalNodes));
+}
+
+
+//===========================================================================
+/*!
+    Recreate the tree from a cache file. The file is rejected unless its
+    header matches this mesh and radius, every index is in range and every
+    node except the root has exactly one parent.
+
+    \param      a_filename  Path of the cache file.
+    \param      a_key       Hash of the triangles and radius.
+    \param      a_radius    Radius the boxes are grown by.
+    \return     Return true if the tree was loaded.
+*/
+//===========================================================================
+bool cCachedCollisionAABB::loadCache(const std::string& a_filename, unsigned long long a_key, double a_radius)
+{
+    cMappedFile file;
+    if (!file.openReadOnly(a_filename.c_str())) { return (false); }
+
+    int numLeaves = (int)m_triangles->size();
+    int numInternals = (numLeaves > 1) ? numLeaves - 1 : 0;
+    size_t size = sizeof(cAABBCacheHeader) + (size_t)numLeaves * sizeof(cAABBCacheLeaf) +
+                  (size_t)numInternals * sizeof(cAABBCacheInternal);
+
+    // check the layout before trusting the content
+    const cAABBCacheHeader* header = (const cAABBCacheHeader*)file.getData();
+    if ((numLeaves == 0) ||
+        (file.getSize() < size) ||
+        (header->m_magic != AABB_CACHE_MAGIC) ||
+        (header->m_version != AABB_CACHE_VERSION) ||
+        (header->m_headerSize != sizeof(cAABBCacheHeader)) ||
+        (header->m_leafSize != sizeof(cAABBCacheLeaf)) ||
+        (header->m_internalSize != sizeof(cAABBCacheInternal)) ||
+        (header->m_numLeaves != (unsigned int)numLeaves) ||
+        (header->m_numInternals != (unsigned int)numInternals) ||
+        (header->m_key != a_key) ||
+        (header->m_radius != a_radius))
+    {
+        return (false);
+    }
+
+    const cAABBCacheLeaf* leaves = (const cAABBCacheLeaf*)(file.getData() + sizeof(cAABBCacheHeader));
+    const cAABBCacheInternal* internals = (const cAABBCacheInternal*)(leaves + numLeaves);
+
+    // every node but the root is the child of exactly one internal node
+    std::vector<char> hasParent(numLeaves + numInternals, 0);
+    int root = header->m_root;
+    if ((root < -numLeaves) || (root >= numInternals)) { return (false); }
+    hasParent[root + numLeaves] = 1;
+    for (int i=0; i<numInternals; i++)
+    {
+        int children[2] = { internals[i].m_left, internals[i].m_right };
+        for (int j=0; j<2; j++)
+        {
+            int child = children[j];
+            if ((child < -numLeaves) || (child >= numInternals)) { return (false); }
+            if (hasParent[child + numLeaves]) { return (false); }
+            hasParent[child + numLeaves] = 1;
+        }
+    }
+    for (int i=0; i<numLeaves; i++)
+    {
+        if (leaves[i].m_triangle >= (unsigned int)numLeaves) { return (false); }
+    }
+
+    // replace any previous tree
+    delete [] m_leaves;
+    delete [] m_internalNodes;
+    m_leaves = new cCollisionAABBLeaf[numLeaves];
+    m_internalNodes = (numInternals > 0) ? new cCollisionAABBInternal[numInternals] : NULL;
+    m_numTriangles = numLeaves;
+
+    for (int i=0; i<numLeaves; i++)
+    {
+        const cAABBCacheLeaf& source = leaves[i];
+        cCollisionAABBLeaf& leaf = m_leaves[i];
+        leaf.m_bbox.setValue(cVector3d(source.m_min[0], source.m_min[1], source.m_min[2]),
+                             cVector3d(source.m_max[0], source.m_max[1], source.m_max[2]));
+        leaf.m_triangle = &(*m_triangles)[source.m_triangle];
+        leaf.m_depth = source.m_depth;
+    }
+
+    for (int i=0; i<numInternals; i++)
+    {
+        const cAABBCacheInternal& source = internals[i];
+        cCollisionAABBInternal& node = m_internalNodes[i];
+        node.m_bbox.setValue(cVector3d(source.m_min[0], source.m_min[1], source.m_min[2]),
+                             cVector3d(source.m_max[0], source.m_max[1], source.m_max[2]));
+        node.m_leftSubTree = (source.m_left < 0) ? (cCollisionAABBNode*)&m_leaves[-source.m_left - 1]
+                                                 : (cCollisionAABBNode*)&m_internalNodes[source.m_left];
+        node.m_rightSubTree = (source.m_right < 0) ? (cCollisionAABBNode*)&m_leaves[-source.m_right - 1]
+                                                   : (cCollisionAABBNode*)&m_internalNodes[source.m_right];
+        node.m_depth = source.m_depth;
+        node.m_testLineBox = (source.m_testLineBox != 0);
+    }
+
+    m_root = (root < 0) ? (cCollisionAABBNode*)&m_leaves[-root - 1]
+                        : (cCollisionAABBNode*)&m_internalNodes[root];
+    m_root->setParent(NULL, 1);
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Save the tree to a cache file. The header is written last, so a file
+    left incomplete by a crash is rejected by loadCache().
+
+    \param      a_filename  Path of the cache file.
+    \param      a_key       Hash of the triangles and radius.
+    \param      a_radius    Radius the boxes are grown by.
+    \return     Return true if the file was written.
+*/
+//===========================================================================
+bool cCachedCollisionAABB::saveCache(const std::string& a_filename, unsigned long long a_key, double a_radius) const
+{
+    int numLeaves = m_numTriangles;
+    int numInternals = (numLeaves > 1) ? numLeaves - 1 : 0;
+    if ((m_root == NULL) || (numLeaves != (int)m_triangles->size())) { return (false); }
+
+    cMappedFile file;
+    size_t size = sizeof(cAABBCacheHeader) + (size_t)numLeaves * sizeof(cAABBCacheLeaf) +
+                  (size_t)numInternals * sizeof(cAABBCacheInternal);
+    if (!file.create(a_filename.c_str(), size)) { return (false); }
+
+    cAABBCacheHeader* header = (cAABBCacheHeader*)file.getData();
+    cAABBCacheLeaf* leaves = (cAABBCacheLeaf*)(file.getData() + sizeof(cAABBCacheHeader));
+    cAABBCacheInternal* internals = (cAABBCacheInternal*)(leaves + numLeaves);
+
+    for (int i=0; i<numLeaves; i++)
+    {
+        const cCollisionAABBLeaf& leaf = m_leaves[i];
+        cVector3d min = leaf.m_bbox.getMin();
+        cVector3d max = leaf.m_bbox.getMax();
+        cAABBCacheLeaf& target = leaves[i];
+        target.m_min[0] = min.x;  target.m_min[1] = min.y;  target.m_min[2] = min.z;
+        target.m_max[0] = max.x;  target.m_max[1] = max.y;  target.m_max[2] = max.z;
+        target.m_triangle = (unsigned int)(leaf.m_triangle - &(*m_triangles)[0]);
+        target.m_depth = leaf.m_depth;
+    }
+
+    for (int i=0; i<numInternals; i++)
+    {
+        const cCollisionAABBInternal& node = m_internalNodes[i];
+        cVector3d min = node.m_bbox.getMin();
+        cVector3d max = node.m_bbox.getMax();
+        cAABBCacheInternal& target = internals[i];
+        target.m_min[0] = min.x;  target.m_min[1] = min.y;  target.m_min[2] = min.z;
+        target.m_max[0] = max.x;  target.m_max[1] = max.y;  target.m_max[2] = max.z;
+        target.m_left = getNodeIndex(node.m_leftSubTree);
+        target.m_right = getNodeIndex(node.m_rightSubTree);
+        target.m_depth = node.m_depth;
+        target.m_testLineBox = node.m_testLineBox ? 1 : 0;
+    }
+
+    cAABBCacheHeader completed;
+    memset(&completed, 0, sizeof(completed));
+    completed.m_magic = AABB_CACHE_MAGIC;
+    completed.m_version = AABB_CACHE_VERSION;
+    completed.m_headerSize = sizeof(cAABBCacheHeader);
+    completed.m_leafSize = sizeof(cAABBCacheLeaf);
+    completed.m_internalSize = sizeof(cAABBCacheInternal);
+    completed.m_numLeaves = (unsigned int)numLeaves;
+    completed.m_numInternals = (unsigned int)numInternals;
+    completed.m_root = getNodeIndex(m_root);
+    completed.m_key = a_key;
+    completed.m_radius = a_radius;
+    memcpy(header, &completed, sizeof(completed));
+
+    file.close();
+    return (true);
+}
@@ -0,0 +1,174 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CCachedCollisionAABB.h
+
+    \brief
+    AABB collision tree stored in a cache file after it is built, and
+    loaded from it instead of being rebuilt on later launches.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CCachedCollisionAABBH
+#define CCachedCollisionAABBH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <string>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// first bytes of a tree cache file ("HAAB" in a little-endian file)
+const unsigned int AABB_CACHE_MAGIC     = 0x42414148;
+
+// version of the layout below
+const unsigned int AABB_CACHE_VERSION   = 1;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// start of a tree cache file, followed by one cAABBCacheLeaf per triangle
+// and one cAABBCacheInternal per internal node. all fields are written in
+// native byte order.
+struct cAABBCacheHeader
+{
+    // AABB_CACHE_MAGIC and AABB_CACHE_VERSION
+    unsigned int m_magic;
+    unsigned int m_version;
+
+    // size of the header and of each node in bytes, checked when loading
+    unsigned int m_headerSize;
+    unsigned int m_leafSize;
+    unsigned int m_internalSize;
+
+    // number of triangles (leaves) and of internal nodes
+    unsigned int m_numLeaves;
+    unsigned int m_numInternals;
+
+    // root node, encoded as a child index (see cAABBCacheInternal)
+    int m_root;
+
+    // hash of the triangles and radius the tree was built for
+    unsigned long long m_key;
+
+    // radius the boxes were grown by
+    double m_radius;
+};
+
+// a leaf of the tree
+struct cAABBCacheLeaf
+{
+    // box of the leaf
+    double m_min[3];
+    double m_max[3];
+
+    // index of the triangle in the mesh
+    unsigned int m_triangle;
+
+    // depth of the leaf in the tree
+    int m_depth;
+};
+
+// an internal node of the tree; a child index i >= 0 is internal node i,
+// i < 0 is leaf -(i+1)
+struct cAABBCacheInternal
+{
+    // box of the node
+    double m_min[3];
+    double m_max[3];
+
+    // children of the node
+    int m_left;
+    int m_right;
+
+    // depth of the node in the tree
+    int m_depth;
+
+    // segment-box test flag of the node
+    int m_testLineBox;
+};
+
+
+//===========================================================================
+/*!
+    \class      cCachedCollisionAABB
+    \brief      cCollisionAABB saving its tree to a cache file and loading
+                it back instead of rebuilding it.
+
+    The cache file is named after a hash of the triangle vertices and of
+    the radius, and its header repeats both; a mesh or radius that changed
+    simply misses the cache and builds (and saves) a new tree. Loading maps
+    the file and recreates the nodes in one linear pass, without the box
+    fitting and partitioning of a build.
+*/
+//===========================================================================
+class cCachedCollisionAABB : public cCollisionAABB
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cCachedCollisionAABB; cache files are named a_cachePrefix + key.
+    cCachedCollisionAABB(std::vector<cTriangle>* a_triangles, bool a_useNeighbors,
+                         const std::string& a_cachePrefix);
+
+    //! Destructor of cCachedCollisionAABB.
+    virtual ~cCachedCollisionAABB() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Load the tree from the cache, or build it and save it there.
+    virtual void initialize(double a_radius = 0);
+
+    //! True if the last initialize() loaded the tree from the cache.
+    bool wasLoadedFromCache() const { return (m_loadedFromCache); }
+
+    //! Give a_mesh a cached tree, as cMesh::createAABBCollisionDetector does.
+    static cCachedCollisionAABB* create(cMesh* a_mesh, double a_radius, bool a_useNeighbors,
+                                        const std::string& a_cachePrefix);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Hash of the triangles and of a_radius.
+    unsigned long long computeKey(double a_radius) const;
+
+    //! Rebuild the tree from a cache file.
+    bool loadCache(const std::string& a_filename, unsigned long long a_key, double a_radius);
+
+    //! Save the tree to a cache file.
+    bool saveCache(const std::string& a_filename, unsigned long long a_key, double a_radius) const;
+
+    //! Child index of a node of the tree.
+    int getNodeIndex(const cCollisionAABBNode* a_node) const;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Path prefix of the cache files.
+    std::string m_cachePrefix;
+
+    //! True if the last initialize() loaded the tree from the cache.
+    bool m_loadedFromCache;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
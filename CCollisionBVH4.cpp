@@ -0,0 +1,435 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CCollisionBVH4.cpp
+
+    \brief
+    Collision detector storing the bounding volume hierarchy of a mesh as
+    a flat array of 4-wide nodes, tested four boxes at a time.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CCollisionBVH4.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+//---------------------------------------------------------------------------
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define BVH4_USE_SSE
+#include <xmmintrin.h>
+#endif
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// float at or below a_value, so that a box rounded to floats still encloses
+// the triangles it was computed from
+static float floatBelow(double a_value)
+{
+    float value = (float)a_value;
+    return (value - (fabsf(value) * FLT_EPSILON + FLT_MIN));
+}
+
+// float at or above a_value
+static float floatAbove(double a_value)
+{
+    float value = (float)a_value;
+    return (value + (fabsf(value) * FLT_EPSILON + FLT_MIN));
+}
+
+// inverse of a segment direction component, kept finite so that the slab
+// test never computes 0 * infinity
+static float safeInverse(double a_value)
+{
+    const double LARGE = 1e30;
+    if (fabs(a_value) < 1.0 / LARGE) { return ((a_value < 0.0) ? (float)-LARGE : (float)LARGE); }
+    return ((float)(1.0 / a_value));
+}
+
+// order build entries by their centroid along one axis
+struct cCentroidLess
+{
+    cCentroidLess(int a_axis) : m_axis(a_axis) {}
+    template <class T> bool operator()(const T& a_a, const T& a_b) const
+    {
+        return (a_a.m_centroid[m_axis] < a_b.m_centroid[m_axis]);
+    }
+    int m_axis;
+};
+
+
+//===========================================================================
+/*!
+    Constructor of cCollisionBVH4. The hierarchy is empty until
+    initialize() is called.
+
+    \param      a_triangles  Triangles of the mesh.
+*/
+//===========================================================================
+cCollisionBVH4::cCollisionBVH4(std::vector<cTriangle>* a_triangles)
+{
+    m_triangles = a_triangles;
+    m_radius = 0.0;
+}
+
+
+//===========================================================================
+/*!
+    Create a hierarchy for a mesh and make it the collision detector of
+    the mesh. Children of the mesh are left alone.
+
+    \param      a_mesh    Mesh to collide with.
+    \param      a_radius  Radius the boxes are grown by.
+    \return     Return the collision detector given to the mesh.
+*/
+//===========================================================================
+cCollisionBVH4* cCollisionBVH4::create(cMesh* a_mesh, double a_radius)
+{
+    cCollisionBVH4* collisionDetector = new cCollisionBVH4(a_mesh->pTriangles());
+    collisionDetector->initialize(a_radius);
+
+    delete a_mesh->getCollisionDetector();
+    a_mesh->setCollisionDetector(collisionDetector);
+
+    return (collisionDetector);
+}
+
+
+//===========================================================================
+/*!
+    Build the hierarchy: a binary tree split at the median centroid along
+    the longest axis, collapsed into 4-wide nodes emitted depth-first.
+
+    \param      a_radius  Radius the boxes are grown by.
+*/
+//===========================================================================
+void cCollisionBVH4::initialize(double a_radius)
+{
+    m_radius = a_radius;
+    m_nodes.clear();
+    m_triangleList.clear();
+
+    // bounds and centroid of every triangle in use
+    m_buildEntries.clear();
+    for (unsigned int i=0; i<m_triangles->size(); i++)
+    {
+        cTriangle* triangle = &(*m_triangles)[i];
+        if (!triangle->m_allocated) { continue; }
+
+        cVector3d p[3] = { triangle->getVertex0()->getPos(),
+                           triangle->getVertex1()->getPos(),
+                           triangle->getVertex2()->getPos() };
+        cBuildEntry entry;
+        for (int k=0; k<3; k++)
+        {
+            double a = (&p[0].x)[k], b = (&p[1].x)[k], c = (&p[2].x)[k];
+            entry.m_min[k] = cMin(a, cMin(b, c)) - a_radius;
+            entry.m_max[k] = cMax(a, cMax(b, c)) + a_radius;
+            entry.m_centroid[k] = (a + b + c) / 3.0;
+        }
+        entry.m_triangle = triangle;
+        m_buildEntries.push_back(entry);
+    }
+
+    if (m_buildEntries.empty()) { return; }
+
+    // build the binary tree, which also orders the entries into leaves
+    m_buildNodes.clear();
+    m_buildNodes.reserve(2 * m_buildEntries.size() / BVH4_LEAF_SIZE + 1);
+    int root = buildBinary(0, (int)m_buildEntries.size());
+
+    m_triangleList.resize(m_buildEntries.size());
+    for (unsigned int i=0; i<m_buildEntries.size(); i++)
+    {
+        m_triangleList[i] = m_buildEntries[i].m_triangle;
+    }
+
+    // a mesh small enough for one leaf still gets a root node
+    if (m_buildNodes[root].m_left < 0)
+    {
+        cBuildNode node = m_buildNodes[root];
+        node.m_left = root;
+        node.m_right = -1;
+        m_buildNodes.push_back(node);
+        root = (int)m_buildNodes.size() - 1;
+    }
+    emitNode(root);
+
+    // release the build data
+    std::vector<cBuildEntry>().swap(m_buildEntries);
+    std::vector<cBuildNode>().swap(m_buildNodes);
+}
+
+
+//===========================================================================
+/*!
+    Build the binary tree over a range of the build list, splitting it at
+    the median centroid along the longest axis of the centroid bounds.
+
+    \param      a_first  First entry of the range.
+    \param      a_count  Number of entries of the range.
+    \return     Return the index of the binary node.
+*/
+//===========================================================================
+int cCollisionBVH4::buildBinary(int a_first, int a_count)
+{
+    cBuildNode node;
+    node.m_left = -1;
+    node.m_right = -1;
+    node.m_first = a_first;
+    node.m_count = a_count;
+
+    double centroidMin[3], centroidMax[3];
+    for (int k=0; k<3; k++)
+    {
+        node.m_min[k] = centroidMin[k] = DBL_MAX;
+        node.m_max[k] = centroidMax[k] = -DBL_MAX;
+    }
+    for (int i=a_first; i<a_first+a_count; i++)
+    {
+        const cBuildEntry& entry = m_buildEntries[i];
+        for (int k=0; k<3; k++)
+        {
+            node.m_min[k] = cMin(node.m_min[k], entry.m_min[k]);
+            node.m_max[k] = cMax(node.m_max[k], entry.m_max[k]);
+            centroidMin[k] = cMin(centroidMin[k], entry.m_centroid[k]);
+            centroidMax[k] = cMax(centroidMax[k], entry.m_centroid[k]);
+        }
+    }
+
+    int index = (int)m_buildNodes.size();
+    m_buildNodes.push_back(node);
+    if (a_count <= BVH4_LEAF_SIZE) { return (index); }
+
+    int axis = 0;
+    for (int k=1; k<3; k++)
+    {
+        if (centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis]) { axis = k; }
+    }
+
+    int half = a_count / 2;
+    std::nth_element(m_buildEntries.begin() + a_first,
+                     m_buildEntries.begin() + a_first + half,
+                     m_buildEntries.begin() + a_first + a_count,
+                     cCentroidLess(axis));
+
+    int left = buildBinary(a_first, half);
+    int right = buildBinary(a_first + half, a_count - half);
+    m_buildNodes[index].m_left = left;
+    m_buildNodes[index].m_right = right;
+
+    return (index);
+}
+
+
+//===========================================================================
+/*!
+    Emit the 4-wide node standing for a binary node. Its children are the
+    binary children, repeatedly replacing the largest inner child by its
+    own two children until there are four. The node is appended before its
+    children, so the array is in depth-first order.
+
+    \param      a_binary  Binary node with at least one child.
+    \return     Return the index of the emitted node.
+*/
+//===========================================================================
+int cCollisionBVH4::emitNode(int a_binary)
+{
+    // gather up to four children
+    int children[4];
+    int numChildren = 0;
+    children[numChildren++] = m_buildNodes[a_binary].m_left;
+    if (m_buildNodes[a_binary].m_right >= 0)
+    {
+        children[numChildren++] = m_buildNodes[a_binary].m_right;
+    }
+
+    while (numChildren < 4)
+    {
+        int largest = -1;
+        double largestArea = -1.0;
+        for (int i=0; i<numChildren; i++)
+        {
+            const cBuildNode& child = m_buildNodes[children[i]];
+            if (child.m_left < 0) { continue; }
+
+            double dx = child.m_max[0] - child.m_min[0];
+            double dy = child.m_max[1] - child.m_min[1];
+            double dz = child.m_max[2] - child.m_min[2];
+            double area = dx*dy + dy*dz + dz*dx;
+            if (area > largestArea)
+            {
+                largest = i;
+                largestArea = area;
+            }
+        }
+        if (largest < 0) { break; }
+
+        const cBuildNode& expanded = m_buildNodes[children[largest]];
+        children[largest] = expanded.m_left;
+        children[numChildren++] = expanded.m_right;
+    }
+
+    // append the node, then its subtrees
+    int index = (int)m_nodes.size();
+    m_nodes.push_back(cBVH4Node());
+
+    for (int i=0; i<4; i++)
+    {
+        cBVH4Node& node = m_nodes[index];
+        if (i >= numChildren)
+        {
+            node.m_minX[i] = node.m_minY[i] = node.m_minZ[i] = FLT_MAX;
+            node.m_maxX[i] = node.m_maxY[i] = node.m_maxZ[i] = -FLT_MAX;
+            node.m_child[i] = 0;
+            node.m_count[i] = 0;
+            continue;
+        }
+
+        const cBuildNode& child = m_buildNodes[children[i]];
+        node.m_minX[i] = floatBelow(child.m_min[0]);
+        node.m_minY[i] = floatBelow(child.m_min[1]);
+        node.m_minZ[i] = floatBelow(child.m_min[2]);
+        node.m_maxX[i] = floatAbove(child.m_max[0]);
+        node.m_maxY[i] = floatAbove(child.m_max[1]);
+        node.m_maxZ[i] = floatAbove(child.m_max[2]);
+
+        if (child.m_left < 0)
+        {
+            node.m_child[i] = ~child.m_first;
+            node.m_count[i] = child.m_count;
+        }
+        else
+        {
+            // the vector may grow while the subtree is emitted
+            int childIndex = emitNode(children[i]);
+            m_nodes[index].m_child[i] = childIndex;
+            m_nodes[index].m_count[i] = 0;
+        }
+    }
+
+    return (index);
+}
+
+
+//===========================================================================
+/*!
+    Find the triangles hit by a segment. Every leaf whose box the segment
+    crosses has its triangles tested with cTriangle::computeCollision,
+    which records the contacts according to a_settings.
+
+    \param      a_segmentPointA  Start point of the segment.
+    \param      a_segmentPointB  End point of the segment.
+    \param      a_recorder       Receives the collisions.
+    \param      a_settings       Collision settings.
+    \return     Return true if a collision was found.
+*/
+//===========================================================================
+bool cCollisionBVH4::computeCollision(cVector3d& a_segmentPointA, cVector3d& a_segmentPointB,
+                                      cCollisionRecorder& a_recorder, cCollisionSettings& a_settings)
+{
+    if (m_nodes.empty()) { return (false); }
+
+    cVector3d direction = cSub(a_segmentPointB, a_segmentPointA);
+    float originX = (float)a_segmentPointA.x;
+    float originY = (float)a_segmentPointA.y;
+    float originZ = (float)a_segmentPointA.z;
+    float inverseX = safeInverse(direction.x);
+    float inverseY = safeInverse(direction.y);
+    float inverseZ = safeInverse(direction.z);
+
+    #ifdef BVH4_USE_SSE
+    const __m128 ox = _mm_set1_ps(originX);
+    const __m128 oy = _mm_set1_ps(originY);
+    const __m128 oz = _mm_set1_ps(originZ);
+    const __m128 ix = _mm_set1_ps(inverseX);
+    const __m128 iy = _mm_set1_ps(inverseY);
+    const __m128 iz = _mm_set1_ps(inverseZ);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    #endif
+
+    bool hit = false;
+    int stack[BVH4_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const cBVH4Node& node = m_nodes[stack[--stackSize]];
+
+        // slab test of the segment (t in [0,1]) against the four boxes
+        int mask = 0;
+        #ifdef BVH4_USE_SSE
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.m_minX), ox), ix);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.m_maxX), ox), ix);
+        __m128 tNear = _mm_max_ps(_mm_min_ps(t0, t1), zero);
+        __m128 tFar = _mm_min_ps(_mm_max_ps(t0, t1), one);
+
+        t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.m_minY), oy), iy);
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.m_maxY), oy), iy);
+        tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+        tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+
+        t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.m_minZ), oz), iz);
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.m_maxZ), oz), iz);
+        tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+        tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+
+        mask = _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+        #else
+        for (int i=0; i<4; i++)
+        {
+            float t0 = (node.m_minX[i] - originX) * inverseX;
+            float t1 = (node.m_maxX[i] - originX) * inverseX;
+            float tNear = cMax(cMin(t0, t1), 0.0f);
+            float tFar = cMin(cMax(t0, t1), 1.0f);
+
+            t0 = (node.m_minY[i] - originY) * inverseY;
+            t1 = (node.m_maxY[i] - originY) * inverseY;
+            tNear = cMax(tNear, cMin(t0, t1));
+            tFar = cMin(tFar, cMax(t0, t1));
+
+            t0 = (node.m_minZ[i] - originZ) * inverseZ;
+            t1 = (node.m_maxZ[i] - originZ) * inverseZ;
+            tNear = cMax(tNear, cMin(t0, t1));
+            tFar = cMin(tFar, cMax(t0, t1));
+
+            if (tNear <= tFar) { mask |= (1 << i); }
+        }
+        #endif
+
+        for (int i=0; i<4; i++)
+        {
+            if ((mask & (1 << i)) == 0) { continue; }
+
+            int child = node.m_child[i];
+            int count = node.m_count[i];
+            if (child >= 0)
+            {
+                // unused slots point to the root, which is nobody's child
+                if ((child > 0) && (stackSize < BVH4_STACK_SIZE))
+                {
+                    stack[stackSize++] = child;
+                }
+            }
+            else
+            {
+                cTriangle** triangles = &m_triangleList[~child];
+                for (int j=0; j<count; j++)
+                {
+                    if (triangles[j]->computeCollision(a_segmentPointA, direction, a_recorder, a_settings))
+                    {
+                        hit = true;
+                    }
+                }
+            }
+        }
+    }
+
+    return (hit);
+}
@@ -0,0 +1,164 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CCollisionBVH4.h
+
+    \brief
+    Collision detector storing the bounding volume hierarchy of a mesh as
+    a flat array of 4-wide nodes, tested four boxes at a time.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CCollisionBVH4H
+#define CCollisionBVH4H
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// largest number of triangles stored in a leaf
+const int BVH4_LEAF_SIZE        = 4;
+
+// depth of the traversal stack; a median split keeps the tree balanced,
+// so this is never reached by meshes that fit in memory
+const int BVH4_STACK_SIZE       = 256;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// a node of the hierarchy: the boxes of up to four children, one array
+// per coordinate so that the four boxes are tested with one instruction
+// per slab. a child index c >= 0 is node c; c < 0 is a leaf made of
+// m_count triangles starting at entry ~c of the triangle list. the
+// children in use are packed at the front.
+struct cBVH4Node
+{
+    float m_minX[4];
+    float m_minY[4];
+    float m_minZ[4];
+    float m_maxX[4];
+    float m_maxY[4];
+    float m_maxZ[4];
+    int m_child[4];
+    int m_count[4];
+};
+
+
+//===========================================================================
+/*!
+    \class      cCollisionBVH4
+    \brief      Collision detector for meshes whose AABB tree traversal is
+                bound by cache misses.
+
+    The nodes are stored depth-first in one array, so a traversal mostly
+    walks forward through memory, and each node holds the boxes of its
+    four children as structure-of-arrays, tested against the segment in
+    one SSE batch (or a scalar loop on other processors). Leaves refer to
+    short runs of a reordered triangle list. Triangles are tested with
+    cTriangle::computeCollision, as cCollisionAABB does, so contacts and
+    settings behave the same.
+
+    The boxes are grown by the radius given to initialize(), like those of
+    cCollisionAABB, and the tree refers to the triangles of the mesh: it
+    must be rebuilt if the mesh is edited.
+*/
+//===========================================================================
+class cCollisionBVH4 : public cGenericCollision
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cCollisionBVH4.
+    cCollisionBVH4(std::vector<cTriangle>* a_triangles);
+
+    //! Destructor of cCollisionBVH4.
+    virtual ~cCollisionBVH4() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Build the hierarchy, growing every box by a_radius.
+    virtual void initialize(double a_radius = 0);
+
+    //! Find the triangles hit by the segment from a_segmentPointA to a_segmentPointB.
+    virtual bool computeCollision(cVector3d& a_segmentPointA, cVector3d& a_segmentPointB,
+                                  cCollisionRecorder& a_recorder, cCollisionSettings& a_settings);
+
+    //! Number of nodes.
+    int getNumNodes() const { return ((int)m_nodes.size()); }
+
+    //! Number of triangles in the hierarchy.
+    int getNumTriangles() const { return ((int)m_triangleList.size()); }
+
+    //! Give a_mesh this collision detector, as cMesh::createAABBCollisionDetector does.
+    static cCollisionBVH4* create(cMesh* a_mesh, double a_radius);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Build the binary tree over entries [a_first, a_first+a_count) of the build list.
+    int buildBinary(int a_first, int a_count);
+
+    //! Emit the 4-wide node collapsing binary node a_binary and its subtree.
+    int emitNode(int a_binary);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Triangles of the mesh.
+    std::vector<cTriangle>* m_triangles;
+
+    //! Nodes, depth-first; node 0 is the root.
+    std::vector<cBVH4Node> m_nodes;
+
+    //! Triangles in leaf order.
+    std::vector<cTriangle*> m_triangleList;
+
+    //! Temporary data of a build: one entry per triangle.
+    struct cBuildEntry
+    {
+        double m_min[3];
+        double m_max[3];
+        double m_centroid[3];
+        cTriangle* m_triangle;
+    };
+    std::vector<cBuildEntry> m_buildEntries;
+
+    //! Temporary data of a build: a binary node; m_left < 0 for a leaf.
+    struct cBuildNode
+    {
+        double m_min[3];
+        double m_max[3];
+        int m_left;
+        int m_right;
+        int m_first;
+        int m_count;
+    };
+    std::vector<cBuildNode> m_buildNodes;
+
+    //! Radius the boxes are grown by.
+    double m_radius;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
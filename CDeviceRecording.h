@@ -0,0 +1,76 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CDeviceRecording.h
+
+    \brief
+    Binary layout of a haptic device recording: a header followed by one
+    fixed-size record per haptic tick, written and read in place through
+    a memory mapping.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CDeviceRecordingH
+#define CDeviceRecordingH
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// first bytes of a recording ("HREC" in a little-endian file)
+const unsigned int DEVICE_RECORDING_MAGIC   = 0x43455248;
+
+// version of the layout below
+const unsigned int DEVICE_RECORDING_VERSION = 1;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// start of a recording; all fields are written in native byte order
+struct cDeviceRecordingHeader
+{
+    // DEVICE_RECORDING_MAGIC and DEVICE_RECORDING_VERSION
+    unsigned int m_magic;
+    unsigned int m_version;
+
+    // size of cDeviceRecordingHeader and of cDeviceRecord in bytes
+    unsigned int m_headerSize;
+    unsigned int m_recordSize;
+
+    // number of records written, and room allocated for them
+    unsigned long long m_numRecords;
+    unsigned long long m_capacity;
+
+    // specifications of the recorded device, restored on replay
+    double m_maxForce;
+    double m_maxForceStiffness;
+    double m_maxLinearDamping;
+    double m_workspaceRadius;
+};
+
+// state of the device during one haptic tick
+struct cDeviceRecord
+{
+    // time since the device was opened [s]
+    double m_time;
+
+    // position [m] and velocity [m/s] read from the device
+    double m_pos[3];
+    double m_vel[3];
+
+    // last force commanded to the device during the tick [N]
+    double m_force[3];
+
+    // status of the user switch
+    unsigned int m_userSwitch;
+    unsigned int m_reserved;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
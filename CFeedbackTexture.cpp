@@ -0,0 +1,532 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CFeedbackTexture.cpp
+
+    \brief
+    Texture fed with the image rendered by the camera, without stalling
+    the frame on a synchronous framebuffer readback.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "GLEntryPoints.h"
+#include "CFeedbackTexture.h"
+//---------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+#if (defined(_LINUX) || defined(_MACOSX)) && defined(GL_PIXEL_PACK_BUFFER)
+#define FEEDBACK_USE_PIXEL_BUFFERS
+#endif
+#if (defined(_LINUX) || defined(_MACOSX)) && defined(GL_READ_FRAMEBUFFER)
+#define FEEDBACK_USE_FRAMEBUFFERS
+#endif
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// smallest resolution chosen in automatic mode [pixels]
+const int FEEDBACK_MIN_AUTO_RESOLUTION = 16;
+
+
+//===========================================================================
+/*!
+    Constructor of cFeedbackTexture.
+*/
+//===========================================================================
+cFeedbackTexture::cFeedbackTexture()
+{
+    m_feedbackMode = FEEDBACK_COPY_TEXTURE;
+    m_textureWidth = 0;
+    m_textureHeight = 0;
+    m_pixelBuffers[0] = 0;
+    m_pixelBuffers[1] = 0;
+    m_pixelBufferIndex = 0;
+    m_pendingWidth = 0;
+    m_pendingHeight = 0;
+    m_resolution = FEEDBACK_FULL_RESOLUTION;
+    m_displayedSize = 0.0;
+    m_imageWidth = 0;
+    m_imageHeight = 0;
+    m_canScale = false;
+    m_scaleChecked = false;
+    m_framebuffer = 0;
+    m_renderbuffer = 0;
+    m_renderbufferWidth = 0;
+    m_renderbufferHeight = 0;
+    m_updatePeriod = 0.0;
+    m_nextUpdate = 0.0;
+    m_clock.start(true);
+
+    // the image copied at the resolution of the frame is not mipmapped
+    setMagFunction(GL_LINEAR);
+    setMinFunction(GL_LINEAR);
+
+    // cTexture2D does not render a texture without an image; a single
+    // pixel is enough until the first frame has been copied
+    m_image.allocate(1, 1, GL_RGB);
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cFeedbackTexture.
+*/
+//===========================================================================
+cFeedbackTexture::~cFeedbackTexture()
+{
+    releasePixelBuffers();
+    releaseFramebuffers();
+}
+
+
+//===========================================================================
+/*!
+    Select how the rendered image reaches the texture.
+
+    \param      a_mode  New feedback mode.
+*/
+//===========================================================================
+void cFeedbackTexture::setFeedbackMode(cFeedbackMode a_mode)
+{
+    #ifndef FEEDBACK_USE_PIXEL_BUFFERS
+    if (a_mode == FEEDBACK_ASYNC_READBACK) { a_mode = FEEDBACK_READBACK; }
+    #endif
+
+    if (a_mode == m_feedbackMode) { return; }
+
+    // texture storage and pending reads are no longer valid
+    releasePixelBuffers();
+    releaseFramebuffers();
+    m_textureWidth = 0;
+    m_textureHeight = 0;
+    m_feedbackMode = a_mode;
+}
+
+
+//===========================================================================
+/*!
+    Set the rate at which the texture is updated, independently of the
+    frame rate. Frames rendered between two updates leave the texture as
+    it is.
+
+    \param      a_rate  Update rate [Hz]; 0 to update on every frame.
+*/
+//===========================================================================
+void cFeedbackTexture::setUpdateRate(double a_rate)
+{
+    m_updatePeriod = (a_rate > 0.0) ? 1.0 / a_rate : 0.0;
+    m_nextUpdate = 0.0;
+}
+
+
+//===========================================================================
+/*!
+    Feed the image just rendered into the texture, if an update is due.
+    Must be called after the camera has rendered and before the buffers
+    are swapped.
+
+    \param      a_camera  Camera that rendered the frame.
+    \param      a_width   Width of the rendered frame in pixels.
+    \param      a_height  Height of the rendered frame in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::updateFromFramebuffer(cCamera* a_camera, int a_width, int a_height)
+{
+    if ((a_width <= 0) || (a_height <= 0)) { return; }
+
+    // keep to the update rate; after a pause, start again from now
+    // instead of catching up
+    if (m_updatePeriod > 0.0)
+    {
+        double now = m_clock.getCurrentTimeSeconds();
+        if (now < m_nextUpdate) { return; }
+        m_nextUpdate = cMax(m_nextUpdate + m_updatePeriod, now);
+    }
+
+    int imageWidth, imageHeight;
+    computeImageSize(a_width, a_height, imageWidth, imageHeight);
+    bool scaled = (imageWidth != a_width) || (imageHeight != a_height);
+    m_imageWidth = imageWidth;
+    m_imageHeight = imageHeight;
+
+    switch (m_feedbackMode)
+    {
+        case FEEDBACK_READBACK:
+            if (scaled)
+            {
+                scaleToRenderbuffer(a_width, a_height, imageWidth, imageHeight);
+                readback(imageWidth, imageHeight);
+            }
+            else
+            {
+                a_camera->copyImageData(&m_image);
+                markForUpdate();
+            }
+            break;
+
+        case FEEDBACK_COPY_TEXTURE:
+            if (scaled)
+            {
+                scaleToTexture(a_width, a_height, imageWidth, imageHeight);
+            }
+            else
+            {
+                copyToTexture(a_width, a_height);
+            }
+            break;
+
+        case FEEDBACK_ASYNC_READBACK:
+            if (scaled)
+            {
+                scaleToRenderbuffer(a_width, a_height, imageWidth, imageHeight);
+            }
+            else
+            {
+                glReadBuffer(GL_BACK);
+            }
+            readbackAsync(imageWidth, imageHeight);
+            break;
+    }
+
+    #ifdef FEEDBACK_USE_FRAMEBUFFERS
+    if (scaled)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Size of the image fed into the texture from a frame. The aspect ratio
+    of the frame is kept; the resolution applies to its shorter side,
+    which is the side of the square shown on the objects.
+
+    \param      a_width        Width of the frame in pixels.
+    \param      a_height       Height of the frame in pixels.
+    \param      a_imageWidth   Returned width of the image in pixels.
+    \param      a_imageHeight  Returned height of the image in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::computeImageSize(int a_width, int a_height, int& a_imageWidth, int& a_imageHeight)
+{
+    a_imageWidth = a_width;
+    a_imageHeight = a_height;
+
+    // the frame can only be scaled by framebuffer blits; look for them
+    // once, with the context current
+    if (!m_scaleChecked)
+    {
+        m_scaleChecked = true;
+        #ifdef FEEDBACK_USE_FRAMEBUFFERS
+        const char* version = (const char*)glGetString(GL_VERSION);
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        m_canScale = ((version != NULL) && (atoi(version) >= 3)) ||
+                     ((extensions != NULL) && (strstr(extensions, "GL_ARB_framebuffer_object") != NULL));
+        #endif
+        if (!m_canScale && (m_resolution != FEEDBACK_FULL_RESOLUTION))
+        {
+            printf("camera feedback: no framebuffer blit, the texture keeps the resolution of the frame\n");
+        }
+    }
+    if (!m_canScale) { return; }
+
+    int side = cMin(a_width, a_height);
+    int resolution = side;
+    if (m_resolution == FEEDBACK_AUTO_RESOLUTION)
+    {
+        // the next power of two above the displayed size; the mipmaps
+        // cover the minification below it
+        resolution = FEEDBACK_MIN_AUTO_RESOLUTION;
+        while ((resolution < m_displayedSize) && (resolution < side))
+        {
+            resolution *= 2;
+        }
+    }
+    else if (m_resolution > 0)
+    {
+        resolution = m_resolution;
+    }
+
+    if (resolution >= side) { return; }
+
+    a_imageWidth = cMax(1, (a_width * resolution + side / 2) / side);
+    a_imageHeight = cMax(1, (a_height * resolution + side / 2) / side);
+}
+
+
+//===========================================================================
+/*!
+    Copy the back buffer into the texture object. The texture storage is
+    only redefined when the size of the frame changes.
+
+    \param      a_width   Width of the frame in pixels.
+    \param      a_height  Height of the frame in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::copyToTexture(int a_width, int a_height)
+{
+    // the texture content now comes from the framebuffer; make sure
+    // cTexture2D does not upload m_image over it
+    m_updateTextureFlag = false;
+
+    if ((m_textureID == 0) || !glIsTexture(m_textureID))
+    {
+        glGenTextures(1, &m_textureID);
+        m_textureWidth = 0;
+        m_textureHeight = 0;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    glReadBuffer(GL_BACK);
+
+    if ((a_width != m_textureWidth) || (a_height != m_textureHeight))
+    {
+        setMinFunction(GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 0, 0, a_width, a_height, 0);
+        m_textureWidth = a_width;
+        m_textureHeight = a_height;
+    }
+    else
+    {
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, a_width, a_height);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+//===========================================================================
+/*!
+    Scale the back buffer down into the texture object with a framebuffer
+    blit, then build the mipmaps of the texture. The texture storage is
+    only redefined when the size of the image changes.
+
+    \param      a_width        Width of the frame in pixels.
+    \param      a_height       Height of the frame in pixels.
+    \param      a_imageWidth   Width of the image in pixels.
+    \param      a_imageHeight  Height of the image in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::scaleToTexture(int a_width, int a_height, int a_imageWidth, int a_imageHeight)
+{
+    #ifdef FEEDBACK_USE_FRAMEBUFFERS
+    // as in copyToTexture(), the texture content comes from the GL side
+    m_updateTextureFlag = false;
+
+    if ((m_textureID == 0) || !glIsTexture(m_textureID))
+    {
+        glGenTextures(1, &m_textureID);
+        m_textureWidth = 0;
+        m_textureHeight = 0;
+    }
+    if (m_framebuffer == 0)
+    {
+        glGenFramebuffers(1, &m_framebuffer);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+
+    if ((a_imageWidth != m_textureWidth) || (a_imageHeight != m_textureHeight))
+    {
+        setMinFunction(GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, a_imageWidth, a_imageHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureID, 0);
+        m_textureWidth = a_imageWidth;
+        m_textureHeight = a_imageHeight;
+    }
+
+    // the blit filters linearly; it reads the frame once, at any size
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glBlitFramebuffer(0, 0, a_width, a_height, 0, 0, a_imageWidth, a_imageHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Scale the back buffer down into the render buffer with a framebuffer
+    blit, and bind it as the buffer the readbacks read from.
+
+    \param      a_width        Width of the frame in pixels.
+    \param      a_height       Height of the frame in pixels.
+    \param      a_imageWidth   Width of the image in pixels.
+    \param      a_imageHeight  Height of the image in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::scaleToRenderbuffer(int a_width, int a_height, int a_imageWidth, int a_imageHeight)
+{
+    #ifdef FEEDBACK_USE_FRAMEBUFFERS
+    if (m_framebuffer == 0)
+    {
+        glGenFramebuffers(1, &m_framebuffer);
+        glGenRenderbuffers(1, &m_renderbuffer);
+        m_renderbufferWidth = 0;
+        m_renderbufferHeight = 0;
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+
+    if ((a_imageWidth != m_renderbufferWidth) || (a_imageHeight != m_renderbufferHeight))
+    {
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, a_imageWidth, a_imageHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+        m_renderbufferWidth = a_imageWidth;
+        m_renderbufferHeight = a_imageHeight;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glBlitFramebuffer(0, 0, a_width, a_height, 0, 0, a_imageWidth, a_imageHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    // the readbacks read the scaled image
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Read the image of the bound read buffer into m_image, synchronously.
+
+    \param      a_width   Width of the image in pixels.
+    \param      a_height  Height of the image in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::readback(int a_width, int a_height)
+{
+    if (((int)m_image.getWidth() != a_width) ||
+        ((int)m_image.getHeight() != a_height) ||
+        (m_image.getFormat() != GL_RGB))
+    {
+        m_image.allocate(a_width, a_height, GL_RGB);
+    }
+
+    setMinFunction(GL_LINEAR);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, a_width, a_height, GL_RGB, GL_UNSIGNED_BYTE, m_image.getData());
+    markForUpdate();
+}
+
+
+//===========================================================================
+/*!
+    Start an asynchronous read of the bound read buffer (the back buffer,
+    or the scaled image) into one pixel buffer object, and copy the image
+    read during the previous call from the other one into m_image.
+
+    \param      a_width   Width of the frame in pixels.
+    \param      a_height  Height of the frame in pixels.
+*/
+//===========================================================================
+void cFeedbackTexture::readbackAsync(int a_width, int a_height)
+{
+    #ifdef FEEDBACK_USE_PIXEL_BUFFERS
+    if (m_pixelBuffers[0] == 0)
+    {
+        glGenBuffers(2, m_pixelBuffers);
+        m_pixelBufferIndex = 0;
+        m_pendingWidth = 0;
+        m_pendingHeight = 0;
+    }
+
+    // start reading the current frame; glReadPixels returns immediately
+    // when the destination is a pixel buffer object
+    GLuint current = m_pixelBuffers[m_pixelBufferIndex];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, current);
+    glBufferData(GL_PIXEL_PACK_BUFFER, a_width * a_height * 3, NULL, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, a_width, a_height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+
+    // collect the frame started during the previous call
+    if ((m_pendingWidth > 0) && (m_pendingHeight > 0))
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[1 - m_pixelBufferIndex]);
+        const unsigned char* pixels = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels != NULL)
+        {
+            if (((int)m_image.getWidth() != m_pendingWidth) ||
+                ((int)m_image.getHeight() != m_pendingHeight) ||
+                (m_image.getFormat() != GL_RGB))
+            {
+                m_image.allocate(m_pendingWidth, m_pendingHeight, GL_RGB);
+            }
+            memcpy(m_image.getData(), pixels, m_pendingWidth * m_pendingHeight * 3);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            setMinFunction(GL_LINEAR);
+            markForUpdate();
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_pendingWidth = a_width;
+    m_pendingHeight = a_height;
+    m_pixelBufferIndex = 1 - m_pixelBufferIndex;
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Release the pixel buffer objects and forget any pending read.
+*/
+//===========================================================================
+void cFeedbackTexture::releasePixelBuffers()
+{
+    #ifdef FEEDBACK_USE_PIXEL_BUFFERS
+    if (m_pixelBuffers[0] != 0)
+    {
+        glDeleteBuffers(2, m_pixelBuffers);
+    }
+    #endif
+    m_pixelBuffers[0] = 0;
+    m_pixelBuffers[1] = 0;
+    m_pendingWidth = 0;
+    m_pendingHeight = 0;
+}
+
+
+//===========================================================================
+/*!
+    Release the framebuffer and render buffer objects used to scale the
+    frame down.
+*/
+//===========================================================================
+void cFeedbackTexture::releaseFramebuffers()
+{
+    #ifdef FEEDBACK_USE_FRAMEBUFFERS
+    if (m_framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &m_framebuffer);
+    }
+    if (m_renderbuffer != 0)
+    {
+        glDeleteRenderbuffers(1, &m_renderbuffer);
+    }
+    #endif
+    m_framebuffer = 0;
+    m_renderbuffer = 0;
+    m_renderbufferWidth = 0;
+    m_renderbufferHeight = 0;
+}
@@ -0,0 +1,216 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CFeedbackTexture.h
+
+    \brief
+    Texture fed with the image rendered by the camera, without stalling
+    the frame on a synchronous framebuffer readback.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CFeedbackTextureH
+#define CFeedbackTextureH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// resolution of the texture: the frame as rendered
+const int FEEDBACK_FULL_RESOLUTION  = 0;
+
+// resolution of the texture: follows the size at which it is displayed
+const int FEEDBACK_AUTO_RESOLUTION  = -1;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// how the rendered image reaches the texture
+enum cFeedbackMode
+{
+    // read the framebuffer into m_image and upload it again (synchronous)
+    FEEDBACK_READBACK,
+
+    // copy the framebuffer into the texture on the GL side; no CPU copy
+    FEEDBACK_COPY_TEXTURE,
+
+    // read the framebuffer into pixel buffer objects and pick the result
+    // up one frame later, for when m_image must hold the image on the CPU
+    FEEDBACK_ASYNC_READBACK
+};
+
+
+//===========================================================================
+/*!
+    \class      cFeedbackTexture
+    \brief      2D texture updated from the framebuffer after each frame.
+
+    In FEEDBACK_COPY_TEXTURE mode the back buffer is copied straight into
+    the texture object with glCopyTexSubImage2D, which only needs OpenGL
+    1.1 and therefore also runs under Mesa software rendering. The CPU
+    never sees the pixels and the frame never waits for a readback.
+
+    In FEEDBACK_ASYNC_READBACK mode two pixel buffer objects are used in
+    turn: the current frame is read into one while the previous frame is
+    mapped from the other, so m_image lags one frame behind but the read
+    does not stall the pipeline. Pixel buffer objects need OpenGL 2.1;
+    where they are not available the mode falls back to FEEDBACK_READBACK.
+
+    The texture rarely needs the resolution of the frame: the objects it
+    is mapped on cover a small part of the window. With a resolution set,
+    the frame is first scaled down on the GL side by a framebuffer blit,
+    so that the readback modes move fewer pixels and the copy mode fills
+    a smaller texture, whose mipmaps are then built by the GL for the
+    minification on the objects. In FEEDBACK_AUTO_RESOLUTION mode the
+    resolution is the power of two above the displayed size given by
+    setDisplayedSize(), so it only changes when that size doubles or
+    halves. Framebuffer blits need OpenGL 3.0 or ARB_framebuffer_object;
+    without them the texture keeps the resolution of the frame.
+
+    The texture may also be updated at a lower rate than the frames, each
+    skipped frame costing nothing.
+
+    All methods must be called from the thread owning the GL context.
+*/
+//===========================================================================
+class cFeedbackTexture : public cTexture2D
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cFeedbackTexture.
+    cFeedbackTexture();
+
+    //! Destructor of cFeedbackTexture.
+    virtual ~cFeedbackTexture();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Select how the rendered image reaches the texture.
+    void setFeedbackMode(cFeedbackMode a_mode);
+
+    //! Current feedback mode.
+    cFeedbackMode getFeedbackMode() const { return (m_feedbackMode); }
+
+    //! Set the resolution: pixels across the shorter side of the frame, FEEDBACK_FULL_RESOLUTION or FEEDBACK_AUTO_RESOLUTION.
+    void setResolution(int a_resolution) { m_resolution = a_resolution; }
+
+    //! Resolution setting.
+    int getResolution() const { return (m_resolution); }
+
+    //! Set the size in pixels at which the shorter side of the frame is displayed on the objects (auto resolution).
+    void setDisplayedSize(double a_size) { m_displayedSize = a_size; }
+
+    //! Set the rate at which the texture is updated [Hz]; 0 for every frame.
+    void setUpdateRate(double a_rate);
+
+    //! Rate at which the texture is updated [Hz]; 0 for every frame.
+    double getUpdateRate() const { return ((m_updatePeriod > 0.0) ? 1.0 / m_updatePeriod : 0.0); }
+
+    //! Width of the image fed by the last update, in pixels.
+    int getImageWidth() const { return (m_imageWidth); }
+
+    //! Height of the image fed by the last update, in pixels.
+    int getImageHeight() const { return (m_imageHeight); }
+
+    //! Feed the image just rendered by a_camera into the texture, if an update is due.
+    void updateFromFramebuffer(cCamera* a_camera, int a_width, int a_height);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Size of the image fed from a frame of a_width x a_height pixels.
+    void computeImageSize(int a_width, int a_height, int& a_imageWidth, int& a_imageHeight);
+
+    //! Copy the back buffer into the texture object.
+    void copyToTexture(int a_width, int a_height);
+
+    //! Scale the back buffer down into the texture object and build its mipmaps.
+    void scaleToTexture(int a_width, int a_height, int a_imageWidth, int a_imageHeight);
+
+    //! Scale the back buffer down into the render buffer and bind it for reading.
+    void scaleToRenderbuffer(int a_width, int a_height, int a_imageWidth, int a_imageHeight);
+
+    //! Read the bound read buffer into m_image.
+    void readback(int a_width, int a_height);
+
+    //! Start reading the bound read buffer into a pixel buffer and collect the previous one.
+    void readbackAsync(int a_width, int a_height);
+
+    //! Release the pixel buffer objects.
+    void releasePixelBuffers();
+
+    //! Release the framebuffer and render buffer objects.
+    void releaseFramebuffers();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Current feedback mode.
+    cFeedbackMode m_feedbackMode;
+
+    //! Size of the texture storage defined on the GL side.
+    int m_textureWidth;
+    int m_textureHeight;
+
+    //! Pixel buffer objects used in turn, and the one to read into next.
+    GLuint m_pixelBuffers[2];
+    int m_pixelBufferIndex;
+
+    //! Size of the image pending in the other pixel buffer (0 if none).
+    int m_pendingWidth;
+    int m_pendingHeight;
+
+    //! Resolution setting.
+    int m_resolution;
+
+    //! Size at which the shorter side of the frame is displayed [pixels].
+    double m_displayedSize;
+
+    //! Size of the image fed by the last update.
+    int m_imageWidth;
+    int m_imageHeight;
+
+    //! True if the GL context can scale the frame down; checked on first use.
+    bool m_canScale;
+    bool m_scaleChecked;
+
+    //! Framebuffer object the frame is scaled into, and its render buffer
+    //! for the readback modes.
+    GLuint m_framebuffer;
+    GLuint m_renderbuffer;
+
+    //! Size of the storage of the render buffer.
+    int m_renderbufferWidth;
+    int m_renderbufferHeight;
+
+    //! Period of the updates [s] (0: every frame) and time of the next one.
+    double m_updatePeriod;
+    double m_nextUpdate;
+
+    //! Clock giving the time of the updates.
+    cPrecisionClock m_clock;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
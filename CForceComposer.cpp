@@ -0,0 +1,140 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CForceComposer.cpp
+
+    \brief
+    Accumulates the forces acting on a tool during a haptic tick and turns
+    them into the single command written to the device.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CForceComposer.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// force [N] below which the output is released after start-up; too small
+// to be felt
+static const double SMALL_FORCE = 0.01;
+
+
+//===========================================================================
+/*!
+    Constructor of cForceComposer. Until configure() is called, forces are
+    neither filtered nor saturated.
+*/
+//===========================================================================
+cForceComposer::cForceComposer()
+{
+    m_maxForce = 0.0;
+    m_timeConstant = 0.0;
+    m_numSaturated = 0;
+    reset();
+}
+
+
+//===========================================================================
+/*!
+    Set the limits of the device the commands are sent to.
+
+    \param      a_maxForce  Largest force magnitude [N]; 0 for no limit.
+    \param      a_cutoffFrequency  Cutoff of the first-order low-pass
+                filter [Hz]; 0 for no filter.
+*/
+//===========================================================================
+void cForceComposer::configure(double a_maxForce, double a_cutoffFrequency)
+{
+    m_maxForce = cMax(a_maxForce, 0.0);
+    m_timeConstant = (a_cutoffFrequency > 0.0) ? 1.0 / (2.0 * CHAI_PI * a_cutoffFrequency) : 0.0;
+}
+
+
+//===========================================================================
+/*!
+    Clear the filter and hold the output at zero until the composed force
+    becomes small, as after start-up.
+*/
+//===========================================================================
+void cForceComposer::reset()
+{
+    m_sum.zero();
+    m_filtered.zero();
+    m_command.zero();
+    m_waitForSmallForce = true;
+}
+
+
+//===========================================================================
+/*!
+    Turn the sum of the contributions of the tick into the command: low-
+    pass filter it, then clamp its magnitude to the largest force of the
+    device, keeping its direction.
+
+    \param      a_timeInterval  Time elapsed since the previous tick [s].
+    \return     Return the command.
+*/
+//===========================================================================
+const cVector3d& cForceComposer::compose(double a_timeInterval)
+{
+    // first-order low-pass filter; a tick of unknown duration passes the
+    // sum through
+    if ((m_timeConstant > 0.0) && (a_timeInterval > 0.0))
+    {
+        double alpha = a_timeInterval / (m_timeConstant + a_timeInterval);
+        m_filtered.x += alpha * (m_sum.x - m_filtered.x);
+        m_filtered.y += alpha * (m_sum.y - m_filtered.y);
+        m_filtered.z += alpha * (m_sum.z - m_filtered.z);
+    }
+    else
+    {
+        m_filtered = m_sum;
+    }
+
+    // hold the output until the force is small enough to be released
+    // without a jolt
+    if (m_waitForSmallForce)
+    {
+        if (m_filtered.length() > SMALL_FORCE)
+        {
+            m_command.zero();
+            return (m_command);
+        }
+        m_waitForSmallForce = false;
+    }
+
+    m_command = m_filtered;
+
+    // saturate the magnitude, keeping the direction
+    if (m_maxForce > 0.0)
+    {
+        double length = m_command.length();
+        if (length > m_maxForce)
+        {
+            m_command.mul(m_maxForce / length);
+            m_numSaturated++;
+        }
+    }
+
+    return (m_command);
+}
+
+
+//===========================================================================
+/*!
+    Write the last composed command to a device. This is the only device
+    write of a tick.
+
+    \param      a_device  Device of the tool; may be NULL.
+*/
+//===========================================================================
+void cForceComposer::send(cGenericHapticDevice* a_device)
+{
+    if (a_device == NULL) { return; }
+
+    a_device->setForce(m_command);
+}
@@ -0,0 +1,115 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CForceComposer.h
+
+    \brief
+    Accumulates the forces acting on a tool during a haptic tick and turns
+    them into the single command written to the device.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CForceComposerH
+#define CForceComposerH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cForceComposer
+    \brief      One force command per tick, filtered and saturated.
+
+    Each tick starts with begin(); every source of force (the proxy
+    contact, the virtual fixtures, ...) then calls add() with its
+    contribution in device coordinates, compose() low-pass filters the sum
+    and clamps its magnitude to what the device can render, and send()
+    writes the result to the device, once.
+
+    Like cGeneric3dofPointer::applyForces, the composer holds the output at
+    zero after start-up until the composed force first becomes small, so a
+    tool that starts inside an object does not kick the user's hand.
+
+    A composer belongs to one haptics thread.
+*/
+//===========================================================================
+class cForceComposer
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cForceComposer.
+    cForceComposer();
+
+    //! Destructor of cForceComposer.
+    ~cForceComposer() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Set the largest force magnitude [N] (0: none) and the filter cutoff [Hz] (0: no filter).
+    void configure(double a_maxForce, double a_cutoffFrequency);
+
+    //! Hold the output at zero until the composed force becomes small.
+    void reset();
+
+    //! Restart the low-pass filter from zero, so that the force ramps up again.
+    void restartFilter() { m_filtered.zero(); }
+
+    //! Start the accumulation of a tick.
+    void begin() { m_sum.zero(); }
+
+    //! Add a contribution, in device coordinates.
+    void add(const cVector3d& a_force) { m_sum.add(a_force); }
+
+    //! Filter and saturate the sum of the tick; a_timeInterval is the tick duration [s].
+    const cVector3d& compose(double a_timeInterval);
+
+    //! Write the last composed command to a_device (ignored if NULL).
+    void send(cGenericHapticDevice* a_device);
+
+    //! Last composed command.
+    const cVector3d& getCommand() const { return (m_command); }
+
+    //! Number of ticks whose force was clamped to the largest magnitude.
+    unsigned long getNumSaturated() const { return (m_numSaturated); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Sum of the contributions of the current tick.
+    cVector3d m_sum;
+
+    //! Output of the low-pass filter.
+    cVector3d m_filtered;
+
+    //! Command sent to the device.
+    cVector3d m_command;
+
+    //! Largest force magnitude; 0 for none.
+    double m_maxForce;
+
+    //! Time constant of the low-pass filter [s]; 0 for none.
+    double m_timeConstant;
+
+    //! True until the composed force first becomes small.
+    bool m_waitForSmallForce;
+
+    //! Number of saturated ticks.
+    unsigned long m_numSaturated;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
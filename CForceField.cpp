@@ -0,0 +1,363 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CForceField.cpp
+
+    \brief
+    Virtual fixtures (planes, boxes, spheres, rails and attractors) stored
+    as data and evaluated together, four primitives at a time.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CForceField.h"
+#include <float.h>
+#include <math.h>
+//---------------------------------------------------------------------------
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define FORCE_FIELD_USE_SSE
+#include <xmmintrin.h>
+#endif
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of float parameters of each kind of primitive, in the order
+// they are stored in a block
+//   plane:     normal (3), offset, stiffness
+//   box:       min (3), max (3), stiffness
+//   sphere:    center (3), radius, stiffness
+//   rail:      first end (3), second end - first end (3),
+//              1 / squared length, squared range, stiffness
+//   attractor: center (3), squared range, stiffness
+static const int NUM_PARAMETERS[NUM_FORCE_FIELD_TYPES] = { 5, 7, 5, 9, 5 };
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// four floats, held in an SSE register when available
+#ifdef FORCE_FIELD_USE_SSE
+typedef __m128 cFloat4;
+static inline cFloat4 load4(const float* a_p)           { return (_mm_loadu_ps(a_p)); }
+static inline cFloat4 set4(float a_value)               { return (_mm_set1_ps(a_value)); }
+static inline cFloat4 add4(cFloat4 a_a, cFloat4 a_b)    { return (_mm_add_ps(a_a, a_b)); }
+static inline cFloat4 sub4(cFloat4 a_a, cFloat4 a_b)    { return (_mm_sub_ps(a_a, a_b)); }
+static inline cFloat4 mul4(cFloat4 a_a, cFloat4 a_b)    { return (_mm_mul_ps(a_a, a_b)); }
+static inline cFloat4 div4(cFloat4 a_a, cFloat4 a_b)    { return (_mm_div_ps(a_a, a_b)); }
+static inline cFloat4 min4(cFloat4 a_a, cFloat4 a_b)    { return (_mm_min_ps(a_a, a_b)); }
+static inline cFloat4 max4(cFloat4 a_a, cFloat4 a_b)    { return (_mm_max_ps(a_a, a_b)); }
+static inline cFloat4 sqrt4(cFloat4 a_a)                { return (_mm_sqrt_ps(a_a)); }
+static inline cFloat4 selectLessEqual4(cFloat4 a_a, cFloat4 a_b, cFloat4 a_value)
+{
+    return (_mm_and_ps(_mm_cmple_ps(a_a, a_b), a_value));
+}
+static inline float sum4(cFloat4 a_a)
+{
+    float values[4];
+    _mm_storeu_ps(values, a_a);
+    return ((values[0] + values[1]) + (values[2] + values[3]));
+}
+#else
+struct cFloat4 { float v[4]; };
+static inline cFloat4 load4(const float* a_p)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = a_p[i]; } return (r);
+}
+static inline cFloat4 set4(float a_value)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = a_value; } return (r);
+}
+static inline cFloat4 add4(cFloat4 a_a, cFloat4 a_b)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = a_a.v[i] + a_b.v[i]; } return (r);
+}
+static inline cFloat4 sub4(cFloat4 a_a, cFloat4 a_b)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = a_a.v[i] - a_b.v[i]; } return (r);
+}
+static inline cFloat4 mul4(cFloat4 a_a, cFloat4 a_b)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = a_a.v[i] * a_b.v[i]; } return (r);
+}
+static inline cFloat4 div4(cFloat4 a_a, cFloat4 a_b)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = a_a.v[i] / a_b.v[i]; } return (r);
+}
+static inline cFloat4 min4(cFloat4 a_a, cFloat4 a_b)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = (a_a.v[i] < a_b.v[i]) ? a_a.v[i] : a_b.v[i]; } return (r);
+}
+static inline cFloat4 max4(cFloat4 a_a, cFloat4 a_b)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = (a_a.v[i] > a_b.v[i]) ? a_a.v[i] : a_b.v[i]; } return (r);
+}
+static inline cFloat4 sqrt4(cFloat4 a_a)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = sqrtf(a_a.v[i]); } return (r);
+}
+static inline cFloat4 selectLessEqual4(cFloat4 a_a, cFloat4 a_b, cFloat4 a_value)
+{
+    cFloat4 r; for (int i=0; i<4; i++) { r.v[i] = (a_a.v[i] <= a_b.v[i]) ? a_value.v[i] : 0.0f; } return (r);
+}
+static inline float sum4(cFloat4 a_a)
+{
+    return ((a_a.v[0] + a_a.v[1]) + (a_a.v[2] + a_a.v[3]));
+}
+#endif
+
+
+//===========================================================================
+/*!
+    Constructor of cForceField. The field is empty and exerts no force.
+*/
+//===========================================================================
+cForceField::cForceField()
+{
+    clear();
+}
+
+
+//===========================================================================
+/*!
+    Remove every primitive.
+*/
+//===========================================================================
+void cForceField::clear()
+{
+    for (int i=0; i<NUM_FORCE_FIELD_TYPES; i++)
+    {
+        m_blocks[i].clear();
+        m_count[i] = 0;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Append a primitive. A new block of four zeroed entries is started
+    when the last one is full, so unused entries have no stiffness.
+
+    \param      a_type    Kind of primitive.
+    \param      a_values  One value per parameter of the kind.
+*/
+//===========================================================================
+void cForceField::add(cForceFieldType a_type, const float* a_values)
+{
+    int numParameters = NUM_PARAMETERS[a_type];
+    int slot = m_count[a_type] % 4;
+    if (slot == 0)
+    {
+        m_blocks[a_type].resize(m_blocks[a_type].size() + 4 * numParameters, 0.0f);
+    }
+
+    float* block = &m_blocks[a_type][m_blocks[a_type].size() - 4 * numParameters];
+    for (int i=0; i<numParameters; i++)
+    {
+        block[4*i + slot] = a_values[i];
+    }
+    m_count[a_type]++;
+}
+
+
+//===========================================================================
+/*!
+    Add a plane pushing the tool out of the half-space behind it, with a
+    force proportional to the depth of the tool in that half-space.
+
+    \param      a_normal     Normal of the plane, pointing to the free side.
+    \param      a_offset     Plane equation offset: a_normal.p = a_offset.
+    \param      a_stiffness  Stiffness [N/m].
+*/
+//===========================================================================
+void cForceField::addPlane(const cVector3d& a_normal, double a_offset, double a_stiffness)
+{
+    double length = a_normal.length();
+    if (length <= 0.0) { return; }
+
+    float values[5] = { (float)(a_normal.x / length), (float)(a_normal.y / length),
+                        (float)(a_normal.z / length), (float)(a_offset / length),
+                        (float)a_stiffness };
+    add(FORCE_FIELD_PLANE, values);
+}
+
+
+//===========================================================================
+/*!
+    Add a box keeping the tool inside it; each wall pushes back with a
+    force proportional to how far the tool went through it.
+
+    \param      a_min        Lower corner of the box.
+    \param      a_max        Upper corner of the box.
+    \param      a_stiffness  Stiffness [N/m].
+*/
+//===========================================================================
+void cForceField::addBox(const cVector3d& a_min, const cVector3d& a_max, double a_stiffness)
+{
+    float values[7] = { (float)a_min.x, (float)a_min.y, (float)a_min.z,
+                        (float)a_max.x, (float)a_max.y, (float)a_max.z,
+                        (float)a_stiffness };
+    add(FORCE_FIELD_BOX, values);
+}
+
+
+//===========================================================================
+/*!
+    Add a sphere pushing the tool out along the radius, with a force
+    proportional to the depth of the tool in the sphere.
+
+    \param      a_center     Center of the sphere.
+    \param      a_radius     Radius of the sphere.
+    \param      a_stiffness  Stiffness [N/m].
+*/
+//===========================================================================
+void cForceField::addSphere(const cVector3d& a_center, double a_radius, double a_stiffness)
+{
+    float values[5] = { (float)a_center.x, (float)a_center.y, (float)a_center.z,
+                        (float)a_radius, (float)a_stiffness };
+    add(FORCE_FIELD_SPHERE, values);
+}
+
+
+//===========================================================================
+/*!
+    Add a rail pulling the tool towards the closest point of a segment.
+
+    \param      a_pointA     First end of the segment.
+    \param      a_pointB     Second end of the segment.
+    \param      a_range      Largest distance at which the rail acts; 0 for any.
+    \param      a_stiffness  Stiffness [N/m].
+*/
+//===========================================================================
+void cForceField::addRail(const cVector3d& a_pointA, const cVector3d& a_pointB,
+                          double a_range, double a_stiffness)
+{
+    cVector3d direction = cSub(a_pointB, a_pointA);
+    double lengthSq = direction.lengthsq();
+    float values[9] = { (float)a_pointA.x, (float)a_pointA.y, (float)a_pointA.z,
+                        (float)direction.x, (float)direction.y, (float)direction.z,
+                        (lengthSq > 0.0) ? (float)(1.0 / lengthSq) : 0.0f,
+                        (a_range > 0.0) ? (float)(a_range * a_range) : FLT_MAX,
+                        (float)a_stiffness };
+    add(FORCE_FIELD_RAIL, values);
+}
+
+
+//===========================================================================
+/*!
+    Add an attractor pulling the tool towards a point.
+
+    \param      a_center     Point the tool is pulled to.
+    \param      a_range      Largest distance at which the attractor acts; 0 for any.
+    \param      a_stiffness  Stiffness [N/m].
+*/
+//===========================================================================
+void cForceField::addAttractor(const cVector3d& a_center, double a_range, double a_stiffness)
+{
+    float values[5] = { (float)a_center.x, (float)a_center.y, (float)a_center.z,
+                        (a_range > 0.0) ? (float)(a_range * a_range) : FLT_MAX,
+                        (float)a_stiffness };
+    add(FORCE_FIELD_ATTRACTOR, values);
+}
+
+
+//===========================================================================
+/*!
+    Sum the forces of all primitives on a tool. Every block is evaluated
+    whole, the conditions of each primitive becoming clamps and masks.
+
+    \param      a_position  Position of the tool.
+    \return     Return the total force [N].
+*/
+//===========================================================================
+cVector3d cForceField::computeForce(const cVector3d& a_position) const
+{
+    const cFloat4 px = set4((float)a_position.x);
+    const cFloat4 py = set4((float)a_position.y);
+    const cFloat4 pz = set4((float)a_position.z);
+    const cFloat4 zero = set4(0.0f);
+    const cFloat4 one = set4(1.0f);
+    const cFloat4 tiny = set4(1e-12f);
+
+    cFloat4 fx = zero;
+    cFloat4 fy = zero;
+    cFloat4 fz = zero;
+
+    // planes: k * max(offset - n.p, 0) * n
+    const std::vector<float>& planes = m_blocks[FORCE_FIELD_PLANE];
+    for (size_t b=0; b<planes.size(); b+=4*5)
+    {
+        const float* q = &planes[b];
+        cFloat4 nx = load4(q), ny = load4(q+4), nz = load4(q+8);
+        cFloat4 depth = sub4(load4(q+12), add4(add4(mul4(nx, px), mul4(ny, py)), mul4(nz, pz)));
+        cFloat4 scale = mul4(load4(q+16), max4(depth, zero));
+        fx = add4(fx, mul4(scale, nx));
+        fy = add4(fy, mul4(scale, ny));
+        fz = add4(fz, mul4(scale, nz));
+    }
+
+    // boxes: -k * (max(p - max, 0) + min(p - min, 0)) on each axis
+    const std::vector<float>& boxes = m_blocks[FORCE_FIELD_BOX];
+    for (size_t b=0; b<boxes.size(); b+=4*7)
+    {
+        const float* q = &boxes[b];
+        cFloat4 k = load4(q+24);
+        cFloat4 ex = add4(max4(sub4(px, load4(q+12)), zero), min4(sub4(px, load4(q)), zero));
+        cFloat4 ey = add4(max4(sub4(py, load4(q+16)), zero), min4(sub4(py, load4(q+4)), zero));
+        cFloat4 ez = add4(max4(sub4(pz, load4(q+20)), zero), min4(sub4(pz, load4(q+8)), zero));
+        fx = sub4(fx, mul4(k, ex));
+        fy = sub4(fy, mul4(k, ey));
+        fz = sub4(fz, mul4(k, ez));
+    }
+
+    // spheres: k * max(r - |p - c|, 0) along (p - c)
+    const std::vector<float>& spheres = m_blocks[FORCE_FIELD_SPHERE];
+    for (size_t b=0; b<spheres.size(); b+=4*5)
+    {
+        const float* q = &spheres[b];
+        cFloat4 dx = sub4(px, load4(q)), dy = sub4(py, load4(q+4)), dz = sub4(pz, load4(q+8));
+        cFloat4 distance = sqrt4(add4(add4(mul4(dx, dx), mul4(dy, dy)), mul4(dz, dz)));
+        cFloat4 depth = max4(sub4(load4(q+12), distance), zero);
+        cFloat4 scale = div4(mul4(load4(q+16), depth), max4(distance, tiny));
+        fx = add4(fx, mul4(scale, dx));
+        fy = add4(fy, mul4(scale, dy));
+        fz = add4(fz, mul4(scale, dz));
+    }
+
+    // rails: k * (closest point of the segment - p), within range
+    const std::vector<float>& rails = m_blocks[FORCE_FIELD_RAIL];
+    for (size_t b=0; b<rails.size(); b+=4*9)
+    {
+        const float* q = &rails[b];
+        cFloat4 ax = load4(q), ay = load4(q+4), az = load4(q+8);
+        cFloat4 ux = load4(q+12), uy = load4(q+16), uz = load4(q+20);
+        cFloat4 wx = sub4(px, ax), wy = sub4(py, ay), wz = sub4(pz, az);
+        cFloat4 t = mul4(add4(add4(mul4(wx, ux), mul4(wy, uy)), mul4(wz, uz)), load4(q+24));
+        t = min4(max4(t, zero), one);
+        cFloat4 dx = sub4(mul4(t, ux), wx), dy = sub4(mul4(t, uy), wy), dz = sub4(mul4(t, uz), wz);
+        cFloat4 distanceSq = add4(add4(mul4(dx, dx), mul4(dy, dy)), mul4(dz, dz));
+        cFloat4 k = selectLessEqual4(distanceSq, load4(q+28), load4(q+32));
+        fx = add4(fx, mul4(k, dx));
+        fy = add4(fy, mul4(k, dy));
+        fz = add4(fz, mul4(k, dz));
+    }
+
+    // attractors: k * (c - p), within range
+    const std::vector<float>& attractors = m_blocks[FORCE_FIELD_ATTRACTOR];
+    for (size_t b=0; b<attractors.size(); b+=4*5)
+    {
+        const float* q = &attractors[b];
+        cFloat4 dx = sub4(load4(q), px), dy = sub4(load4(q+4), py), dz = sub4(load4(q+8), pz);
+        cFloat4 distanceSq = add4(add4(mul4(dx, dx), mul4(dy, dy)), mul4(dz, dz));
+        cFloat4 k = selectLessEqual4(distanceSq, load4(q+12), load4(q+16));
+        fx = add4(fx, mul4(k, dx));
+        fy = add4(fy, mul4(k, dy));
+        fz = add4(fz, mul4(k, dz));
+    }
+
+    return (cVector3d(sum4(fx), sum4(fy), sum4(fz)));
+}
@@ -0,0 +1,131 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CForceField.h
+
+    \brief
+    Virtual fixtures (planes, boxes, spheres, rails and attractors) stored
+    as data and evaluated together, four primitives at a time.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CForceFieldH
+#define CForceFieldH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// kinds of primitives of a force field
+enum cForceFieldType
+{
+    // pushes the tool out of the half-space behind a plane
+    FORCE_FIELD_PLANE = 0,
+
+    // keeps the tool inside a box, like four (or six) walls
+    FORCE_FIELD_BOX,
+
+    // pushes the tool out of a sphere
+    FORCE_FIELD_SPHERE,
+
+    // pulls the tool onto a segment
+    FORCE_FIELD_RAIL,
+
+    // pulls the tool towards a point
+    FORCE_FIELD_ATTRACTOR,
+
+    NUM_FORCE_FIELD_TYPES
+};
+
+
+//===========================================================================
+/*!
+    \class      cForceField
+    \brief      A set of spring primitives acting on the tool position.
+
+    Primitives are stored per kind in blocks of four, each block holding
+    one array of four floats per parameter. computeForce() walks the
+    blocks in order and evaluates four primitives per SSE instruction (a
+    scalar loop on other processors), without branches, so its cost grows
+    with the number of blocks only. Unused entries of the last block of a
+    kind have no stiffness and add nothing.
+
+    Primitives are added while the scene is built; computeForce() only
+    reads, so the haptics threads of several devices may share a field.
+*/
+//===========================================================================
+class cForceField
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cForceField.
+    cForceField();
+
+    //! Destructor of cForceField.
+    ~cForceField() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Push the tool out of the half-space {p : a_normal.p < a_offset}.
+    void addPlane(const cVector3d& a_normal, double a_offset, double a_stiffness);
+
+    //! Keep the tool inside the box [a_min, a_max].
+    void addBox(const cVector3d& a_min, const cVector3d& a_max, double a_stiffness);
+
+    //! Push the tool out of a sphere.
+    void addSphere(const cVector3d& a_center, double a_radius, double a_stiffness);
+
+    //! Pull the tool onto the segment [a_pointA, a_pointB] when within a_range (0: everywhere).
+    void addRail(const cVector3d& a_pointA, const cVector3d& a_pointB,
+                 double a_range, double a_stiffness);
+
+    //! Pull the tool towards a_center when within a_range (0: everywhere).
+    void addAttractor(const cVector3d& a_center, double a_range, double a_stiffness);
+
+    //! Remove every primitive.
+    void clear();
+
+    //! Number of primitives of a kind.
+    int getNumPrimitives(cForceFieldType a_type) const { return (m_count[a_type]); }
+
+    //! Force of all primitives on a tool at a_position.
+    cVector3d computeForce(const cVector3d& a_position) const;
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Append a primitive of a kind; a_values holds one value per parameter.
+    void add(cForceFieldType a_type, const float* a_values);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Blocks of four primitives of each kind.
+    std::vector<float> m_blocks[NUM_FORCE_FIELD_TYPES];
+
+    //! Number of primitives of each kind.
+    int m_count[NUM_FORCE_FIELD_TYPES];
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,149 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CFramePacer.cpp
+
+    \brief
+    Frame limiter and render-on-change decision for the graphics loop.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CFramePacer.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// frames rendered after the last change, until the camera image nested in
+// the cube texture is too small to show the change
+const int FRAME_SETTLE_FRAMES   = 8;
+
+// longest time without a frame in render-on-change mode [s]
+const double FRAME_MAX_IDLE     = 0.5;
+
+// shortest interval between two checks for changes [s]
+const double FRAME_POLL_PERIOD  = 0.001;
+
+// duration of a frame rate measurement window [s]
+const double FRAME_STATS_WINDOW = 1.0;
+
+
+//===========================================================================
+/*!
+    Constructor of cFramePacer. The first frame is due immediately.
+
+    \param      a_rate  Target frame rate in Hz, 0 for no limit.
+*/
+//===========================================================================
+cFramePacer::cFramePacer(double a_rate)
+{
+    m_renderOnChange = false;
+    m_invalid = true;
+    m_settleFrames = 0;
+    m_numRendered = 0;
+    m_numSkipped = 0;
+    m_windowStart = 0.0;
+    m_windowFrames = 0;
+    m_frameRate = 0.0;
+    m_deadline = 0.0;
+    m_lastFrame = 0.0;
+    m_clock.start(true);
+    setRate(a_rate);
+}
+
+
+//===========================================================================
+/*!
+    Set the target frame rate. The next frame is due immediately.
+
+    \param      a_rate  Target frame rate in Hz, 0 for no limit.
+*/
+//===========================================================================
+void cFramePacer::setRate(double a_rate)
+{
+    m_rate = cMax(a_rate, 0.0);
+    m_period = (m_rate > 0.0) ? 1.0 / m_rate : 0.0;
+    m_deadline = m_clock.getCurrentTimeSeconds();
+}
+
+
+//===========================================================================
+/*!
+    Decide whether the frame due now must be rendered. Outside of
+    render-on-change mode it always is. A skipped frame is counted and the
+    next check is scheduled one period later.
+
+    \param      a_changed  True if the displayed poses changed since the
+                           previous call.
+    \return     Return true if a frame must be rendered.
+*/
+//===========================================================================
+bool cFramePacer::needFrame(bool a_changed)
+{
+    if (a_changed)
+    {
+        m_settleFrames = FRAME_SETTLE_FRAMES;
+    }
+
+    double now = m_clock.getCurrentTimeSeconds();
+    if (!m_renderOnChange || m_invalid || (m_settleFrames > 0) ||
+        (now - m_lastFrame >= FRAME_MAX_IDLE))
+    {
+        return (true);
+    }
+
+    m_numSkipped++;
+    m_deadline = now + cMax(m_period, FRAME_POLL_PERIOD);
+    return (false);
+}
+
+
+//===========================================================================
+/*!
+    Account for a frame whose buffers were just swapped, update the frame
+    rate and schedule the deadline of the next frame.
+*/
+//===========================================================================
+void cFramePacer::frameRendered()
+{
+    double now = m_clock.getCurrentTimeSeconds();
+
+    m_invalid = false;
+    if (m_settleFrames > 0) { m_settleFrames--; }
+    m_numRendered++;
+    m_lastFrame = now;
+
+    // frame rate over the last window
+    m_windowFrames++;
+    if (now - m_windowStart >= FRAME_STATS_WINDOW)
+    {
+        m_frameRate = (double)m_windowFrames / (now - m_windowStart);
+        m_windowStart = now;
+        m_windowFrames = 0;
+    }
+
+    // next deadline; a frame more than one period late (a slow frame, or
+    // a swap waiting for a display slower than the target) restarts the
+    // deadlines from now
+    m_deadline += m_period;
+    if (m_deadline + m_period < now)
+    {
+        m_deadline = now;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Time left until the next frame is due, or the next check for changes.
+
+    \return     Return the delay [s], 0 if the frame is already due.
+*/
+//===========================================================================
+double cFramePacer::getDelay()
+{
+    return (cMax(m_deadline - m_clock.getCurrentTimeSeconds(), 0.0));
+}
@@ -0,0 +1,132 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CFramePacer.h
+
+    \brief
+    Frame limiter and render-on-change decision for the graphics loop.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CFramePacerH
+#define CFramePacerH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cFramePacer
+    \brief      Decides when the graphics loop renders its next frame.
+
+    Frames are spaced on deadlines one period apart, like the ticks of
+    cHapticScheduler. getDelay() is the time left until the next deadline,
+    measured after the buffers were swapped: when the swap waits for the
+    vertical sync, the display already paced the frame and no delay is
+    added on top, so a target above the refresh rate of the display falls
+    back to vsync. A frame more than one period late restarts the
+    deadlines instead of being caught up in a burst.
+
+    In render-on-change mode, needFrame() skips the frames where neither
+    the poses nor the window changed. The camera image is shown on the
+    cube, so a change keeps frames coming for a few more frames, until the
+    nested images have caught up; a frame is also rendered at least twice
+    per second to keep the labels current.
+
+    All methods must be called from the graphics thread.
+*/
+//===========================================================================
+class cFramePacer
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cFramePacer.
+    cFramePacer(double a_rate = 0.0);
+
+    //! Destructor of cFramePacer.
+    ~cFramePacer() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Set the target frame rate in Hz (0 for no limit).
+    void setRate(double a_rate);
+
+    //! Target frame rate in Hz.
+    double getRate() const { return (m_rate); }
+
+    //! Only render frames when something changed.
+    void setRenderOnChange(bool a_renderOnChange) { m_renderOnChange = a_renderOnChange; invalidate(); }
+
+    //! True in render-on-change mode.
+    bool getRenderOnChange() const { return (m_renderOnChange); }
+
+    //! Force the next frame, e.g. after the window changed.
+    void invalidate() { m_invalid = true; }
+
+    //! True if a frame must be rendered; a_changed tells whether the poses changed.
+    bool needFrame(bool a_changed);
+
+    //! Account for a frame just presented and schedule the next deadline.
+    void frameRendered();
+
+    //! Time left until the next frame or poll [s].
+    double getDelay();
+
+    //! Frame rate measured over the last second [Hz].
+    double getFrameRate() const { return (m_frameRate); }
+
+    //! Number of frames rendered.
+    unsigned long getNumRendered() const { return (m_numRendered); }
+
+    //! Number of frames skipped because nothing changed.
+    unsigned long getNumSkipped() const { return (m_numSkipped); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Target frame rate and period; 0 for no limit.
+    double m_rate;
+    double m_period;
+
+    //! Render-on-change mode.
+    bool m_renderOnChange;
+
+    //! True if the next frame must be rendered.
+    bool m_invalid;
+
+    //! Frames still to render after the last change.
+    int m_settleFrames;
+
+    //! Clock measuring time since construction.
+    cPrecisionClock m_clock;
+
+    //! Next deadline and time of the last frame [s].
+    double m_deadline;
+    double m_lastFrame;
+
+    //! Totals.
+    unsigned long m_numRendered;
+    unsigned long m_numSkipped;
+
+    //! Frame rate measurement window.
+    double m_windowStart;
+    unsigned long m_windowFrames;
+    double m_frameRate;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CFrameUpdater.cpp
+
+    \brief
+    Incremental update of the global frames of a scene graph: only the
+    subtrees of the objects that moved are recomputed.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CFrameUpdater.h"
+#include <algorithm>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cFrameUpdater. Room for a few dirty objects is reserved
+    so that marking does not allocate in the usual case.
+*/
+//===========================================================================
+cFrameUpdater::cFrameUpdater()
+{
+    m_dirty.reserve(64);
+}
+
+
+//===========================================================================
+/*!
+    Record that the local position or rotation of an object changed.
+    Marking an object more than once before update() has no further effect.
+
+    \param      a_object  Object that moved.
+*/
+//===========================================================================
+void cFrameUpdater::markDirty(cGenericObject* a_object)
+{
+    if (a_object == NULL) { return; }
+
+    if (std::find(m_dirty.begin(), m_dirty.end(), a_object) == m_dirty.end())
+    {
+        m_dirty.push_back(a_object);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Recompute the global frames of every dirty object and its descendants,
+    then clear the dirty list.
+
+    \return     Return the number of subtrees recomputed.
+*/
+//===========================================================================
+int cFrameUpdater::update()
+{
+    int numUpdated = 0;
+
+    for (unsigned int i=0; i<m_dirty.size(); i++)
+    {
+        cGenericObject* object = m_dirty[i];
+
+        // covered by the recursion from a dirty ancestor
+        if (hasDirtyAncestor(object)) { continue; }
+
+        // start from the global frame of the parent, which did not move
+        cGenericObject* parent = object->getParent();
+        if (parent != NULL)
+        {
+            object->computeGlobalPositions(true, parent->getGlobalPos(), parent->getGlobalRot());
+        }
+        else
+        {
+            object->computeGlobalPositions(true, cVector3d(0.0, 0.0, 0.0), cIdentity3d());
+        }
+        numUpdated++;
+    }
+
+    m_dirty.clear();
+
+    return (numUpdated);
+}
+
+
+//===========================================================================
+/*!
+    Check whether an ancestor of an object is marked as well.
+
+    \param      a_object  Object to check.
+    \return     Return true if a parent, grand-parent... is dirty.
+*/
+//===========================================================================
+bool cFrameUpdater::hasDirtyAncestor(cGenericObject* a_object) const
+{
+    cGenericObject* ancestor = a_object->getParent();
+    while (ancestor != NULL)
+    {
+        if (std::find(m_dirty.begin(), m_dirty.end(), ancestor) != m_dirty.end())
+        {
+            return (true);
+        }
+        ancestor = ancestor->getParent();
+    }
+    return (false);
+}
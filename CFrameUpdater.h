@@ -0,0 +1,91 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CFrameUpdater.h
+
+    \brief
+    Incremental update of the global frames of a scene graph: only the
+    subtrees of the objects that moved are recomputed.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CFrameUpdaterH
+#define CFrameUpdaterH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cFrameUpdater
+    \brief      Replaces cWorld::computeGlobalPositions() on every tick by a
+                recomputation of the moved subtrees only.
+
+    The code moving an object calls markDirty() after setPos() or setRot().
+    update() then recomputes the global frame of each dirty object and of
+    its descendants from the global frame of its parent, which is up to
+    date since the parent did not move. A dirty object below another dirty
+    object is skipped, since the recursion from the ancestor covers it.
+
+    The cost of update() depends on the moved subtrees only, not on the
+    size of the scene. Objects moved without markDirty() keep a stale
+    global frame until an ancestor is marked or the whole world is
+    recomputed, so every setPos() on a live object must be paired with a
+    markDirty().
+
+    An updater belongs to the thread owning its world.
+*/
+//===========================================================================
+class cFrameUpdater
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cFrameUpdater.
+    cFrameUpdater();
+
+    //! Destructor of cFrameUpdater.
+    ~cFrameUpdater() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Record that the local frame of an object changed.
+    void markDirty(cGenericObject* a_object);
+
+    //! Recompute the global frames of the dirty subtrees; returns their number.
+    int update();
+
+    //! Number of objects marked since the last update().
+    int getNumDirty() const { return ((int)m_dirty.size()); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! True if an ancestor of a_object is marked as well.
+    bool hasDirtyAncestor(cGenericObject* a_object) const;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Objects marked since the last update(), without duplicates.
+    std::vector<cGenericObject*> m_dirty;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
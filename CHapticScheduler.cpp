@@ -0,0 +1,183 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CHapticScheduler.cpp
+
+    \brief
+    Deadline-driven pacing of the haptic loop with overrun and lateness
+    accounting.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CHapticScheduler.h"
+//---------------------------------------------------------------------------
+#include <chrono>
+#include <thread>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// time before a deadline below which the scheduler busy-waits instead of
+// sleeping, covering the wake-up latency of the OS [s]
+const double SCHEDULER_SPIN_TIME     = 0.0002;
+
+// duration of a statistics reporting window [s]
+const double SCHEDULER_STATS_WINDOW  = 1.0;
+
+
+//===========================================================================
+/*!
+    Constructor of cHapticScheduler.
+
+    \param      a_rate  Tick rate in Hz, 0 to free-run.
+*/
+//===========================================================================
+cHapticScheduler::cHapticScheduler(double a_rate)
+{
+    m_requestedRate.store(a_rate);
+    start();
+}
+
+
+//===========================================================================
+/*!
+    Reset the deadlines and the statistics. The first deadline is one
+    period from now. Called from the thread running the loop, whose
+    resource usage the statistics follow.
+*/
+//===========================================================================
+void cHapticScheduler::start()
+{
+    m_rate = m_requestedRate.load();
+    m_period = (m_rate > 0.0) ? 1.0 / m_rate : 0.0;
+
+    m_clock.reset();
+    m_clock.start();
+
+    m_deadline = m_period;
+    m_previousTick = 0.0;
+    m_lastLateness = 0.0;
+    m_lastOverrun = false;
+    m_numTicks = 0;
+    m_numOverruns = 0;
+
+    m_windowStart = 0.0;
+    m_windowTicks = 0;
+    m_windowLateness = 0.0;
+    m_windowMaxLateness = 0.0;
+    getThreadUsage(m_windowUsage);
+}
+
+
+//===========================================================================
+/*!
+    Wait until the next deadline, then schedule the following one.
+
+    \return     Time elapsed since the previous tick started [s].
+*/
+//===========================================================================
+double cHapticScheduler::waitForNextTick()
+{
+    // pick up a rate change requested by another thread
+    double rate = m_requestedRate.load();
+    if (rate != m_rate)
+    {
+        m_rate = rate;
+        m_period = (m_rate > 0.0) ? 1.0 / m_rate : 0.0;
+        m_deadline = m_clock.getCurrentTimeSeconds() + m_period;
+    }
+
+    double now = m_clock.getCurrentTimeSeconds();
+    double lateness = 0.0;
+    bool overrun = false;
+
+    if (m_period > 0.0)
+    {
+        // sleep while the deadline is far away
+        double remaining = m_deadline - now;
+        if (remaining > SCHEDULER_SPIN_TIME)
+        {
+            long sleepUs = (long)(1.0e6 * (remaining - SCHEDULER_SPIN_TIME));
+            std::this_thread::sleep_for(std::chrono::microseconds(sleepUs));
+        }
+
+        // spin for the rest
+        now = m_clock.getCurrentTimeSeconds();
+        while (now < m_deadline)
+        {
+            now = m_clock.getCurrentTimeSeconds();
+        }
+
+        lateness = now - m_deadline;
+
+        // drop the deadlines we missed entirely
+        if (lateness > m_period)
+        {
+            overrun = true;
+            m_deadline += floor(lateness / m_period) * m_period;
+        }
+        m_deadline += m_period;
+    }
+
+    double timeInterval = now - m_previousTick;
+    m_previousTick = now;
+
+    account(now, lateness, overrun);
+
+    return (timeInterval);
+}
+
+
+//===========================================================================
+/*!
+    Accumulate the statistics of the tick that just started, and publish
+    them once per reporting window.
+
+    \param      a_now       Start time of the tick [s].
+    \param      a_lateness  Delay between deadline and tick start [s].
+    \param      a_overrun   True if at least one deadline was missed.
+*/
+//===========================================================================
+void cHapticScheduler::account(double a_now, double a_lateness, bool a_overrun)
+{
+    m_lastLateness = a_lateness;
+    m_lastOverrun = a_overrun;
+
+    m_numTicks++;
+    if (a_overrun) { m_numOverruns++; }
+
+    m_windowTicks++;
+    m_windowLateness += a_lateness;
+    if (a_lateness > m_windowMaxLateness) { m_windowMaxLateness = a_lateness; }
+
+    double windowTime = a_now - m_windowStart;
+    if (windowTime >= SCHEDULER_STATS_WINDOW)
+    {
+        cSchedulerStats& stats = m_stats.writeBuffer();
+        stats.m_rate = (double)m_windowTicks / windowTime;
+        stats.m_targetRate = m_rate;
+        stats.m_numTicks = m_numTicks;
+        stats.m_numOverruns = m_numOverruns;
+        stats.m_meanLateness = m_windowLateness / (double)m_windowTicks;
+        stats.m_maxLateness = m_windowMaxLateness;
+
+        // one system call per window
+        cThreadUsage usage;
+        getThreadUsage(usage);
+        stats.m_pageFaultRate = (double)((usage.m_minorFaults - m_windowUsage.m_minorFaults) +
+                                         (usage.m_majorFaults - m_windowUsage.m_majorFaults)) / windowTime;
+        stats.m_switchRate = (double)(usage.m_voluntarySwitches - m_windowUsage.m_voluntarySwitches) / windowTime;
+        stats.m_preemptionRate = (double)(usage.m_involuntarySwitches - m_windowUsage.m_involuntarySwitches) / windowTime;
+        m_windowUsage = usage;
+        m_stats.publish();
+
+        m_windowStart = a_now;
+        m_windowTicks = 0;
+        m_windowLateness = 0.0;
+        m_windowMaxLateness = 0.0;
+    }
+}
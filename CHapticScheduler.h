@@ -0,0 +1,176 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CHapticScheduler.h
+
+    \brief
+    Deadline-driven pacing of the haptic loop with overrun and lateness
+    accounting.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CHapticSchedulerH
+#define CHapticSchedulerH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTripleBuffer.h"
+#include "Realtime.h"
+#include <atomic>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// timing statistics of the haptic loop over the last reporting window
+struct cSchedulerStats
+{
+    cSchedulerStats() : m_rate(0.0), m_targetRate(0.0), m_numTicks(0),
+                        m_numOverruns(0), m_meanLateness(0.0), m_maxLateness(0.0),
+                        m_pageFaultRate(0.0), m_switchRate(0.0), m_preemptionRate(0.0) {}
+
+    // achieved and requested tick rate [Hz]; a requested rate of 0 means
+    // the loop free-runs
+    double m_rate;
+    double m_targetRate;
+
+    // ticks run and deadlines missed since the scheduler was started
+    unsigned long m_numTicks;
+    unsigned long m_numOverruns;
+
+    // mean and largest delay between a deadline and the tick start [s]
+    double m_meanLateness;
+    double m_maxLateness;
+
+    // page faults, context switches and preemptions of the thread running
+    // the loop, per second; 0 where the platform does not report them
+    double m_pageFaultRate;
+    double m_switchRate;
+    double m_preemptionRate;
+};
+
+
+//===========================================================================
+/*!
+    \class      cHapticScheduler
+    \brief      Paces a loop on absolute deadlines at a configurable rate.
+
+    Deadlines are spaced by exactly one period from the time start() was
+    called, so errors do not accumulate. waitForNextTick() sleeps while the
+    next deadline is far away, then busy-waits on a cPrecisionClock for the
+    last fraction of the period, which leaves the core free for rendering
+    without paying the wake-up jitter of the OS scheduler.
+
+    A tick that starts more than one period late is an overrun: the missed
+    deadlines are dropped instead of being caught up in a burst.
+
+    Each reporting window also counts the page faults and context switches
+    of the thread running the loop, which a real-time thread should keep
+    near zero.
+
+    With a rate of 0 the scheduler does not wait at all and the loop
+    free-runs, which is the historical behavior.
+
+    setRate() may be called from any thread; every other method must be
+    called from the thread running the loop.
+*/
+//===========================================================================
+class cHapticScheduler
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cHapticScheduler.
+    cHapticScheduler(double a_rate = 0.0);
+
+    //! Destructor of cHapticScheduler.
+    ~cHapticScheduler() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Set the tick rate in Hz (0 to free-run). Takes effect at the next tick.
+    void setRate(double a_rate) { m_requestedRate.store(a_rate); }
+
+    //! Requested tick rate in Hz.
+    double getRate() const { return (m_requestedRate.load()); }
+
+    //! Reset the deadlines and the statistics (from the thread running the loop).
+    void start();
+
+    //! Wait until the next deadline; returns the time since the previous tick [s].
+    double waitForNextTick();
+
+    //! Delay between the last deadline and the start of the last tick [s].
+    double getLastLateness() const { return (m_lastLateness); }
+
+    //! True if the last tick started more than one period late.
+    bool getLastOverrun() const { return (m_lastOverrun); }
+
+    //! Number of ticks since start().
+    unsigned long getNumTicks() const { return (m_numTicks); }
+
+    //! Number of overruns since start().
+    unsigned long getNumOverruns() const { return (m_numOverruns); }
+
+    //! Statistics over the last reporting window (one reader thread only).
+    cSchedulerStats readStats() { return (m_stats.read()); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Accumulate statistics of the tick that just started.
+    void account(double a_now, double a_lateness, bool a_overrun);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Rate requested through setRate().
+    std::atomic<double> m_requestedRate;
+
+    //! Rate and period currently in use.
+    double m_rate;
+    double m_period;
+
+    //! Clock measuring time since start().
+    cPrecisionClock m_clock;
+
+    //! Next deadline and start of the previous tick [s].
+    double m_deadline;
+    double m_previousTick;
+
+    //! Timing of the last tick.
+    double m_lastLateness;
+    bool m_lastOverrun;
+
+    //! Totals since start().
+    unsigned long m_numTicks;
+    unsigned long m_numOverruns;
+
+    //! Accumulators of the current reporting window.
+    double m_windowStart;
+    unsigned long m_windowTicks;
+    double m_windowLateness;
+    double m_windowMaxLateness;
+    cThreadUsage m_windowUsage;
+
+    //! Statistics of the last complete window.
+    cTripleBuffer<cSchedulerStats> m_stats;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,101 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CHapticWatchdog.cpp
+
+    \brief
+    Watchdog stopping the force of a device whose haptic tick stalls.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CHapticWatchdog.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cHapticWatchdog.
+
+    \param      a_timeout  Duration after which a tick is stalled [s].
+*/
+//===========================================================================
+cHapticWatchdog::cHapticWatchdog(double a_timeout)
+{
+    m_timeout = a_timeout;
+    m_handler = NULL;
+    m_clock.start(true);
+}
+
+
+//===========================================================================
+/*!
+    Record the start of a tick. Called by the haptics thread of the
+    channel.
+
+    \param      a_channel  Channel of the haptics thread.
+*/
+//===========================================================================
+void cHapticWatchdog::tickStarted(int a_channel)
+{
+    m_channels[a_channel].m_tickStart.store(m_clock.getCurrentTimeSeconds(), std::memory_order_release);
+}
+
+
+//===========================================================================
+/*!
+    Record the end of a tick. Called by the haptics thread of the channel.
+
+    \param      a_channel  Channel of the haptics thread.
+*/
+//===========================================================================
+void cHapticWatchdog::tickFinished(int a_channel)
+{
+    cWatchdogChannel& channel = m_channels[a_channel];
+    channel.m_tickStart.store(-1.0, std::memory_order_release);
+    channel.m_stalled.store(false, std::memory_order_release);
+}
+
+
+//===========================================================================
+/*!
+    Look for ticks running for longer than the timeout, and call the
+    handler once for each new stall. Called by the watchdog thread.
+
+    \return     Return the number of channels found stalled by this call.
+*/
+//===========================================================================
+int cHapticWatchdog::check()
+{
+    double now = m_clock.getCurrentTimeSeconds();
+    int numStalled = 0;
+
+    for (int i=0; i<MAX_PHYSICS_CHANNELS; i++)
+    {
+        cWatchdogChannel& channel = m_channels[i];
+
+        double tickStart = channel.m_tickStart.load(std::memory_order_acquire);
+        if ((tickStart < 0.0) || (now - tickStart <= m_timeout)) { continue; }
+
+        // report each stall once; the haptics thread clears the flag when
+        // the tick ends
+        if (channel.m_stalled.exchange(true)) { continue; }
+
+        // the tick may have ended, and the next one started, since the
+        // time stamp was read
+        if (channel.m_tickStart.load(std::memory_order_acquire) != tickStart)
+        {
+            channel.m_stalled.store(false);
+            continue;
+        }
+
+        channel.m_numStalls.fetch_add(1, std::memory_order_relaxed);
+        numStalled++;
+        if (m_handler != NULL)
+        {
+            m_handler(i);
+        }
+    }
+
+    return (numStalled);
+}
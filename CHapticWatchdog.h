@@ -0,0 +1,141 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CHapticWatchdog.h
+
+    \brief
+    Watchdog stopping the force of a device whose haptic tick stalls.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CHapticWatchdogH
+#define CHapticWatchdogH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CRailPhysics.h"
+#include <atomic>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// default duration of a tick after which it is considered stalled [s]
+const double WATCHDOG_DEFAULT_TIMEOUT = 0.002;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// called by the watchdog thread when the tick of a channel stalls; must
+// bring the force of the device of that channel to zero without waiting
+// for its haptics thread
+typedef void (*cWatchdogHandler)(int a_channel);
+
+
+//===========================================================================
+/*!
+    \class      cHapticWatchdog
+    \brief      Detects haptic ticks that take too long.
+
+    Each haptics thread brackets its tick with tickStarted() and
+    tickFinished(), which only store a time stamp. A watchdog thread calls
+    check() at a rate well above 1 / timeout; when a tick has been running
+    for longer than the timeout, the handler is called once for that
+    stall, from the watchdog thread, while the haptics thread is still
+    stuck (in a collision query or a blocking transfer, say).
+
+    The handler runs concurrently with the stuck haptics thread: it must
+    only touch state meant to be shared, such as an atomic flag or the
+    hold of a pipelined device.
+*/
+//===========================================================================
+class cHapticWatchdog
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cHapticWatchdog.
+    cHapticWatchdog(double a_timeout = WATCHDOG_DEFAULT_TIMEOUT);
+
+    //! Destructor of cHapticWatchdog.
+    ~cHapticWatchdog() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - SETUP:
+    //-----------------------------------------------------------------------
+
+    //! Set the handler called on a stall (before the threads start).
+    void setHandler(cWatchdogHandler a_handler) { m_handler = a_handler; }
+
+    //! Set the duration after which a tick is stalled [s] (before the threads start).
+    void setTimeout(double a_timeout) { m_timeout = a_timeout; }
+
+    //! Duration after which a tick is stalled [s].
+    double getTimeout() const { return (m_timeout); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - HAPTICS THREADS:
+    //-----------------------------------------------------------------------
+
+    //! Record the start of a tick of a channel.
+    void tickStarted(int a_channel);
+
+    //! Record the end of a tick of a channel.
+    void tickFinished(int a_channel);
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - WATCHDOG THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Call the handler for every channel whose tick just stalled; returns their number.
+    int check();
+
+    //! Number of stalls of a channel.
+    unsigned long getNumStalls(int a_channel) const { return (m_channels[a_channel].m_numStalls.load(std::memory_order_relaxed)); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! State of a channel.
+    struct cWatchdogChannel
+    {
+        cWatchdogChannel() : m_tickStart(-1.0), m_stalled(false), m_numStalls(0) {}
+
+        // start of the current tick [s]; negative between ticks
+        std::atomic<double> m_tickStart;
+
+        // set by the watchdog when the current tick stalled
+        std::atomic<bool> m_stalled;
+
+        // number of stalls
+        std::atomic<unsigned long> m_numStalls;
+    };
+    cWatchdogChannel m_channels[MAX_PHYSICS_CHANNELS];
+
+    //! Duration after which a tick is stalled [s].
+    double m_timeout;
+
+    //! Handler called on a stall.
+    cWatchdogHandler m_handler;
+
+    //! Clock shared by the haptics threads and the watchdog thread.
+    cPrecisionClock m_clock;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
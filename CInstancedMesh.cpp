@@ -0,0 +1,413 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CInstancedMesh.cpp
+
+    \brief
+    One geometry drawn at many poses with a single instanced draw call.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "GLEntryPoints.h"
+#include "CInstancedMesh.h"
+//---------------------------------------------------------------------------
+#include <stddef.h>
+#include <stdio.h>
+//---------------------------------------------------------------------------
+#if (defined(_LINUX) || defined(_MACOSX)) && defined(GL_ARRAY_BUFFER)
+#define INSTANCED_MESH_USE_BUFFERS
+#endif
+#if defined(INSTANCED_MESH_USE_BUFFERS) && defined(GL_VERSION_3_3)
+#define INSTANCED_MESH_USE_INSTANCING
+#endif
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of lights the shader looks at, the least OpenGL provides
+const int INSTANCED_MESH_NUM_LIGHTS = 8;
+
+#ifdef INSTANCED_MESH_USE_INSTANCING
+// places the vertex with the pose of its instance, then lights it as the
+// fixed pipeline does with a local viewer off
+static const char* INSTANCED_MESH_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute mat4 a_frame;\n"
+    "uniform bool u_lighting;\n"
+    "uniform bool u_lights[8];\n"
+    "varying vec4 v_color;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 eyePos = gl_ModelViewMatrix * (a_frame * gl_Vertex);\n"
+    "    gl_Position = gl_ProjectionMatrix * eyePos;\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    if (!u_lighting) { v_color = gl_Color; return; }\n"
+    "    vec3 normal = normalize(gl_NormalMatrix * (mat3(a_frame) * gl_Normal));\n"
+    "    vec4 color = gl_FrontLightModelProduct.sceneColor;\n"
+    "    for (int i=0; i<8; i++)\n"
+    "    {\n"
+    "        if (!u_lights[i]) { continue; }\n"
+    "        vec3 toLight = gl_LightSource[i].position.xyz;\n"
+    "        float attenuation = 1.0;\n"
+    "        if (gl_LightSource[i].position.w != 0.0)\n"
+    "        {\n"
+    "            toLight -= eyePos.xyz;\n"
+    "            float d = length(toLight);\n"
+    "            attenuation = 1.0 / (gl_LightSource[i].constantAttenuation +\n"
+    "                                 gl_LightSource[i].linearAttenuation * d +\n"
+    "                                 gl_LightSource[i].quadraticAttenuation * d * d);\n"
+    "        }\n"
+    "        toLight = normalize(toLight);\n"
+    "        vec4 lit = gl_FrontLightProduct[i].ambient;\n"
+    "        float diffuse = dot(normal, toLight);\n"
+    "        if (diffuse > 0.0)\n"
+    "        {\n"
+    "            float specular = max(dot(normal, normalize(toLight + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+    "            lit += diffuse * gl_FrontLightProduct[i].diffuse +\n"
+    "                   pow(specular, gl_FrontMaterial.shininess) * gl_FrontLightProduct[i].specular;\n"
+    "        }\n"
+    "        color += attenuation * lit;\n"
+    "    }\n"
+    "    v_color = vec4(clamp(color.rgb, 0.0, 1.0), gl_FrontMaterial.diffuse.a);\n"
+    "}\n";
+
+// modulates the lit color with the texture, as GL_MODULATE does
+static const char* INSTANCED_MESH_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform bool u_useTexture;\n"
+    "uniform sampler2D u_texture;\n"
+    "varying vec4 v_color;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = v_color;\n"
+    "    if (u_useTexture) { gl_FragColor *= texture2D(u_texture, gl_TexCoord[0].st); }\n"
+    "}\n";
+#endif
+
+
+//===========================================================================
+/*!
+    Constructor of cInstancedMesh.
+*/
+//===========================================================================
+cInstancedMesh::cInstancedMesh()
+{
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_instanceBuffer = 0;
+    m_geometryChanged = true;
+    m_framesChanged = true;
+    m_programState = 0;
+    m_program = 0;
+    m_frameLocation = -1;
+    m_lightingLocation = -1;
+    m_lightsLocation = -1;
+    m_useTextureLocation = -1;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cInstancedMesh.
+*/
+//===========================================================================
+cInstancedMesh::~cInstancedMesh()
+{
+    #ifdef INSTANCED_MESH_USE_BUFFERS
+    if (m_vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_vertexBuffer);
+        glDeleteBuffers(1, &m_indexBuffer);
+        glDeleteBuffers(1, &m_instanceBuffer);
+    }
+    #endif
+    #ifdef INSTANCED_MESH_USE_INSTANCING
+    if (m_program != 0)
+    {
+        glDeleteProgram(m_program);
+    }
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Set the geometry shared by every instance.
+
+    \param      a_vertices  Vertices, in the frame of an instance.
+    \param      a_indices   Vertex indices, three per triangle.
+*/
+//===========================================================================
+void cInstancedMesh::setGeometry(const std::vector<cBufferedVertex>& a_vertices,
+                                 const std::vector<unsigned int>& a_indices)
+{
+    m_vertices = a_vertices;
+    m_indices.assign(a_indices.begin(), a_indices.end());
+    m_geometryChanged = true;
+}
+
+
+//===========================================================================
+/*!
+    Add an instance.
+
+    \param      a_pos  Position of the instance in the frame of the object.
+    \param      a_rot  Rotation of the instance.
+    \return     Return the index of the instance.
+*/
+//===========================================================================
+int cInstancedMesh::addInstance(const cVector3d& a_pos, const cMatrix3d& a_rot)
+{
+    m_frames.resize(m_frames.size() + 16);
+    int index = getNumInstances() - 1;
+    setInstance(index, a_pos, a_rot);
+
+    return (index);
+}
+
+
+//===========================================================================
+/*!
+    Move an instance.
+
+    \param      a_index  Index of the instance.
+    \param      a_pos    Position of the instance in the frame of the object.
+    \param      a_rot    Rotation of the instance.
+*/
+//===========================================================================
+void cInstancedMesh::setInstance(int a_index, const cVector3d& a_pos, const cMatrix3d& a_rot)
+{
+    GLfloat* frame = &m_frames[16 * a_index];
+    for (int j=0; j<3; j++)
+    {
+        for (int i=0; i<3; i++)
+        {
+            frame[4*j + i] = (GLfloat)a_rot.m[i][j];
+        }
+        frame[4*j + 3] = 0.0f;
+    }
+    frame[12] = (GLfloat)a_pos.x;
+    frame[13] = (GLfloat)a_pos.y;
+    frame[14] = (GLfloat)a_pos.z;
+    frame[15] = 1.0f;
+
+    m_framesChanged = true;
+}
+
+
+//===========================================================================
+/*!
+    Draw every instance, with one call where instancing is available.
+
+    \param      a_renderMode  Rendering pass.
+*/
+//===========================================================================
+void cInstancedMesh::render(const int a_renderMode)
+{
+    int numInstances = getNumInstances();
+    if (m_indices.empty() || (numInstances == 0)) { return; }
+
+    if (m_programState == 0)
+    {
+        m_programState = createProgram() ? 1 : -1;
+    }
+
+    // the arrays are read from the buffers if there are any, from memory
+    // otherwise
+    const GLubyte* vertices = (const GLubyte*)&m_vertices[0];
+    const GLvoid* indices = &m_indices[0];
+    #ifdef INSTANCED_MESH_USE_BUFFERS
+    updateBuffers();
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    vertices = NULL;
+    indices = NULL;
+    #endif
+
+    // material
+    if (m_useMaterialProperty)
+    {
+        m_material.render();
+    }
+
+    // texture
+    bool useTexture = (m_texture != NULL) && m_useTextureMapping;
+    if (useTexture)
+    {
+        glEnable(GL_TEXTURE_2D);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        m_texture->render();
+    }
+
+    // geometry
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(cBufferedVertex), vertices + offsetof(cBufferedVertex, m_pos));
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, sizeof(cBufferedVertex), vertices + offsetof(cBufferedVertex, m_normal));
+    if (useTexture)
+    {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(cBufferedVertex), vertices + offsetof(cBufferedVertex, m_texCoord));
+    }
+
+    GLsizei numIndices = (GLsizei)m_indices.size();
+    if (m_programState > 0)
+    {
+        #ifdef INSTANCED_MESH_USE_INSTANCING
+        // the shader reads the state the fixed pipeline would have used
+        GLint lights[INSTANCED_MESH_NUM_LIGHTS];
+        for (int i=0; i<INSTANCED_MESH_NUM_LIGHTS; i++)
+        {
+            lights[i] = glIsEnabled(GL_LIGHT0 + i);
+        }
+        glUseProgram(m_program);
+        glUniform1i(m_lightingLocation, glIsEnabled(GL_LIGHTING));
+        glUniform1iv(m_lightsLocation, INSTANCED_MESH_NUM_LIGHTS, lights);
+        glUniform1i(m_useTextureLocation, useTexture);
+
+        // one pose per instance, a matrix taking four attribute slots
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+        for (int i=0; i<4; i++)
+        {
+            GLuint location = (GLuint)m_frameLocation + i;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat),
+                                  (const GLvoid*)(4 * i * sizeof(GLfloat)));
+            glVertexAttribDivisor(location, 1);
+        }
+
+        glDrawElementsInstanced(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, NULL, numInstances);
+
+        for (int i=0; i<4; i++)
+        {
+            GLuint location = (GLuint)m_frameLocation + i;
+            glVertexAttribDivisor(location, 0);
+            glDisableVertexAttribArray(location);
+        }
+        glUseProgram(0);
+        #endif
+    }
+    else
+    {
+        for (int i=0; i<numInstances; i++)
+        {
+            glPushMatrix();
+            glMultMatrixf(&m_frames[16 * i]);
+            glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, indices);
+            glPopMatrix();
+        }
+    }
+
+    if (useTexture)
+    {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+    }
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    #ifdef INSTANCED_MESH_USE_BUFFERS
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Create the buffer objects on the first frame and upload the geometry
+    and the poses that changed since the previous frame.
+*/
+//===========================================================================
+void cInstancedMesh::updateBuffers()
+{
+    #ifdef INSTANCED_MESH_USE_BUFFERS
+    if (m_vertexBuffer == 0)
+    {
+        glGenBuffers(1, &m_vertexBuffer);
+        glGenBuffers(1, &m_indexBuffer);
+        glGenBuffers(1, &m_instanceBuffer);
+    }
+
+    if (m_geometryChanged)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(cBufferedVertex),
+                     m_vertices.empty() ? NULL : &m_vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLuint),
+                     m_indices.empty() ? NULL : &m_indices[0], GL_STATIC_DRAW);
+        m_geometryChanged = false;
+    }
+
+    // the poses only feed the shader
+    if (m_framesChanged && (m_programState > 0))
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_frames.size() * sizeof(GLfloat),
+                     m_frames.empty() ? NULL : &m_frames[0], GL_DYNAMIC_DRAW);
+        m_framesChanged = false;
+    }
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Compile and link the instancing shader, if the context is recent
+    enough to run it.
+
+    \return     Return true if the shader can be used.
+*/
+//===========================================================================
+bool cInstancedMesh::createProgram()
+{
+    #ifdef INSTANCED_MESH_USE_INSTANCING
+    // instanced attributes need OpenGL 3.3
+    int major = 0, minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if ((version == NULL) || (sscanf(version, "%d.%d", &major, &minor) != 2) ||
+        (10 * major + minor < 33))
+    {
+        printf("instanced mesh: no OpenGL 3.3, instances are drawn one by one\n");
+        return (false);
+    }
+
+    const char* sources[2] = { INSTANCED_MESH_VERTEX_SHADER, INSTANCED_MESH_FRAGMENT_SHADER };
+    const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    m_program = glCreateProgram();
+    for (int i=0; i<2; i++)
+    {
+        GLuint shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        glAttachShader(m_program, shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(m_program);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
+    m_frameLocation = glGetAttribLocation(m_program, "a_frame");
+    if ((linked != GL_TRUE) || (m_frameLocation < 0))
+    {
+        char log[512] = "";
+        glGetProgramInfoLog(m_program, sizeof(log), NULL, log);
+        printf("instanced mesh: shader not available, instances are drawn one by one\n%s\n", log);
+        glDeleteProgram(m_program);
+        m_program = 0;
+        return (false);
+    }
+
+    m_lightingLocation = glGetUniformLocation(m_program, "u_lighting");
+    m_lightsLocation = glGetUniformLocation(m_program, "u_lights");
+    m_useTextureLocation = glGetUniformLocation(m_program, "u_useTexture");
+    return (true);
+    #else
+    return (false);
+    #endif
+}
@@ -0,0 +1,130 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CInstancedMesh.h
+
+    \brief
+    One geometry drawn at many poses with a single instanced draw call.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CInstancedMeshH
+#define CInstancedMeshH
+//---------------------------------------------------------------------------
+#include "CBufferedMesh.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cInstancedMesh
+    \brief      Copies of one geometry, with one material, at many poses.
+
+    The scene repeats some meshes many times: the same triangles, the same
+    material, only the pose differs. Drawn as separate cMesh objects, each
+    copy costs a node of the scene graph, its material and its own draw
+    calls on every frame.
+
+    cInstancedMesh stores the geometry once, in a vertex and an index
+    buffer, and the pose of each copy (an instance) as a 4x4 matrix in a
+    third buffer. Where OpenGL 3.3 is available, all instances are drawn
+    with one glDrawElementsInstanced, through a small shader that applies
+    the pose of the instance, then the lights and the material as the
+    fixed pipeline does (spot cones aside). Elsewhere the buffers are drawn
+    once per instance, which still saves the scene graph traversal and
+    the state changes.
+
+    Poses are in the frame of the object and may change on every frame;
+    the instance buffer is uploaded again when they did. Transparency is
+    not supported. Rendering must happen on the thread owning the GL
+    context.
+*/
+//===========================================================================
+class cInstancedMesh : public cGenericObject
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cInstancedMesh.
+    cInstancedMesh();
+
+    //! Destructor of cInstancedMesh.
+    virtual ~cInstancedMesh();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Set the geometry shared by every instance (three indices per triangle).
+    void setGeometry(const std::vector<cBufferedVertex>& a_vertices,
+                     const std::vector<unsigned int>& a_indices);
+
+    //! Add an instance at a pose; returns its index.
+    int addInstance(const cVector3d& a_pos, const cMatrix3d& a_rot);
+
+    //! Move an instance.
+    void setInstance(int a_index, const cVector3d& a_pos, const cMatrix3d& a_rot);
+
+    //! Number of instances.
+    int getNumInstances() const { return ((int)m_frames.size() / 16); }
+
+    //! True if the last frame drew every instance with one call.
+    bool getUseInstancing() const { return (m_programState > 0); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Draw every instance.
+    virtual void render(const int a_renderMode=0);
+
+    //! Upload the geometry and the poses that changed.
+    void updateBuffers();
+
+    //! Build the instancing shader; returns false if it is not available.
+    bool createProgram();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Geometry shared by the instances.
+    std::vector<cBufferedVertex> m_vertices;
+    std::vector<GLuint> m_indices;
+
+    //! Pose of each instance, as a column-major 4x4 matrix.
+    std::vector<GLfloat> m_frames;
+
+    //! Vertex, index and instance buffer objects (0 until the first frame).
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    GLuint m_instanceBuffer;
+
+    //! True when the geometry, or the poses, changed since they were uploaded.
+    bool m_geometryChanged;
+    bool m_framesChanged;
+
+    //! Instancing shader: 0 not built yet, 1 in use, -1 not available.
+    int m_programState;
+    GLuint m_program;
+
+    //! Locations of the inputs of the shader.
+    GLint m_frameLocation;
+    GLint m_lightingLocation;
+    GLint m_lightsLocation;
+    GLint m_useTextureLocation;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,146 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CLatencyHistogram.cpp
+
+    \brief
+    Per-tick latency recorder reporting percentiles and a log-scale
+    histogram.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CLatencyHistogram.h"
+//---------------------------------------------------------------------------
+#include <algorithm>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cLatencyHistogram.
+
+    \param      a_capacity  Number of samples kept for percentiles.
+*/
+//===========================================================================
+cLatencyHistogram::cLatencyHistogram(unsigned int a_capacity)
+{
+    m_samples.reserve(a_capacity);
+    clear();
+}
+
+
+//===========================================================================
+/*!
+    Discard all samples. The sample buffer keeps its capacity.
+*/
+//===========================================================================
+void cLatencyHistogram::clear()
+{
+    m_samples.clear();
+    m_numSamples = 0;
+    m_sorted = true;
+    m_total = 0.0;
+    m_max = 0.0;
+    for (int i=0; i<LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        m_buckets[i] = 0;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Record one duration. Never allocates: once the reserved buffer is full,
+    further samples only update the histogram, the total and the maximum.
+
+    \param      a_seconds  Duration in seconds.
+*/
+//===========================================================================
+void cLatencyHistogram::record(double a_seconds)
+{
+    if (m_samples.size() < m_samples.capacity())
+    {
+        m_samples.push_back(a_seconds);
+        m_sorted = false;
+    }
+    m_numSamples++;
+    m_total += a_seconds;
+    if (a_seconds > m_max) { m_max = a_seconds; }
+
+    // find the power-of-two microsecond bucket
+    double us = 1.0e6 * a_seconds;
+    int bucket = 0;
+    double limit = 1.0;
+    while ((us >= limit) && (bucket < LATENCY_HISTOGRAM_BUCKETS-1))
+    {
+        limit *= 2.0;
+        bucket++;
+    }
+    m_buckets[bucket]++;
+}
+
+
+//===========================================================================
+/*!
+    Compute a percentile of the kept samples (nearest-rank method).
+
+    \param      a_percent  Percentile in [0, 100].
+    \return     Duration in seconds, or 0 when no sample was recorded.
+*/
+//===========================================================================
+double cLatencyHistogram::getPercentile(double a_percent)
+{
+    if (m_samples.empty()) { return (0.0); }
+
+    if (!m_sorted)
+    {
+        std::sort(m_samples.begin(), m_samples.end());
+        m_sorted = true;
+    }
+
+    double rank = (a_percent / 100.0) * (double)m_samples.size();
+    unsigned int index = (rank <= 1.0) ? 0 : (unsigned int)(rank + 0.999999) - 1;
+    if (index >= m_samples.size()) { index = (unsigned int)m_samples.size() - 1; }
+    return (m_samples[index]);
+}
+
+
+//===========================================================================
+/*!
+    Print a summary of the recorded samples: achieved rate, percentiles in
+    microseconds and the non-empty histogram buckets.
+
+    \param      a_stream  Output stream.
+    \param      a_label   Name of the measured quantity.
+*/
+//===========================================================================
+void cLatencyHistogram::print(FILE* a_stream, const char* a_label)
+{
+    double rate = (m_total > 0.0) ? (double)m_numSamples / m_total : 0.0;
+
+    fprintf(a_stream, "%s: %u samples, %.0lf Hz\n", a_label, m_numSamples, rate);
+    fprintf(a_stream, "    p50   %10.2lf us\n", 1.0e6 * getPercentile(50.0));
+    fprintf(a_stream, "    p99   %10.2lf us\n", 1.0e6 * getPercentile(99.0));
+    fprintf(a_stream, "    p99.9 %10.2lf us\n", 1.0e6 * getPercentile(99.9));
+    fprintf(a_stream, "    max   %10.2lf us\n", 1.0e6 * m_max);
+
+    double lower = 0.0;
+    double upper = 1.0;
+    for (int i=0; i<LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        if (m_buckets[i] > 0)
+        {
+            if (i == LATENCY_HISTOGRAM_BUCKETS-1)
+            {
+                fprintf(a_stream, "    [%7.0lf us,        inf) %u\n", lower, m_buckets[i]);
+            }
+            else
+            {
+                fprintf(a_stream, "    [%7.0lf us, %7.0lf us) %u\n", lower, upper, m_buckets[i]);
+            }
+        }
+        lower = upper;
+        upper *= 2.0;
+    }
+}
@@ -0,0 +1,108 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CLatencyHistogram.h
+
+    \brief
+    Per-tick latency recorder reporting percentiles and a log-scale
+    histogram.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CLatencyHistogramH
+#define CLatencyHistogramH
+//---------------------------------------------------------------------------
+#include <stdio.h>
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of power-of-two buckets in the histogram; bucket i counts samples
+// in [2^(i-1), 2^i) microseconds, the last bucket collects everything above
+const int LATENCY_HISTOGRAM_BUCKETS = 16;
+
+
+//===========================================================================
+/*!
+    \class      cLatencyHistogram
+    \brief      Stores one duration per tick in a buffer allocated up front,
+                so that recording never allocates inside the measured loop.
+
+    Samples beyond the capacity are counted in the histogram buckets and in
+    the maximum but are not kept for the percentile computation.
+*/
+//===========================================================================
+class cLatencyHistogram
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cLatencyHistogram; reserves room for a_capacity samples.
+    cLatencyHistogram(unsigned int a_capacity);
+
+    //! Destructor of cLatencyHistogram.
+    ~cLatencyHistogram() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Discard all samples.
+    void clear();
+
+    //! Record one duration expressed in seconds.
+    void record(double a_seconds);
+
+    //! Number of samples recorded since the last clear().
+    unsigned int getNumSamples() const { return (m_numSamples); }
+
+    //! Sum of all recorded durations in seconds.
+    double getTotalSeconds() const { return (m_total); }
+
+    //! Largest recorded duration in seconds.
+    double getMaxSeconds() const { return (m_max); }
+
+    //! Duration in seconds below which a_percent percent of the samples fall.
+    double getPercentile(double a_percent);
+
+    //! Print percentiles and the histogram; a_label prefixes the report.
+    void print(FILE* a_stream, const char* a_label);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Recorded samples in seconds.
+    std::vector<double> m_samples;
+
+    //! Number of recorded samples, possibly larger than m_samples.size().
+    unsigned int m_numSamples;
+
+    //! True when m_samples is sorted.
+    bool m_sorted;
+
+    //! Sum of all samples.
+    double m_total;
+
+    //! Largest sample.
+    double m_max;
+
+    //! Sample counts per power-of-two microsecond bucket.
+    unsigned int m_buckets[LATENCY_HISTOGRAM_BUCKETS];
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
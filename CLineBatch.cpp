@@ -0,0 +1,128 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CLineBatch.cpp
+
+    \brief
+    Set of line segments sharing one color, drawn with a single call.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "GLEntryPoints.h"
+#include "CLineBatch.h"
+//---------------------------------------------------------------------------
+#if (defined(_LINUX) || defined(_MACOSX)) && defined(GL_ARRAY_BUFFER)
+#define LINE_BATCH_USE_BUFFERS
+#endif
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cLineBatch. The lines are white and one pixel wide, as
+    those of cShapeLine.
+*/
+//===========================================================================
+cLineBatch::cLineBatch()
+{
+    m_color.set(1.0, 1.0, 1.0, 1.0);
+    m_buffer = 0;
+    m_changed = true;
+    m_lineWidth = 1.0;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cLineBatch.
+*/
+//===========================================================================
+cLineBatch::~cLineBatch()
+{
+    #ifdef LINE_BATCH_USE_BUFFERS
+    if (m_buffer != 0)
+    {
+        glDeleteBuffers(1, &m_buffer);
+    }
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Add a segment.
+
+    \param      a_pointA  First end point, in the frame of the batch.
+    \param      a_pointB  Second end point, in the frame of the batch.
+    \return     Return the index of the segment.
+*/
+//===========================================================================
+int cLineBatch::addLine(const cVector3d& a_pointA, const cVector3d& a_pointB)
+{
+    m_points.push_back((GLfloat)a_pointA.x);
+    m_points.push_back((GLfloat)a_pointA.y);
+    m_points.push_back((GLfloat)a_pointA.z);
+    m_points.push_back((GLfloat)a_pointB.x);
+    m_points.push_back((GLfloat)a_pointB.y);
+    m_points.push_back((GLfloat)a_pointB.z);
+    m_changed = true;
+
+    return (getNumLines() - 1);
+}
+
+
+//===========================================================================
+/*!
+    Remove every segment.
+*/
+//===========================================================================
+void cLineBatch::clear()
+{
+    m_points.clear();
+    m_changed = true;
+}
+
+
+//===========================================================================
+/*!
+    Draw every segment with one call.
+
+    \param      a_renderMode  Rendering pass.
+*/
+//===========================================================================
+void cLineBatch::render(const int a_renderMode)
+{
+    if (m_points.empty()) { return; }
+
+    // the array is read from the vertex buffer if there is one, from
+    // memory otherwise
+    const GLvoid* points = &m_points[0];
+    #ifdef LINE_BATCH_USE_BUFFERS
+    if (m_buffer == 0)
+    {
+        glGenBuffers(1, &m_buffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    if (m_changed)
+    {
+        glBufferData(GL_ARRAY_BUFFER, m_points.size() * sizeof(GLfloat), &m_points[0], GL_STATIC_DRAW);
+        m_changed = false;
+    }
+    points = NULL;
+    #endif
+
+    glDisable(GL_LIGHTING);
+    glLineWidth((GLfloat)m_lineWidth);
+    glColor4fv(m_color.pColor());
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, points);
+    glDrawArrays(GL_LINES, 0, (GLsizei)(m_points.size() / 3));
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    #ifdef LINE_BATCH_USE_BUFFERS
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #endif
+    glEnable(GL_LIGHTING);
+}
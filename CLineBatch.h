@@ -0,0 +1,108 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CLineBatch.h
+
+    \brief
+    Set of line segments sharing one color, drawn with a single call.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CLineBatchH
+#define CLineBatchH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cLineBatch
+    \brief      Line segments drawn together with one glDrawArrays.
+
+    A cShapeLine per segment costs a node of the scene graph, a matrix and
+    a few state changes per segment and per frame. cLineBatch keeps the
+    end points of all its segments in one array, copied once into a vertex
+    buffer where buffer objects are available, and draws them as GL_LINES
+    in a single call, unlit, with one color and line width.
+
+    The points are in the frame of the batch. Adding or removing segments
+    uploads the array again on the next frame; rendering must happen on
+    the thread owning the GL context.
+*/
+//===========================================================================
+class cLineBatch : public cGenericObject
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cLineBatch.
+    cLineBatch();
+
+    //! Destructor of cLineBatch.
+    virtual ~cLineBatch();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Add a segment from a_pointA to a_pointB; returns its index.
+    int addLine(const cVector3d& a_pointA, const cVector3d& a_pointB);
+
+    //! Remove every segment.
+    void clear();
+
+    //! Number of segments.
+    int getNumLines() const { return ((int)m_points.size() / 6); }
+
+    //! Set the width of the lines in pixels.
+    void setLineWidth(double a_width) { m_lineWidth = a_width; }
+
+    //! Width of the lines in pixels.
+    double getLineWidth() const { return (m_lineWidth); }
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Color of the lines.
+    cColorf m_color;
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Draw every segment.
+    virtual void render(const int a_renderMode=0);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! End points of the segments, three coordinates each.
+    std::vector<GLfloat> m_points;
+
+    //! Vertex buffer holding m_points (0 until the first frame).
+    GLuint m_buffer;
+
+    //! True when m_points changed since they were uploaded.
+    bool m_changed;
+
+    //! Width of the lines in pixels.
+    double m_lineWidth;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,232 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CMappedFile.cpp
+
+    \brief
+    Binary file mapped into memory, for logs written from the haptics
+    thread and for data loaded without parsing.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CMappedFile.h"
+//---------------------------------------------------------------------------
+#include <string.h>
+#if defined(_MSVC)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cMappedFile.
+*/
+//===========================================================================
+cMappedFile::cMappedFile()
+{
+    m_data = NULL;
+    m_size = 0;
+    m_writable = false;
+    #if defined(_MSVC)
+    m_fileHandle = INVALID_HANDLE_VALUE;
+    m_mappingHandle = NULL;
+    #else
+    m_fileDescriptor = -1;
+    #endif
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cMappedFile.
+*/
+//===========================================================================
+cMappedFile::~cMappedFile()
+{
+    close();
+}
+
+
+//===========================================================================
+/*!
+    Create a file of the given size, or truncate an existing one, and map
+    it writable. The content starts zeroed; every page is written once so
+    that the mapping is resident before it is used.
+
+    \param      a_filename  Path of the file.
+    \param      a_size      Size of the file in bytes.
+    \return     Return true if the file is mapped.
+*/
+//===========================================================================
+bool cMappedFile::create(const char* a_filename, size_t a_size)
+{
+    close();
+    if (a_size == 0) { return (false); }
+
+    #if defined(_MSVC)
+    m_fileHandle = CreateFileA(a_filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                               NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_fileHandle == INVALID_HANDLE_VALUE) { return (false); }
+
+    ULARGE_INTEGER size;
+    size.QuadPart = a_size;
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READWRITE,
+                                         size.HighPart, size.LowPart, NULL);
+    if (m_mappingHandle != NULL)
+    {
+        m_data = (unsigned char*)MapViewOfFile(m_mappingHandle, FILE_MAP_WRITE, 0, 0, a_size);
+    }
+    #else
+    m_fileDescriptor = open(a_filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fileDescriptor < 0) { return (false); }
+
+    // reserve the disk blocks up front where the system supports it
+    #if defined(_LINUX)
+    bool allocated = (posix_fallocate(m_fileDescriptor, 0, (off_t)a_size) == 0);
+    #else
+    bool allocated = false;
+    #endif
+    if (allocated || (ftruncate(m_fileDescriptor, (off_t)a_size) == 0))
+    {
+        void* data = mmap(NULL, a_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fileDescriptor, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = (unsigned char*)data;
+        }
+    }
+    #endif
+
+    m_size = a_size;
+    m_writable = true;
+    if (m_data == NULL)
+    {
+        close(0);
+        return (false);
+    }
+
+    // fault every page in now rather than in the loop writing to it
+    memset(m_data, 0, m_size);
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Map an existing file read-only.
+
+    \param      a_filename  Path of the file.
+    \return     Return true if the file is mapped; false if it does not
+                exist, is empty or cannot be mapped.
+*/
+//===========================================================================
+bool cMappedFile::openReadOnly(const char* a_filename)
+{
+    close();
+
+    #if defined(_MSVC)
+    m_fileHandle = CreateFileA(a_filename, GENERIC_READ, FILE_SHARE_READ,
+                               NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_fileHandle == INVALID_HANDLE_VALUE) { return (false); }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(m_fileHandle, &size) && (size.QuadPart > 0))
+    {
+        m_size = (size_t)size.QuadPart;
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mappingHandle != NULL)
+        {
+            m_data = (unsigned char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, m_size);
+        }
+    }
+    #else
+    m_fileDescriptor = open(a_filename, O_RDONLY);
+    if (m_fileDescriptor < 0) { return (false); }
+
+    struct stat status;
+    if ((fstat(m_fileDescriptor, &status) == 0) && (status.st_size > 0))
+    {
+        m_size = (size_t)status.st_size;
+        void* data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_fileDescriptor, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = (unsigned char*)data;
+        }
+    }
+    #endif
+
+    m_writable = false;
+    if (m_data == NULL)
+    {
+        close();
+        return (false);
+    }
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Unmap and close the file. A writable file is flushed and, if a_usedSize
+    is smaller than its size, shrunk to a_usedSize bytes.
+
+    \param      a_usedSize  Number of bytes to keep in a writable file.
+*/
+//===========================================================================
+void cMappedFile::close(size_t a_usedSize)
+{
+    size_t keepSize = (a_usedSize < m_size) ? a_usedSize : m_size;
+
+    #if defined(_MSVC)
+    if (m_data != NULL)
+    {
+        if (m_writable) { FlushViewOfFile(m_data, 0); }
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle != NULL)
+    {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+    {
+        if (m_writable && (keepSize < m_size))
+        {
+            LARGE_INTEGER position;
+            position.QuadPart = keepSize;
+            SetFilePointerEx(m_fileHandle, position, NULL, FILE_BEGIN);
+            SetEndOfFile(m_fileHandle);
+        }
+        CloseHandle(m_fileHandle);
+    }
+    m_fileHandle = INVALID_HANDLE_VALUE;
+    m_mappingHandle = NULL;
+    #else
+    if (m_data != NULL)
+    {
+        if (m_writable) { msync(m_data, m_size, MS_SYNC); }
+        munmap(m_data, m_size);
+    }
+    if (m_fileDescriptor >= 0)
+    {
+        if (m_writable && (keepSize < m_size))
+        {
+            int result = ftruncate(m_fileDescriptor, (off_t)keepSize);
+            (void)result;
+        }
+        ::close(m_fileDescriptor);
+    }
+    m_fileDescriptor = -1;
+    #endif
+
+    m_data = NULL;
+    m_size = 0;
+    m_writable = false;
+}
@@ -0,0 +1,94 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CMappedFile.h
+
+    \brief
+    Binary file mapped into memory, for logs written from the haptics
+    thread and for data loaded without parsing.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CMappedFileH
+#define CMappedFileH
+//---------------------------------------------------------------------------
+#include <stddef.h>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cMappedFile
+    \brief      File mapped into the address space of the process, either
+                created writable with a fixed size or opened read-only.
+
+    A writable file is allocated on disk and all of its pages are touched
+    when it is created, so that later writes through getData() neither
+    allocate disk blocks nor fault in pages. close() can shrink the file
+    to the part actually used.
+*/
+//===========================================================================
+class cMappedFile
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cMappedFile.
+    cMappedFile();
+
+    //! Destructor of cMappedFile; closes the file.
+    ~cMappedFile();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Create or truncate a file of a_size bytes and map it writable.
+    bool create(const char* a_filename, size_t a_size);
+
+    //! Map an existing file read-only.
+    bool openReadOnly(const char* a_filename);
+
+    //! Unmap and close the file; a writable file is shrunk to a_usedSize bytes if given.
+    void close(size_t a_usedSize = (size_t)-1);
+
+    //! True if a file is mapped.
+    bool isOpen() const { return (m_data != NULL); }
+
+    //! Start of the mapped bytes.
+    unsigned char* getData() const { return (m_data); }
+
+    //! Number of mapped bytes.
+    size_t getSize() const { return (m_size); }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Mapped bytes and their number.
+    unsigned char* m_data;
+    size_t m_size;
+
+    //! True if the mapping is writable.
+    bool m_writable;
+
+    //! Platform handles of the file and of the mapping.
+    #if defined(_MSVC)
+    void* m_fileHandle;
+    void* m_mappingHandle;
+    #else
+    int m_fileDescriptor;
+    #endif
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
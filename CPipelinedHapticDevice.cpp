@@ -0,0 +1,291 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CPipelinedHapticDevice.cpp
+
+    \brief
+    Haptic device wrapper moving the transfers with the wrapped device to
+    an I/O thread, which exchanges positions and forces with the haptics
+    thread through lock-free mailboxes.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CPipelinedHapticDevice.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cPipelinedHapticDevice. The wrapped device keeps its
+    specifications.
+
+    \param      a_device  Device to exchange with.
+*/
+//===========================================================================
+cPipelinedHapticDevice::cPipelinedHapticDevice(cGenericHapticDevice* a_device) :
+    m_holdTime(-1.0),
+    m_numExchanges(0),
+    m_numRepeatedCommands(0),
+    m_numStaleSamples(0)
+{
+    m_device = a_device;
+    if (m_device != NULL)
+    {
+        m_specifications = m_device->getSpecifications();
+    }
+
+    m_systemAvailable = (m_device != NULL);
+    m_systemReady = false;
+    m_force.zero();
+    m_numLatencies = 0;
+    m_latencyTotal = 0.0;
+    m_latencyMax = 0.0;
+    m_latencyHistogram = NULL;
+    m_clock.start(true);
+}
+
+
+//===========================================================================
+/*!
+    One transfer with the wrapped device, run by the I/O thread: write the
+    latest force command (or the previous one again when the haptics
+    thread published none since, or zero while the force is held), then
+    read and publish the state of the device.
+*/
+//===========================================================================
+void cPipelinedHapticDevice::exchange()
+{
+    if (m_device == NULL) { return; }
+
+    // write the latest command, measuring how long ago the state it was
+    // computed from was read
+    bool isNew;
+    const cPipelineCommand& command = m_commands.read(isNew);
+    if (isNew)
+    {
+        m_force = command.m_force;
+        double latency = m_clock.getCurrentTimeSeconds() - command.m_sampleTime;
+        m_numLatencies++;
+        m_latencyTotal += latency;
+        m_latencyMax = cMax(m_latencyMax, latency);
+        if (m_latencyHistogram != NULL)
+        {
+            m_latencyHistogram->record(latency);
+        }
+    }
+    else
+    {
+        m_numRepeatedCommands.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // a held force stays at zero until the haptics thread computes a
+    // command from a state read after the hold started
+    double holdTime = m_holdTime.load(std::memory_order_acquire);
+    if (holdTime >= 0.0)
+    {
+        if (isNew && (command.m_sampleTime > holdTime))
+        {
+            m_holdTime.compare_exchange_strong(holdTime, -1.0);
+        }
+        else
+        {
+            m_force.zero();
+        }
+    }
+    m_device->setForce(m_force);
+
+    // read the state of the device and hand it to the haptics thread
+    cPipelineSample& sample = m_samples.writeBuffer();
+    m_device->getPosition(sample.m_pos);
+    m_device->getLinearVelocity(sample.m_vel);
+    m_device->getRotation(sample.m_rot);
+    m_device->getUserSwitch(0, sample.m_userSwitch);
+    sample.m_time = m_clock.getCurrentTimeSeconds();
+    sample.m_sequence = m_numExchanges.fetch_add(1, std::memory_order_relaxed) + 1;
+    m_samples.publish();
+}
+
+
+//===========================================================================
+/*!
+    Hold the force of the device at zero, from any thread. The commands
+    the haptics thread computes from the states read before now are
+    dropped; the first one computed from a later state releases the hold.
+*/
+//===========================================================================
+void cPipelinedHapticDevice::holdZeroForce()
+{
+    m_holdTime.store(m_clock.getCurrentTimeSeconds(), std::memory_order_release);
+}
+
+
+//===========================================================================
+/*!
+    Mean delay between the read of a state by the I/O thread and the write
+    of the force computed from it. Only meaningful once the I/O thread has
+    stopped.
+
+    \return     Return the mean latency [s], 0 if no force was written.
+*/
+//===========================================================================
+double cPipelinedHapticDevice::getMeanLatency() const
+{
+    if (m_numLatencies == 0) { return (0.0); }
+    return (m_latencyTotal / (double)m_numLatencies);
+}
+
+
+//===========================================================================
+/*!
+    Open connection to the wrapped device.
+
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::open()
+{
+    if (m_device == NULL) { return (-1); }
+
+    int result = m_device->open();
+    m_systemReady = (result == 0);
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Close connection to the wrapped device. The I/O thread must have
+    stopped.
+
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::close()
+{
+    m_systemReady = false;
+    if (m_device == NULL) { return (-1); }
+    return (m_device->close());
+}
+
+
+//===========================================================================
+/*!
+    Initialize the wrapped device, then exchange with it once so that the
+    first state taken by the haptics thread is a real one. Called before
+    the I/O thread starts.
+
+    \param      a_resetEncoders  Passed on to the wrapped device.
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::initialize(const bool a_resetEncoders)
+{
+    if (m_device == NULL) { return (-1); }
+
+    int result = m_device->initialize(a_resetEncoders);
+    exchange();
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Take the latest state published by the I/O thread. The tool reads the
+    position first in each tick; the other reads of the tick return the
+    same state.
+
+    \param      a_position  Receives the position [m].
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::getPosition(cVector3d& a_position)
+{
+    if (m_device == NULL) { return (-1); }
+
+    bool isNew;
+    m_sample = m_samples.read(isNew);
+    if (!isNew)
+    {
+        m_numStaleSamples.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    a_position = m_sample.m_pos;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Velocity of the state taken by the last getPosition().
+
+    \param      a_linearVelocity  Receives the velocity [m/s].
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::getLinearVelocity(cVector3d& a_linearVelocity)
+{
+    if (m_device == NULL) { return (-1); }
+
+    a_linearVelocity = m_sample.m_vel;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Orientation of the state taken by the last getPosition().
+
+    \param      a_rotation  Receives the orientation.
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    if (m_device == NULL) { return (-1); }
+
+    a_rotation = m_sample.m_rot;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Publish a force for the I/O thread, tagged with the time of the state
+    it was computed from. A later command replaces it if the I/O thread
+    has not written it yet.
+
+    \param      a_force  Force [N].
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::setForce(cVector3d& a_force)
+{
+    if (m_device == NULL) { return (-1); }
+
+    cPipelineCommand& command = m_commands.writeBuffer();
+    command.m_force = a_force;
+    command.m_sampleTime = m_sample.m_time;
+    m_commands.publish();
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Status of a user switch in the state taken by the last getPosition().
+    Only switch 0 is sampled.
+
+    \param      a_switchIndex  Index of the switch.
+    \param      a_status       Receives the status.
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cPipelinedHapticDevice::getUserSwitch(int a_switchIndex, bool& a_status)
+{
+    a_status = false;
+    if ((m_device == NULL) || (a_switchIndex != 0)) { return (-1); }
+
+    a_status = m_sample.m_userSwitch;
+    return (0);
+}
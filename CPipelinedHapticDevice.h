@@ -0,0 +1,213 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CPipelinedHapticDevice.h
+
+    \brief
+    Haptic device wrapper moving the transfers with the wrapped device to
+    an I/O thread, which exchanges positions and forces with the haptics
+    thread through lock-free mailboxes.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CPipelinedHapticDeviceH
+#define CPipelinedHapticDeviceH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTripleBuffer.h"
+#include "CLatencyHistogram.h"
+#include <atomic>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// state read from the device by one exchange of the I/O thread
+struct cPipelineSample
+{
+    cPipelineSample() : m_pos(0,0,0), m_vel(0,0,0), m_userSwitch(false),
+                        m_time(0.0), m_sequence(0) { m_rot.identity(); }
+
+    // position [m], velocity [m/s] and orientation of the device
+    cVector3d m_pos;
+    cVector3d m_vel;
+    cMatrix3d m_rot;
+
+    // status of user switch 0
+    bool m_userSwitch;
+
+    // time at which the state was read [s]
+    double m_time;
+
+    // index of the exchange that read the state, from 1
+    unsigned long m_sequence;
+};
+
+// force computed by the haptics thread from a sample
+struct cPipelineCommand
+{
+    cPipelineCommand() : m_force(0,0,0), m_sampleTime(0.0) {}
+
+    // force [N]
+    cVector3d m_force;
+
+    // time at which the sample the force was computed from was read [s]
+    double m_sampleTime;
+};
+
+
+//===========================================================================
+/*!
+    \class      cPipelinedHapticDevice
+    \brief      Lets the haptics thread compute while the I/O thread waits
+                for the device.
+
+    The I/O thread calls exchange() in a loop: it writes the latest force
+    command to the wrapped device, then reads the position, velocity,
+    orientation and user switch of the device and publishes them. The
+    haptics thread reads the latest published state and publishes its
+    command through the device interface, without ever waiting for the
+    device. Both mailboxes are triple buffers: a value is never torn, and
+    intermediate values are dropped when one side runs faster.
+
+    The price is one exchange of latency: a force reaches the device one
+    transfer after the state it was computed from was read, instead of
+    within the same tick. The delay between the read of a state and the
+    write of the force computed from it is measured for every command.
+
+    open() and initialize() are forwarded to the wrapped device before the
+    I/O thread starts; initialize() also performs a first exchange, so the
+    tool starts from a real position. close() must only be called once the
+    I/O thread has stopped. Only user switch 0 is sampled.
+
+    holdZeroForce() lets another thread, such as a watchdog, stop the force
+    of the device while the haptics thread is stuck: the I/O thread writes
+    zero, dropping the commands computed from states read before the hold,
+    and resumes with the first command computed from a later state.
+*/
+//===========================================================================
+class cPipelinedHapticDevice : public cGenericHapticDevice
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cPipelinedHapticDevice; exchanges with a_device.
+    cPipelinedHapticDevice(cGenericHapticDevice* a_device);
+
+    //! Destructor of cPipelinedHapticDevice.
+    virtual ~cPipelinedHapticDevice() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - I/O THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Write the latest force to the wrapped device and publish its state.
+    void exchange();
+
+    //! Record each read-to-write latency into a_histogram (I/O thread only), or NULL.
+    void setLatencyHistogram(cLatencyHistogram* a_histogram) { m_latencyHistogram = a_histogram; }
+
+    //! Number of exchanges with the wrapped device.
+    unsigned long getNumExchanges() const { return (m_numExchanges.load(std::memory_order_relaxed)); }
+
+    //! Number of exchanges that wrote the same force again, no new command being available.
+    unsigned long getNumRepeatedCommands() const { return (m_numRepeatedCommands.load(std::memory_order_relaxed)); }
+
+    //! Number of haptic ticks that found no new state and reused the previous one.
+    unsigned long getNumStaleSamples() const { return (m_numStaleSamples.load(std::memory_order_relaxed)); }
+
+    //! Mean delay between the read of a state and the write of its force [s] (once stopped).
+    double getMeanLatency() const;
+
+    //! Largest delay between the read of a state and the write of its force [s] (once stopped).
+    double getMaxLatency() const { return (m_latencyMax); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - ANY THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Write a zero force until a command computed from a state read from now on arrives.
+    void holdZeroForce();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - DEVICE:
+    //-----------------------------------------------------------------------
+
+    //! Open connection to the wrapped device.
+    virtual int open();
+
+    //! Close connection to the wrapped device.
+    virtual int close();
+
+    //! Initialize the wrapped device and read its first state.
+    virtual int initialize(const bool a_resetEncoders=false);
+
+    //! Take the latest state published by the I/O thread and return its position.
+    virtual int getPosition(cVector3d& a_position);
+
+    //! Velocity of the state taken by getPosition().
+    virtual int getLinearVelocity(cVector3d& a_linearVelocity);
+
+    //! Orientation of the state taken by getPosition().
+    virtual int getRotation(cMatrix3d& a_rotation);
+
+    //! Publish a force for the I/O thread.
+    virtual int setForce(cVector3d& a_force);
+
+    //! Status of user switch 0 in the state taken by getPosition().
+    virtual int getUserSwitch(int a_switchIndex, bool& a_status);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Wrapped device; only the I/O thread accesses it while running.
+    cGenericHapticDevice* m_device;
+
+    //! States published by the I/O thread for the haptics thread.
+    cTripleBuffer<cPipelineSample> m_samples;
+
+    //! Commands published by the haptics thread for the I/O thread.
+    cTripleBuffer<cPipelineCommand> m_commands;
+
+    //! State taken by the last getPosition() (haptics thread).
+    cPipelineSample m_sample;
+
+    //! Last force written to the wrapped device (I/O thread).
+    cVector3d m_force;
+
+    //! Time from which the force is held at zero [s]; negative when not held.
+    std::atomic<double> m_holdTime;
+
+    //! Clock giving the time of the states and commands.
+    cPrecisionClock m_clock;
+
+    //! Counters of the pipeline.
+    std::atomic<unsigned long> m_numExchanges;
+    std::atomic<unsigned long> m_numRepeatedCommands;
+    std::atomic<unsigned long> m_numStaleSamples;
+
+    //! Number, sum and largest value of the measured latencies (I/O thread).
+    unsigned long m_numLatencies;
+    double m_latencyTotal;
+    double m_latencyMax;
+
+    //! Optional histogram of the measured latencies.
+    cLatencyHistogram* m_latencyHistogram;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,425 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CRailNetwork.cpp
+
+    \brief
+    Network of 3D rail segments with junctions and a spatial index, used
+    to constrain the motion of objects to the rails.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CRailNetwork.h"
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <utility>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// number of bits used for each cell coordinate in a cell key, and the
+// offset making cell coordinates positive
+const int RAIL_CELL_BITS    = 21;
+const int RAIL_CELL_OFFSET  = 1 << (RAIL_CELL_BITS - 1);
+
+
+//---------------------------------------------------------------------------
+// LOCAL FUNCTIONS
+//---------------------------------------------------------------------------
+
+// closest points between segments [p1,q1] and [p2,q2]; returns the squared
+// distance between them
+static double closestPointsSegmentSegment(const cVector3d& p1, const cVector3d& q1,
+                                          const cVector3d& p2, const cVector3d& q2,
+                                          cVector3d& c1, cVector3d& c2)
+{
+    cVector3d d1 = q1 - p1;
+    cVector3d d2 = q2 - p2;
+    cVector3d r = p1 - p2;
+    double a = d1.dot(d1);
+    double e = d2.dot(d2);
+    double f = d2.dot(r);
+    double s, t;
+
+    if ((a <= CHAI_SMALL) && (e <= CHAI_SMALL))
+    {
+        s = t = 0.0;
+    }
+    else if (a <= CHAI_SMALL)
+    {
+        s = 0.0;
+        t = cClamp(f / e, 0.0, 1.0);
+    }
+    else
+    {
+        double c = d1.dot(r);
+        if (e <= CHAI_SMALL)
+        {
+            t = 0.0;
+            s = cClamp(-c / a, 0.0, 1.0);
+        }
+        else
+        {
+            double b = d1.dot(d2);
+            double denom = a*e - b*b;
+            s = (denom > CHAI_SMALL) ? cClamp((b*f - c*e) / denom, 0.0, 1.0) : 0.0;
+            t = (b*s + f) / e;
+            if (t < 0.0)
+            {
+                t = 0.0;
+                s = cClamp(-c / a, 0.0, 1.0);
+            }
+            else if (t > 1.0)
+            {
+                t = 1.0;
+                s = cClamp((b - c) / a, 0.0, 1.0);
+            }
+        }
+    }
+
+    c1 = p1 + d1 * s;
+    c2 = p2 + d2 * t;
+    return ((c1 - c2).lengthsq());
+}
+
+
+//===========================================================================
+/*!
+    Constructor of cRailNetwork.
+
+    \param      a_tolerance  Distance within which a point is on a rail.
+    \param      a_cellSize   Edge length of the cells of the spatial index.
+*/
+//===========================================================================
+cRailNetwork::cRailNetwork(double a_tolerance, double a_cellSize)
+{
+    m_tolerance = a_tolerance;
+    m_cellSize = a_cellSize;
+}
+
+
+//===========================================================================
+/*!
+    Remove all segments, junctions and the index.
+*/
+//===========================================================================
+void cRailNetwork::clear()
+{
+    m_segments.clear();
+    m_junctions.clear();
+    m_cellKeys.clear();
+    m_cellStart.clear();
+    m_cellSegments.clear();
+}
+
+
+//===========================================================================
+/*!
+    Add a segment to the network.
+
+    \param      a_pointA  First end point.
+    \param      a_pointB  Second end point.
+    \return     Index of the new segment.
+*/
+//===========================================================================
+int cRailNetwork::addSegment(const cVector3d& a_pointA, const cVector3d& a_pointB)
+{
+    cRailSegment segment;
+    segment.m_pointA = a_pointA;
+    segment.m_pointB = a_pointB;
+    segment.m_direction = a_pointB - a_pointA;
+    segment.m_length = segment.m_direction.length();
+    if (segment.m_length > CHAI_SMALL)
+    {
+        segment.m_direction.mul(1.0 / segment.m_length);
+    }
+    else
+    {
+        segment.m_direction.zero();
+    }
+
+    m_segments.push_back(segment);
+    return ((int)m_segments.size() - 1);
+}
+
+
+//===========================================================================
+/*!
+    Build the spatial index and detect the junctions. Each segment is
+    stored in every cell it passes through; two segments sharing a cell
+    and coming closer than the tolerance form a junction.
+*/
+//===========================================================================
+void cRailNetwork::build()
+{
+    m_junctions.clear();
+    m_cellKeys.clear();
+    m_cellStart.clear();
+    m_cellSegments.clear();
+
+    // list the cells crossed by each segment
+    std::vector< std::pair<unsigned long long, int> > entries;
+    const double halfDiagonal = 0.5 * sqrt(3.0) * m_cellSize;
+
+    for (int s=0; s<(int)m_segments.size(); s++)
+    {
+        const cRailSegment& segment = m_segments[s];
+        int lo[3], hi[3];
+        for (int k=0; k<3; k++)
+        {
+            lo[k] = cellCoord(cMin(segment.m_pointA[k], segment.m_pointB[k]) - m_tolerance);
+            hi[k] = cellCoord(cMax(segment.m_pointA[k], segment.m_pointB[k]) + m_tolerance);
+        }
+
+        for (int i=lo[0]; i<=hi[0]; i++)
+        for (int j=lo[1]; j<=hi[1]; j++)
+        for (int k=lo[2]; k<=hi[2]; k++)
+        {
+            cVector3d center((i + 0.5) * m_cellSize,
+                             (j + 0.5) * m_cellSize,
+                             (k + 0.5) * m_cellSize);
+            double distance = (closestPointOnSegment(s, center) - center).length();
+            if (distance <= halfDiagonal + m_tolerance)
+            {
+                entries.push_back(std::make_pair(cellKey(i, j, k), s));
+            }
+        }
+    }
+
+    // group the entries by cell
+    std::sort(entries.begin(), entries.end());
+    m_cellSegments.reserve(entries.size());
+    for (unsigned int n=0; n<entries.size(); n++)
+    {
+        if (m_cellKeys.empty() || (m_cellKeys.back() != entries[n].first))
+        {
+            m_cellKeys.push_back(entries[n].first);
+            m_cellStart.push_back((int)n);
+        }
+        m_cellSegments.push_back(entries[n].second);
+    }
+    m_cellStart.push_back((int)entries.size());
+
+    // detect junctions between segments sharing a cell
+    std::vector< std::pair<int, int> > pairs;
+    for (unsigned int c=0; c<m_cellKeys.size(); c++)
+    {
+        for (int m=m_cellStart[c]; m<m_cellStart[c+1]; m++)
+        {
+            for (int n=m+1; n<m_cellStart[c+1]; n++)
+            {
+                int a = cMin(m_cellSegments[m], m_cellSegments[n]);
+                int b = cMax(m_cellSegments[m], m_cellSegments[n]);
+                pairs.push_back(std::make_pair(a, b));
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    for (unsigned int n=0; n<pairs.size(); n++)
+    {
+        const cRailSegment& a = m_segments[pairs[n].first];
+        const cRailSegment& b = m_segments[pairs[n].second];
+        cVector3d ca, cb;
+        double distanceSq = closestPointsSegmentSegment(a.m_pointA, a.m_pointB,
+                                                        b.m_pointA, b.m_pointB,
+                                                        ca, cb);
+        if (distanceSq <= m_tolerance * m_tolerance)
+        {
+            cRailJunction junction;
+            junction.m_pos = 0.5 * (ca + cb);
+            junction.m_segmentA = pairs[n].first;
+            junction.m_segmentB = pairs[n].second;
+            m_junctions.push_back(junction);
+        }
+    }
+}
+
+
+//===========================================================================
+/*!
+    Find the segment closest to a point.
+
+    \param      a_point         Query point.
+    \param      a_maxDistance   Segments further away are ignored.
+    \param      a_segment       Returned index of the closest segment.
+    \param      a_closestPoint  Returned closest point on that segment.
+    \return     True if a segment lies within a_maxDistance.
+*/
+//===========================================================================
+bool cRailNetwork::findClosestSegment(const cVector3d& a_point,
+                                      double a_maxDistance,
+                                      int& a_segment,
+                                      cVector3d& a_closestPoint) const
+{
+    double bestDistanceSq = a_maxDistance * a_maxDistance;
+    bool found = false;
+
+    int lo[3], hi[3];
+    for (int k=0; k<3; k++)
+    {
+        lo[k] = cellCoord(a_point[k] - a_maxDistance);
+        hi[k] = cellCoord(a_point[k] + a_maxDistance);
+    }
+
+    for (int i=lo[0]; i<=hi[0]; i++)
+    for (int j=lo[1]; j<=hi[1]; j++)
+    for (int k=lo[2]; k<=hi[2]; k++)
+    {
+        int begin, end;
+        if (!findCell(cellKey(i, j, k), begin, end)) { continue; }
+
+        for (int n=begin; n<end; n++)
+        {
+            int s = m_cellSegments[n];
+            cVector3d closest = closestPointOnSegment(s, a_point);
+            double distanceSq = (closest - a_point).lengthsq();
+            if (distanceSq <= bestDistanceSq)
+            {
+                bestDistanceSq = distanceSq;
+                a_segment = s;
+                a_closestPoint = closest;
+                found = true;
+            }
+        }
+    }
+
+    return (found);
+}
+
+
+//===========================================================================
+/*!
+    Move a point by a displacement while keeping it on the rails. Among the
+    segments passing within the tolerance of the point, the one best
+    aligned with the displacement is followed, which lets an object turn
+    onto any branch at a junction. The displacement is projected onto that
+    segment and the result is clamped to its end points.
+
+    \param      a_point         Current position.
+    \param      a_displacement  Requested displacement.
+    \param      a_newPoint      Returned position, on a rail.
+    \return     False if a_point is not on any rail; a_newPoint is then
+                a_point.
+*/
+//===========================================================================
+bool cRailNetwork::moveAlongRails(const cVector3d& a_point,
+                                  const cVector3d& a_displacement,
+                                  cVector3d& a_newPoint) const
+{
+    double toleranceSq = m_tolerance * m_tolerance;
+    double bestAlignment = -1.0;
+    int bestSegment = -1;
+
+    int lo[3], hi[3];
+    for (int k=0; k<3; k++)
+    {
+        lo[k] = cellCoord(a_point[k] - m_tolerance);
+        hi[k] = cellCoord(a_point[k] + m_tolerance);
+    }
+
+    for (int i=lo[0]; i<=hi[0]; i++)
+    for (int j=lo[1]; j<=hi[1]; j++)
+    for (int k=lo[2]; k<=hi[2]; k++)
+    {
+        int begin, end;
+        if (!findCell(cellKey(i, j, k), begin, end)) { continue; }
+
+        for (int n=begin; n<end; n++)
+        {
+            int s = m_cellSegments[n];
+            if ((closestPointOnSegment(s, a_point) - a_point).lengthsq() > toleranceSq)
+            {
+                continue;
+            }
+            double alignment = cAbs(a_displacement.dot(m_segments[s].m_direction));
+            if (alignment > bestAlignment)
+            {
+                bestAlignment = alignment;
+                bestSegment = s;
+            }
+        }
+    }
+
+    if (bestSegment < 0)
+    {
+        a_newPoint = a_point;
+        return (false);
+    }
+
+    const cRailSegment& segment = m_segments[bestSegment];
+    cVector3d target = a_point + segment.m_direction * a_displacement.dot(segment.m_direction);
+    a_newPoint = closestPointOnSegment(bestSegment, target);
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Closest point on a segment to a point.
+
+    \param      a_segment  Index of the segment.
+    \param      a_point    Query point.
+    \return     Closest point on the segment.
+*/
+//===========================================================================
+cVector3d cRailNetwork::closestPointOnSegment(int a_segment, const cVector3d& a_point) const
+{
+    const cRailSegment& segment = m_segments[a_segment];
+    double t = (a_point - segment.m_pointA).dot(segment.m_direction);
+    t = cClamp(t, 0.0, segment.m_length);
+    return (segment.m_pointA + segment.m_direction * t);
+}
+
+
+//===========================================================================
+/*!
+    Key of a grid cell, packing its three integer coordinates.
+*/
+//===========================================================================
+unsigned long long cRailNetwork::cellKey(int a_i, int a_j, int a_k)
+{
+    const unsigned long long mask = (1ULL << RAIL_CELL_BITS) - 1;
+    return (((unsigned long long)(a_i + RAIL_CELL_OFFSET) & mask) << (2 * RAIL_CELL_BITS) |
+            ((unsigned long long)(a_j + RAIL_CELL_OFFSET) & mask) << RAIL_CELL_BITS |
+            ((unsigned long long)(a_k + RAIL_CELL_OFFSET) & mask));
+}
+
+
+//===========================================================================
+/*!
+    Integer cell coordinate of a scalar coordinate.
+*/
+//===========================================================================
+int cRailNetwork::cellCoord(double a_value) const
+{
+    return ((int)floor(a_value / m_cellSize));
+}
+
+
+//===========================================================================
+/*!
+    Look up a cell of the index.
+
+    \param      a_key    Key of the cell.
+    \param      a_begin  Returned first entry of the cell in m_cellSegments.
+    \param      a_end    Returned end of the entries of the cell.
+    \return     False if no segment crosses the cell.
+*/
+//===========================================================================
+bool cRailNetwork::findCell(unsigned long long a_key, int& a_begin, int& a_end) const
+{
+    std::vector<unsigned long long>::const_iterator it =
+        std::lower_bound(m_cellKeys.begin(), m_cellKeys.end(), a_key);
+    if ((it == m_cellKeys.end()) || (*it != a_key)) { return (false); }
+
+    int cell = (int)(it - m_cellKeys.begin());
+    a_begin = m_cellStart[cell];
+    a_end = m_cellStart[cell+1];
+    return (true);
+}
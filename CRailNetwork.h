@@ -0,0 +1,173 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CRailNetwork.h
+
+    \brief
+    Network of 3D rail segments with junctions and a spatial index, used
+    to constrain the motion of objects to the rails.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CRailNetworkH
+#define CRailNetworkH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// a straight rail between two points
+struct cRailSegment
+{
+    // end points of the segment
+    cVector3d m_pointA;
+    cVector3d m_pointB;
+
+    // unit direction from A to B and length of the segment
+    cVector3d m_direction;
+    double m_length;
+};
+
+// a point where two segments meet or cross
+struct cRailJunction
+{
+    // position of the junction
+    cVector3d m_pos;
+
+    // the two segments meeting at the junction
+    int m_segmentA;
+    int m_segmentB;
+};
+
+
+//===========================================================================
+/*!
+    \class      cRailNetwork
+    \brief      Rail segments in arbitrary 3D directions stored in a uniform
+                grid, so that finding the rails near a point costs a few
+                binary searches regardless of the number of segments.
+
+    Segments are added with addSegment(), then build() detects junctions
+    and builds the index. The index is stored as a sorted table of
+    occupied cells with offsets into a flat list of segment indices, so
+    queries never allocate and touch contiguous memory only.
+
+    Once built, the network is immutable and may be queried from any
+    thread.
+*/
+//===========================================================================
+class cRailNetwork
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cRailNetwork.
+    cRailNetwork(double a_tolerance = 0.01, double a_cellSize = 0.1);
+
+    //! Destructor of cRailNetwork.
+    ~cRailNetwork() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - CONSTRUCTION:
+    //-----------------------------------------------------------------------
+
+    //! Remove all segments.
+    void clear();
+
+    //! Add a segment; returns its index. build() must be called afterwards.
+    int addSegment(const cVector3d& a_pointA, const cVector3d& a_pointB);
+
+    //! Detect junctions and build the spatial index.
+    void build();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - QUERIES:
+    //-----------------------------------------------------------------------
+
+    //! Distance within which a point is considered to be on a rail.
+    double getTolerance() const { return (m_tolerance); }
+
+    //! Number of segments.
+    int getNumSegments() const { return ((int)m_segments.size()); }
+
+    //! Segment by index.
+    const cRailSegment& getSegment(int a_index) const { return (m_segments[a_index]); }
+
+    //! Number of junctions.
+    int getNumJunctions() const { return ((int)m_junctions.size()); }
+
+    //! Junction by index.
+    const cRailJunction& getJunction(int a_index) const { return (m_junctions[a_index]); }
+
+    //! Find the segment closest to a point, within a_maxDistance.
+    bool findClosestSegment(const cVector3d& a_point,
+                            double a_maxDistance,
+                            int& a_segment,
+                            cVector3d& a_closestPoint) const;
+
+    //! Move a point lying on the network by a displacement, keeping it on the rails.
+    bool moveAlongRails(const cVector3d& a_point,
+                        const cVector3d& a_displacement,
+                        cVector3d& a_newPoint) const;
+
+    //! Closest point on a segment to a point.
+    cVector3d closestPointOnSegment(int a_segment, const cVector3d& a_point) const;
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Key of the grid cell with integer coordinates (i, j, k).
+    static unsigned long long cellKey(int a_i, int a_j, int a_k);
+
+    //! Integer cell coordinate of a scalar coordinate.
+    int cellCoord(double a_value) const;
+
+    //! Range of segment indices stored in a cell; false if the cell is empty.
+    bool findCell(unsigned long long a_key, int& a_begin, int& a_end) const;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Distance within which a point is considered to be on a rail.
+    double m_tolerance;
+
+    //! Edge length of a grid cell.
+    double m_cellSize;
+
+    //! Segments of the network.
+    std::vector<cRailSegment> m_segments;
+
+    //! Junctions detected by build().
+    std::vector<cRailJunction> m_junctions;
+
+    //! Sorted keys of the occupied cells.
+    std::vector<unsigned long long> m_cellKeys;
+
+    //! For each occupied cell, offset of its first entry in m_cellSegments;
+    //! one extra element marks the end of the last cell.
+    std::vector<int> m_cellStart;
+
+    //! Segment indices of all occupied cells, cell after cell.
+    std::vector<int> m_cellSegments;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,241 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CRailPhysics.cpp
+
+    \brief
+    Fixed-timestep simulation of an object sliding on the rail network,
+    running at its own rate and coupled to the haptic loop through
+    lock-free mailboxes.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CRailPhysics.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cRailPhysics. The default parameters reproduce the
+    original behavior of the cube, whose speed was the pushing force
+    divided by 0.4, with a short 50 ms time constant added by the mass.
+*/
+//===========================================================================
+cRailPhysics::cRailPhysics()
+{
+    m_mass = 0.02;
+    m_damping = 0.4;
+    m_maxSpeed = 10.0;
+    m_timeStep = 0.001;
+    m_maxSubsteps = 20;
+    m_maxExtrapolation = 0.01;
+
+    m_rails = NULL;
+    m_numChannels = 1;
+    m_accumulator = 0.0;
+    for (int i=0; i<MAX_PHYSICS_CHANNELS; i++)
+    {
+        m_forces[i].zero();
+    }
+}
+
+
+//===========================================================================
+/*!
+    Set the rails, the initial position of the object and the number of
+    haptic loops, and publish the initial state to each of them. Must be
+    called before the threads are started.
+
+    \param      a_rails        Rails constraining the object.
+    \param      a_pos          Initial position of the object.
+    \param      a_numChannels  Number of haptic loops, at most MAX_PHYSICS_CHANNELS.
+*/
+//===========================================================================
+void cRailPhysics::initialize(const cRailNetwork* a_rails, const cVector3d& a_pos, int a_numChannels)
+{
+    m_rails = a_rails;
+    m_numChannels = cClamp(a_numChannels, 1, MAX_PHYSICS_CHANNELS);
+
+    m_state = cPhysicsState();
+    m_state.m_pos = a_pos;
+    m_accumulator = 0.0;
+
+    for (int i=0; i<m_numChannels; i++)
+    {
+        cPhysicsChannel& channel = m_channels[i];
+        channel.m_lastInput = cPhysicsInput();
+        m_forces[i].zero();
+
+        channel.m_output.writeBuffer() = m_state;
+        channel.m_output.publish();
+
+        channel.m_sentInput = cPhysicsInput();
+        channel.m_receivedState = m_state;
+        channel.m_stateAge = 0.0;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Advance the simulation by the fixed steps fitting in the elapsed time.
+    The time left over is kept for the next call. Runs on the physics
+    thread.
+
+    \param      a_elapsed  Wall-clock time since the previous call [s].
+    \return     Number of steps taken.
+*/
+//===========================================================================
+int cRailPhysics::update(double a_elapsed)
+{
+    // sum of the average forces applied by each haptic loop since the
+    // previous update; a loop that sent nothing keeps its last force
+    cVector3d force(0,0,0);
+    bool userSwitch = false;
+    for (int i=0; i<m_numChannels; i++)
+    {
+        cPhysicsChannel& channel = m_channels[i];
+        const cPhysicsInput& input = channel.m_input.read();
+        double inputTime = input.m_time - channel.m_lastInput.m_time;
+        if (inputTime > 0.0)
+        {
+            m_forces[i] = (1.0 / inputTime) * (input.m_impulse - channel.m_lastInput.m_impulse);
+        }
+        channel.m_lastInput = input;
+
+        force += m_forces[i];
+        userSwitch = userSwitch || input.m_userSwitch;
+    }
+
+    // clamp the elapsed time so that a hiccup costs a bounded amount of work
+    double maxElapsed = m_maxSubsteps * m_timeStep;
+    m_accumulator += cClamp(a_elapsed, 0.0, maxElapsed);
+    if (m_accumulator > maxElapsed) { m_accumulator = maxElapsed; }
+
+    int numSteps = 0;
+    while (m_accumulator >= m_timeStep)
+    {
+        step(force, userSwitch);
+        m_accumulator -= m_timeStep;
+        numSteps++;
+    }
+
+    if (numSteps > 0)
+    {
+        for (int i=0; i<m_numChannels; i++)
+        {
+            m_channels[i].m_output.writeBuffer() = m_state;
+            m_channels[i].m_output.publish();
+        }
+    }
+
+    return (numSteps);
+}
+
+
+//===========================================================================
+/*!
+    Advance the state by one fixed step: semi-implicit Euler on a
+    mass-damper, then projection of the motion onto the rails. The
+    velocity is replaced by the motion actually allowed by the rails, so
+    the object stops at rail ends.
+
+    \param      a_force       Force applied on the object [N].
+    \param      a_userSwitch  If true, the object is held in place.
+*/
+//===========================================================================
+void cRailPhysics::step(const cVector3d& a_force, bool a_userSwitch)
+{
+    const double dt = m_timeStep;
+
+    cVector3d acc = (1.0 / m_mass) * (a_force - m_damping * m_state.m_vel);
+    m_state.m_vel += dt * acc;
+
+    double speed = m_state.m_vel.length();
+    if (speed > m_maxSpeed)
+    {
+        m_state.m_vel.mul(m_maxSpeed / speed);
+    }
+
+    if (a_userSwitch)
+    {
+        m_state.m_vel.zero();
+    }
+
+    cVector3d newPos = m_state.m_pos;
+    if ((m_rails != NULL) &&
+        m_rails->moveAlongRails(m_state.m_pos, dt * m_state.m_vel, newPos))
+    {
+        m_state.m_vel = (1.0 / dt) * (newPos - m_state.m_pos);
+        m_state.m_pos = newPos;
+    }
+    else
+    {
+        m_state.m_vel.zero();
+    }
+
+    m_state.m_time += dt;
+    m_state.m_numSteps++;
+}
+
+
+//===========================================================================
+/*!
+    Apply a force on the object during one haptic tick. Runs on the haptics
+    thread owning the channel.
+
+    \param      a_channel       Channel of the haptic loop.
+    \param      a_force         Force applied on the object [N].
+    \param      a_timeInterval  Duration of the tick [s].
+    \param      a_userSwitch    Status of the user switch.
+*/
+//===========================================================================
+void cRailPhysics::addForce(int a_channel, const cVector3d& a_force, double a_timeInterval, bool a_userSwitch)
+{
+    cPhysicsChannel& channel = m_channels[a_channel];
+    channel.m_sentInput.m_impulse += a_timeInterval * a_force;
+    channel.m_sentInput.m_time += a_timeInterval;
+    channel.m_sentInput.m_userSwitch = a_userSwitch;
+
+    channel.m_input.writeBuffer() = channel.m_sentInput;
+    channel.m_input.publish();
+}
+
+
+//===========================================================================
+/*!
+    Local model used by the haptic loop between two physics updates: the
+    last published state is moved along the rails at its velocity for the
+    time elapsed since it was received, up to m_maxExtrapolation. Runs on
+    the haptics thread owning the channel.
+
+    \param      a_channel       Channel of the haptic loop.
+    \param      a_timeInterval  Time since the previous call [s].
+    \return     Predicted position of the object.
+*/
+//===========================================================================
+cVector3d cRailPhysics::extrapolate(int a_channel, double a_timeInterval)
+{
+    cPhysicsChannel& channel = m_channels[a_channel];
+
+    bool isNew;
+    const cPhysicsState& state = channel.m_output.read(isNew);
+    if (isNew)
+    {
+        channel.m_receivedState = state;
+        channel.m_stateAge = 0.0;
+    }
+    else
+    {
+        channel.m_stateAge = cMin(channel.m_stateAge + a_timeInterval, m_maxExtrapolation);
+    }
+
+    const cPhysicsState& received = channel.m_receivedState;
+    cVector3d pos = received.m_pos;
+    if ((m_rails != NULL) && (channel.m_stateAge > 0.0))
+    {
+        m_rails->moveAlongRails(received.m_pos, channel.m_stateAge * received.m_vel, pos);
+    }
+    return (pos);
+}
@@ -0,0 +1,204 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CRailPhysics.h
+
+    \brief
+    Fixed-timestep simulation of an object sliding on the rail network,
+    running at its own rate and coupled to the haptic loop through
+    lock-free mailboxes.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CRailPhysicsH
+#define CRailPhysicsH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTripleBuffer.h"
+#include "CRailNetwork.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// maximum number of haptic loops feeding and reading the physics
+const int MAX_PHYSICS_CHANNELS = 8;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// input sent by the haptic loop; impulse and time are running totals so
+// that no force is lost when the physics misses intermediate samples
+struct cPhysicsInput
+{
+    cPhysicsInput() : m_impulse(0,0,0), m_time(0.0), m_userSwitch(false) {}
+
+    // total impulse applied on the object by the tool [N*s]
+    cVector3d m_impulse;
+
+    // total haptic time over which the impulse was accumulated [s]
+    double m_time;
+
+    // status of the user switch (stops the object)
+    bool m_userSwitch;
+};
+
+// state published by the physics for the haptic loop and the display
+struct cPhysicsState
+{
+    cPhysicsState() : m_pos(0,0,0), m_vel(0,0,0), m_time(0.0), m_numSteps(0) {}
+
+    // position and velocity of the object
+    cVector3d m_pos;
+    cVector3d m_vel;
+
+    // simulated time and number of fixed steps taken so far
+    double m_time;
+    unsigned long m_numSteps;
+};
+
+// link between the physics and one haptic loop
+struct cPhysicsChannel
+{
+    cPhysicsChannel() : m_stateAge(0.0) {}
+
+    // mailboxes between the haptics thread and the physics thread
+    cTripleBuffer<cPhysicsInput> m_input;
+    cTripleBuffer<cPhysicsState> m_output;
+
+    // physics thread: last input read
+    cPhysicsInput m_lastInput;
+
+    // haptics thread: running totals sent, last state read and its age
+    cPhysicsInput m_sentInput;
+    cPhysicsState m_receivedState;
+    double m_stateAge;
+};
+
+
+//===========================================================================
+/*!
+    \class      cRailPhysics
+    \brief      Mass-damper object constrained to a cRailNetwork, integrated
+                with a fixed time step.
+
+    update() is given the wall-clock time elapsed since its previous call
+    and advances the simulation by as many fixed steps as fit in it. The
+    elapsed time is clamped first, so a scheduling hiccup costs at most a
+    bounded number of substeps and never produces a large jump.
+
+    Each haptic loop owns a channel. It feeds forces with addForce() and
+    reads back the state with extrapolate(), which predicts the position
+    of the object between two physics updates from the last published
+    velocity. The physics sums the forces of all channels and publishes
+    its state to each of them. A channel is only used by its own haptics
+    thread and by the physics thread, and the two sides only exchange data
+    through triple buffers, so no thread ever waits for another.
+*/
+//===========================================================================
+class cRailPhysics
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cRailPhysics.
+    cRailPhysics();
+
+    //! Destructor of cRailPhysics.
+    ~cRailPhysics() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - SETUP:
+    //-----------------------------------------------------------------------
+
+    //! Set the rails, the initial position and the number of haptic loops; call before starting the threads.
+    void initialize(const cRailNetwork* a_rails, const cVector3d& a_pos, int a_numChannels = 1);
+
+    //! Number of haptic loops feeding the physics.
+    int getNumChannels() const { return (m_numChannels); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - PHYSICS THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Advance by the fixed steps fitting in a_elapsed seconds.
+    int update(double a_elapsed);
+
+    //! Current position of the object.
+    const cVector3d& getPos() const { return (m_state.m_pos); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - HAPTICS THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Apply a force on the object during a_timeInterval seconds.
+    void addForce(int a_channel, const cVector3d& a_force, double a_timeInterval, bool a_userSwitch);
+
+    //! Predicted position of the object a_timeInterval after the previous call.
+    cVector3d extrapolate(int a_channel, double a_timeInterval);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Mass of the object [kg].
+    double m_mass;
+
+    //! Viscous damping of the object on the rails [N/(m/s)].
+    double m_damping;
+
+    //! Maximum speed of the object [m/s].
+    double m_maxSpeed;
+
+    //! Fixed integration step [s].
+    double m_timeStep;
+
+    //! Maximum number of steps per update; older time is dropped.
+    int m_maxSubsteps;
+
+    //! Maximum time the haptic side extrapolates past a physics state [s].
+    double m_maxExtrapolation;
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Advance the state by one fixed step under a constant force.
+    void step(const cVector3d& a_force, bool a_userSwitch);
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Rails constraining the object.
+    const cRailNetwork* m_rails;
+
+    //! Links to the haptic loops.
+    cPhysicsChannel m_channels[MAX_PHYSICS_CHANNELS];
+    int m_numChannels;
+
+    //! Physics thread: current state, unconsumed time, force of each channel.
+    cPhysicsState m_state;
+    double m_accumulator;
+    cVector3d m_forces[MAX_PHYSICS_CHANNELS];
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,293 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CRecordingHapticDevice.cpp
+
+    \brief
+    Haptic device wrapper recording every haptic tick of the wrapped
+    device into a memory-mapped binary log.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CRecordingHapticDevice.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cRecordingHapticDevice. The wrapped device keeps its
+    specifications; nothing is recorded until createLog() is called.
+
+    \param      a_device  Device to record.
+*/
+//===========================================================================
+cRecordingHapticDevice::cRecordingHapticDevice(cGenericHapticDevice* a_device)
+{
+    m_device = a_device;
+    if (m_device != NULL)
+    {
+        m_specifications = m_device->getSpecifications();
+    }
+
+    m_systemAvailable = (m_device != NULL);
+    m_systemReady = false;
+    m_header = NULL;
+    m_records = NULL;
+    m_current = NULL;
+    m_numRecords = 0;
+    m_numDropped = 0;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cRecordingHapticDevice. The wrapped device is not deleted.
+*/
+//===========================================================================
+cRecordingHapticDevice::~cRecordingHapticDevice()
+{
+    closeLog();
+}
+
+
+//===========================================================================
+/*!
+    Create the log file, sized for a_capacity ticks, and write its header.
+
+    \param      a_filename  Path of the log.
+    \param      a_capacity  Maximum number of ticks recorded.
+    \return     Return true if the log was created.
+*/
+//===========================================================================
+bool cRecordingHapticDevice::createLog(const char* a_filename, unsigned long a_capacity)
+{
+    closeLog();
+
+    size_t size = sizeof(cDeviceRecordingHeader) + (size_t)a_capacity * sizeof(cDeviceRecord);
+    if (!m_log.create(a_filename, size)) { return (false); }
+
+    m_header = (cDeviceRecordingHeader*)m_log.getData();
+    m_records = (cDeviceRecord*)(m_log.getData() + sizeof(cDeviceRecordingHeader));
+
+    m_header->m_magic = DEVICE_RECORDING_MAGIC;
+    m_header->m_version = DEVICE_RECORDING_VERSION;
+    m_header->m_headerSize = sizeof(cDeviceRecordingHeader);
+    m_header->m_recordSize = sizeof(cDeviceRecord);
+    m_header->m_numRecords = 0;
+    m_header->m_capacity = a_capacity;
+    m_header->m_maxForce = m_specifications.m_maxForce;
+    m_header->m_maxForceStiffness = m_specifications.m_maxForceStiffness;
+    m_header->m_maxLinearDamping = m_specifications.m_maxLinearDamping;
+    m_header->m_workspaceRadius = m_specifications.m_workspaceRadius;
+
+    m_numRecords = 0;
+    m_numDropped = 0;
+    m_current = NULL;
+    m_clock.start(true);
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Count the record of the current tick in the header.
+*/
+//===========================================================================
+void cRecordingHapticDevice::commitRecord()
+{
+    if (m_current == NULL) { return; }
+
+    m_numRecords++;
+    m_header->m_numRecords = m_numRecords;
+    m_current = NULL;
+}
+
+
+//===========================================================================
+/*!
+    Commit the last tick, trim the log to the recorded ticks and close it.
+*/
+//===========================================================================
+void cRecordingHapticDevice::closeLog()
+{
+    if (!m_log.isOpen()) { return; }
+
+    commitRecord();
+    m_log.close(sizeof(cDeviceRecordingHeader) + (size_t)m_numRecords * sizeof(cDeviceRecord));
+    m_header = NULL;
+    m_records = NULL;
+}
+
+
+//===========================================================================
+/*!
+    Open connection to the wrapped device.
+
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::open()
+{
+    if (m_device == NULL) { return (-1); }
+
+    int result = m_device->open();
+    m_systemReady = (result == 0);
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Close connection to the wrapped device. The log is finished here,
+    since this is the last call made by the tool.
+
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::close()
+{
+    closeLog();
+    m_systemReady = false;
+    if (m_device == NULL) { return (-1); }
+    return (m_device->close());
+}
+
+
+//===========================================================================
+/*!
+    Initialize the wrapped device.
+
+    \param      a_resetEncoders  Passed on to the wrapped device.
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::initialize(const bool a_resetEncoders)
+{
+    if (m_device == NULL) { return (-1); }
+    return (m_device->initialize(a_resetEncoders));
+}
+
+
+//===========================================================================
+/*!
+    Read the position of the wrapped device. The tool reads it once at the
+    start of each tick, so this closes the record of the previous tick and
+    starts a new one.
+
+    \param      a_position  Receives the position [m].
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::getPosition(cVector3d& a_position)
+{
+    if (m_device == NULL) { return (-1); }
+    int result = m_device->getPosition(a_position);
+
+    if (m_log.isOpen())
+    {
+        commitRecord();
+        if (m_numRecords < m_header->m_capacity)
+        {
+            m_current = &m_records[m_numRecords];
+            m_current->m_time = m_clock.getCurrentTimeSeconds();
+            m_current->m_pos[0] = a_position.x;
+            m_current->m_pos[1] = a_position.y;
+            m_current->m_pos[2] = a_position.z;
+        }
+        else
+        {
+            m_numDropped++;
+        }
+    }
+
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Read the velocity of the wrapped device.
+
+    \param      a_linearVelocity  Receives the velocity [m/s].
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::getLinearVelocity(cVector3d& a_linearVelocity)
+{
+    if (m_device == NULL) { return (-1); }
+    int result = m_device->getLinearVelocity(a_linearVelocity);
+
+    if (m_current != NULL)
+    {
+        m_current->m_vel[0] = a_linearVelocity.x;
+        m_current->m_vel[1] = a_linearVelocity.y;
+        m_current->m_vel[2] = a_linearVelocity.z;
+    }
+
+    return (result);
+}
+
+
+//===========================================================================
+/*!
+    Read the orientation of the wrapped device.
+
+    \param      a_rotation  Receives the orientation.
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    if (m_device == NULL) { return (-1); }
+    return (m_device->getRotation(a_rotation));
+}
+
+
+//===========================================================================
+/*!
+    Send a force to the wrapped device. A later command during the same
+    tick replaces it in the record.
+
+    \param      a_force  Force [N].
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::setForce(cVector3d& a_force)
+{
+    if (m_device == NULL) { return (-1); }
+
+    if (m_current != NULL)
+    {
+        m_current->m_force[0] = a_force.x;
+        m_current->m_force[1] = a_force.y;
+        m_current->m_force[2] = a_force.z;
+    }
+
+    return (m_device->setForce(a_force));
+}
+
+
+//===========================================================================
+/*!
+    Read the status of a user switch of the wrapped device. Only switch 0
+    is recorded.
+
+    \param      a_switchIndex  Index of the switch.
+    \param      a_status       Receives the status.
+    \return     Return 0 if no error occurred.
+*/
+//===========================================================================
+int cRecordingHapticDevice::getUserSwitch(int a_switchIndex, bool& a_status)
+{
+    if (m_device == NULL) { return (-1); }
+    int result = m_device->getUserSwitch(a_switchIndex, a_status);
+
+    if ((m_current != NULL) && (a_switchIndex == 0))
+    {
+        m_current->m_userSwitch = a_status ? 1 : 0;
+    }
+
+    return (result);
+}
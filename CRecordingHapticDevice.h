@@ -0,0 +1,137 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CRecordingHapticDevice.h
+
+    \brief
+    Haptic device wrapper recording every haptic tick of the wrapped
+    device into a memory-mapped binary log.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CRecordingHapticDeviceH
+#define CRecordingHapticDeviceH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CMappedFile.h"
+#include "CDeviceRecording.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cRecordingHapticDevice
+    \brief      Forwards every call to another haptic device and records
+                what was read from it and commanded to it, one record per
+                haptic tick.
+
+    A tick starts with the position read of the tool. The velocity and
+    user switch read and the last force commanded until the next position
+    read are stored in the same record, so the record holds the force that
+    actually reached the device.
+
+    The log is allocated and faulted in by createLog(); recording only
+    stores into the mapping and never allocates or calls the system. Ticks
+    beyond the capacity are counted but not recorded. close() trims the
+    file to the records written. The record count in the header is updated
+    after every tick, so a log stays readable if the program dies.
+*/
+//===========================================================================
+class cRecordingHapticDevice : public cGenericHapticDevice
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cRecordingHapticDevice; records a_device.
+    cRecordingHapticDevice(cGenericHapticDevice* a_device);
+
+    //! Destructor of cRecordingHapticDevice.
+    virtual ~cRecordingHapticDevice();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - RECORDING:
+    //-----------------------------------------------------------------------
+
+    //! Create a log with room for a_capacity ticks.
+    bool createLog(const char* a_filename, unsigned long a_capacity);
+
+    //! Number of ticks recorded.
+    unsigned long getNumRecords() const { return (m_numRecords); }
+
+    //! Number of ticks not recorded because the log was full.
+    unsigned long getNumDropped() const { return (m_numDropped); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - DEVICE:
+    //-----------------------------------------------------------------------
+
+    //! Open connection to the wrapped device.
+    virtual int open();
+
+    //! Close connection to the wrapped device and finish the log.
+    virtual int close();
+
+    //! Initialize the wrapped device.
+    virtual int initialize(const bool a_resetEncoders=false);
+
+    //! Read the position of the device; starts a new record.
+    virtual int getPosition(cVector3d& a_position);
+
+    //! Read the velocity of the device.
+    virtual int getLinearVelocity(cVector3d& a_linearVelocity);
+
+    //! Read the orientation of the device (not recorded).
+    virtual int getRotation(cMatrix3d& a_rotation);
+
+    //! Send a force to the device.
+    virtual int setForce(cVector3d& a_force);
+
+    //! Read the status of the user switch.
+    virtual int getUserSwitch(int a_switchIndex, bool& a_status);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Count the current record in the header.
+    void commitRecord();
+
+    //! Trim the log to the recorded ticks and close it.
+    void closeLog();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Recorded device.
+    cGenericHapticDevice* m_device;
+
+    //! Mapped log, its header and its records.
+    cMappedFile m_log;
+    cDeviceRecordingHeader* m_header;
+    cDeviceRecord* m_records;
+
+    //! Record of the current tick, NULL between ticks or when not recording.
+    cDeviceRecord* m_current;
+
+    //! Number of ticks recorded and dropped.
+    unsigned long m_numRecords;
+    unsigned long m_numDropped;
+
+    //! Clock giving the time of each record.
+    cPrecisionClock m_clock;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
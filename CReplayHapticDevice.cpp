@@ -0,0 +1,260 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CReplayHapticDevice.cpp
+
+    \brief
+    Haptic device playing back a recording made with
+    cRecordingHapticDevice, one recorded tick per haptic tick.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CReplayHapticDevice.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cReplayHapticDevice. The device is not available until
+    a recording is loaded.
+*/
+//===========================================================================
+cReplayHapticDevice::cReplayHapticDevice()
+{
+    m_specifications.m_manufacturerName   = "none";
+    m_specifications.m_modelName          = "replay";
+    m_specifications.m_maxForce           = 0.0;
+    m_specifications.m_maxForceStiffness  = 0.0;
+    m_specifications.m_maxTorque          = 0.0;
+    m_specifications.m_maxTorqueStiffness = 0.0;
+    m_specifications.m_maxLinearDamping   = 0.0;
+    m_specifications.m_workspaceRadius    = 0.0;
+    m_specifications.m_sensedPosition     = true;
+    m_specifications.m_sensedRotation     = false;
+    m_specifications.m_actuatedPosition   = true;
+    m_specifications.m_actuatedRotation   = false;
+    m_specifications.m_rightHand          = true;
+    m_specifications.m_leftHand           = true;
+    m_specifications.m_positionOffset     = 0.0;
+
+    m_systemAvailable = false;
+    m_systemReady = false;
+    m_records = NULL;
+    m_numRecords = 0;
+    m_index = 0;
+    m_numReplayed = 0;
+    m_loop = true;
+    m_maxForceDeviation = 0.0;
+    m_commandedForce.zero();
+    m_hasCommand = false;
+}
+
+
+//===========================================================================
+/*!
+    Map a recording and check its header. The specifications stored in
+    the recording replace those of the device, so that the tool derives
+    the same workspace scale and stiffness as during the recording.
+
+    \param      a_filename  Path of the recording.
+    \return     Return true if the recording holds at least one tick.
+*/
+//===========================================================================
+bool cReplayHapticDevice::load(const char* a_filename)
+{
+    m_records = NULL;
+    m_numRecords = 0;
+    m_systemAvailable = false;
+
+    if (!m_file.openReadOnly(a_filename)) { return (false); }
+
+    // check the layout before trusting the counts
+    const cDeviceRecordingHeader* header = (const cDeviceRecordingHeader*)m_file.getData();
+    if ((m_file.getSize() < sizeof(cDeviceRecordingHeader)) ||
+        (header->m_magic != DEVICE_RECORDING_MAGIC) ||
+        (header->m_version != DEVICE_RECORDING_VERSION) ||
+        (header->m_headerSize != sizeof(cDeviceRecordingHeader)) ||
+        (header->m_recordSize != sizeof(cDeviceRecord)))
+    {
+        m_file.close();
+        return (false);
+    }
+
+    // a log cut short by a crash may hold fewer records than its header says
+    unsigned long long available = (m_file.getSize() - sizeof(cDeviceRecordingHeader)) / sizeof(cDeviceRecord);
+    unsigned long long numRecords = (header->m_numRecords < available) ? header->m_numRecords : available;
+    if (numRecords == 0)
+    {
+        m_file.close();
+        return (false);
+    }
+
+    m_records = (const cDeviceRecord*)(m_file.getData() + sizeof(cDeviceRecordingHeader));
+    m_numRecords = (unsigned long)numRecords;
+
+    m_specifications.m_maxForce           = header->m_maxForce;
+    m_specifications.m_maxForceStiffness  = header->m_maxForceStiffness;
+    m_specifications.m_maxLinearDamping   = header->m_maxLinearDamping;
+    m_specifications.m_workspaceRadius    = header->m_workspaceRadius;
+
+    m_systemAvailable = true;
+    initialize();
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Open connection to the replayed device.
+
+    \return     Return 0 if a recording is loaded, -1 otherwise.
+*/
+//===========================================================================
+int cReplayHapticDevice::open()
+{
+    m_systemReady = m_systemAvailable;
+    return (m_systemReady ? 0 : -1);
+}
+
+
+//===========================================================================
+/*!
+    Close connection to the replayed device.
+
+    \return     Always 0.
+*/
+//===========================================================================
+int cReplayHapticDevice::close()
+{
+    m_systemReady = false;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Restart the replay at the first tick.
+
+    \param      a_resetEncoders  Ignored.
+    \return     Always 0.
+*/
+//===========================================================================
+int cReplayHapticDevice::initialize(const bool a_resetEncoders)
+{
+    m_index = m_numRecords;
+    m_numReplayed = 0;
+    m_maxForceDeviation = 0.0;
+    m_hasCommand = false;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Move to the next recorded tick and read its position. The last force
+    commanded during the previous tick is compared with the recorded one
+    first.
+
+    \param      a_position  Receives the position [m].
+    \return     Return 0 if a recording is loaded, -1 otherwise.
+*/
+//===========================================================================
+int cReplayHapticDevice::getPosition(cVector3d& a_position)
+{
+    if (m_numRecords == 0) { a_position.zero(); return (-1); }
+
+    // the tool may command several forces per tick; only the last one
+    // reached the device and was recorded
+    if (m_hasCommand && (m_index < m_numRecords))
+    {
+        const cDeviceRecord& record = m_records[m_index];
+        cVector3d recorded(record.m_force[0], record.m_force[1], record.m_force[2]);
+        double deviation = cDistance(m_commandedForce, recorded);
+        if (deviation > m_maxForceDeviation) { m_maxForceDeviation = deviation; }
+    }
+    m_hasCommand = false;
+
+    if (m_index + 1 < m_numRecords)
+    {
+        m_index++;
+    }
+    else if (m_loop || (m_index == m_numRecords))
+    {
+        m_index = 0;
+    }
+    m_numReplayed++;
+
+    const cDeviceRecord& record = m_records[m_index];
+    a_position.set(record.m_pos[0], record.m_pos[1], record.m_pos[2]);
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the velocity recorded for the current tick.
+
+    \param      a_linearVelocity  Receives the velocity [m/s].
+    \return     Return 0 if a recording is loaded, -1 otherwise.
+*/
+//===========================================================================
+int cReplayHapticDevice::getLinearVelocity(cVector3d& a_linearVelocity)
+{
+    if (m_index >= m_numRecords) { a_linearVelocity.zero(); return (-1); }
+
+    const cDeviceRecord& record = m_records[m_index];
+    a_linearVelocity.set(record.m_vel[0], record.m_vel[1], record.m_vel[2]);
+    m_linearVelocity = a_linearVelocity;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the orientation of the device; rotations are not recorded.
+
+    \param      a_rotation  Receives the identity.
+    \return     Always 0.
+*/
+//===========================================================================
+int cReplayHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    a_rotation.identity();
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Store the commanded force; it is compared with the recorded one when
+    the tick ends.
+
+    \param      a_force  Force [N].
+    \return     Always 0.
+*/
+//===========================================================================
+int cReplayHapticDevice::setForce(cVector3d& a_force)
+{
+    m_commandedForce = a_force;
+    m_hasCommand = true;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the status of the user switch recorded for the current tick.
+
+    \param      a_switchIndex  Index of the switch; only switch 0 is recorded.
+    \param      a_status       Receives the status.
+    \return     Always 0.
+*/
+//===========================================================================
+int cReplayHapticDevice::getUserSwitch(int a_switchIndex, bool& a_status)
+{
+    a_status = (a_switchIndex == 0) && (m_index < m_numRecords) &&
+               (m_records[m_index].m_userSwitch != 0);
+    return (0);
+}
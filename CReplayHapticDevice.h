@@ -0,0 +1,136 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CReplayHapticDevice.h
+
+    \brief
+    Haptic device playing back a recording made with
+    cRecordingHapticDevice, one recorded tick per haptic tick.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CReplayHapticDeviceH
+#define CReplayHapticDeviceH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CMappedFile.h"
+#include "CDeviceRecording.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cReplayHapticDevice
+    \brief      Simulated device whose position, velocity and user switch
+                come from a recording, so that a session can be replayed
+                without the physical device.
+
+    Each position read moves to the next recorded tick, as the tool reads
+    the position once per tick; the other reads return the same tick. The
+    recording is mapped read-only and read in place. At the end of the
+    recording the replay either starts over or holds the last tick.
+
+    The last force commanded during each tick of the replay is compared
+    with the recorded one, so that a change in force rendering shows up as
+    a deviation.
+*/
+//===========================================================================
+class cReplayHapticDevice : public cGenericHapticDevice
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cReplayHapticDevice.
+    cReplayHapticDevice();
+
+    //! Destructor of cReplayHapticDevice.
+    virtual ~cReplayHapticDevice() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - REPLAY:
+    //-----------------------------------------------------------------------
+
+    //! Map a recording and take over the specifications of the recorded device.
+    bool load(const char* a_filename);
+
+    //! Number of ticks in the recording.
+    unsigned long getNumRecords() const { return (m_numRecords); }
+
+    //! Index of the tick being replayed.
+    unsigned long getIndex() const { return (m_index); }
+
+    //! True once every recorded tick has been replayed at least once.
+    bool isFinished() const { return (m_numReplayed >= m_numRecords); }
+
+    //! Start over at the end of the recording instead of holding the last tick.
+    void setLoop(bool a_loop) { m_loop = a_loop; }
+
+    //! Largest difference between a commanded and the recorded force [N].
+    double getMaxForceDeviation() const { return (m_maxForceDeviation); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - DEVICE:
+    //-----------------------------------------------------------------------
+
+    //! Open connection to the replayed device.
+    virtual int open();
+
+    //! Close connection to the replayed device.
+    virtual int close();
+
+    //! Restart the replay at the first tick.
+    virtual int initialize(const bool a_resetEncoders=false);
+
+    //! Move to the next tick and read its position.
+    virtual int getPosition(cVector3d& a_position);
+
+    //! Read the velocity of the current tick.
+    virtual int getLinearVelocity(cVector3d& a_linearVelocity);
+
+    //! Read the orientation of the device (always identity).
+    virtual int getRotation(cMatrix3d& a_rotation);
+
+    //! Store the commanded force, compared with the recorded one at the end of the tick.
+    virtual int setForce(cVector3d& a_force);
+
+    //! Read the status of the user switch of the current tick.
+    virtual int getUserSwitch(int a_switchIndex, bool& a_status);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Mapped recording and its records.
+    cMappedFile m_file;
+    const cDeviceRecord* m_records;
+    unsigned long m_numRecords;
+
+    //! Index of the current tick; m_numRecords before the first position read.
+    unsigned long m_index;
+
+    //! Number of position reads since the start of the replay.
+    unsigned long m_numReplayed;
+
+    //! Start over at the end of the recording.
+    bool m_loop;
+
+    //! Largest difference between a commanded and the recorded force.
+    double m_maxForceDeviation;
+
+    //! Last force commanded during the current tick, if any.
+    cVector3d m_commandedForce;
+    bool m_hasCommand;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,248 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CSceneFile.cpp
+
+    \brief
+    Scene file mapped into memory and turned into CHAI3D objects.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CSceneFile.h"
+//---------------------------------------------------------------------------
+#include <string.h>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cSceneFile. No scene is loaded.
+*/
+//===========================================================================
+cSceneFile::cSceneFile()
+{
+    m_header = NULL;
+    m_meshes = NULL;
+    m_vertices = NULL;
+    m_triangles = NULL;
+    m_rails = NULL;
+    m_fields = NULL;
+}
+
+
+//===========================================================================
+/*!
+    Check that a table lies inside the mapped file and is aligned for its
+    entries.
+
+    \param      a_offset  Position of the table [bytes].
+    \param      a_count   Number of entries.
+    \param      a_size    Size of an entry [bytes].
+    \return     Return true if the table can be read in place.
+*/
+//===========================================================================
+bool cSceneFile::checkTable(unsigned long long a_offset, unsigned int a_count, unsigned int a_size) const
+{
+    unsigned long long fileSize = m_file.getSize();
+    if ((a_offset % 8) != 0) { return (false); }
+    if (a_offset > fileSize) { return (false); }
+    return ((unsigned long long)a_count * a_size <= fileSize - a_offset);
+}
+
+
+//===========================================================================
+/*!
+    Map a scene file and check its header, its tables and the vertex and
+    triangle ranges of every mesh, so that nothing read from it later can
+    point outside the mapping.
+
+    \param      a_filename  Path of the scene file.
+    \return     Return true if the scene was loaded.
+*/
+//===========================================================================
+bool cSceneFile::load(const char* a_filename)
+{
+    m_header = NULL;
+    m_meshes = NULL;
+    m_vertices = NULL;
+    m_triangles = NULL;
+    m_rails = NULL;
+    m_fields = NULL;
+
+    m_file.close();
+    if (!m_file.openReadOnly(a_filename)) { return (false); }
+
+    // check the layout before trusting the counts
+    const cSceneFileHeader* header = (const cSceneFileHeader*)m_file.getData();
+    if ((m_file.getSize() < sizeof(cSceneFileHeader)) ||
+        (header->m_magic != SCENE_FILE_MAGIC) ||
+        (header->m_version != SCENE_FILE_VERSION) ||
+        (header->m_headerSize != sizeof(cSceneFileHeader)) ||
+        (header->m_meshSize != sizeof(cSceneMesh)) ||
+        (header->m_vertexSize != sizeof(cSceneVertex)) ||
+        (header->m_triangleSize != sizeof(cSceneTriangle)) ||
+        (header->m_railSize != sizeof(cSceneRail)) ||
+        (header->m_fieldSize != sizeof(cSceneForceField)) ||
+        !checkTable(header->m_meshOffset, header->m_numMeshes, sizeof(cSceneMesh)) ||
+        !checkTable(header->m_vertexOffset, header->m_numVertices, sizeof(cSceneVertex)) ||
+        !checkTable(header->m_triangleOffset, header->m_numTriangles, sizeof(cSceneTriangle)) ||
+        !checkTable(header->m_railOffset, header->m_numRails, sizeof(cSceneRail)) ||
+        !checkTable(header->m_fieldOffset, header->m_numFields, sizeof(cSceneForceField)))
+    {
+        m_file.close();
+        return (false);
+    }
+
+    const unsigned char* data = m_file.getData();
+    const cSceneMesh* meshes = (const cSceneMesh*)(data + header->m_meshOffset);
+    const cSceneTriangle* triangles = (const cSceneTriangle*)(data + header->m_triangleOffset);
+
+    // every mesh must use ranges of the tables and index its own vertices
+    for (unsigned int i=0; i<header->m_numMeshes; i++)
+    {
+        const cSceneMesh& mesh = meshes[i];
+        if ((mesh.m_firstVertex > header->m_numVertices) ||
+            (mesh.m_numVertices > header->m_numVertices - mesh.m_firstVertex) ||
+            (mesh.m_firstTriangle > header->m_numTriangles) ||
+            (mesh.m_numTriangles > header->m_numTriangles - mesh.m_firstTriangle))
+        {
+            m_file.close();
+            return (false);
+        }
+
+        for (unsigned int j=0; j<mesh.m_numTriangles; j++)
+        {
+            const cSceneTriangle& triangle = triangles[mesh.m_firstTriangle + j];
+            if ((triangle.m_vertex[0] >= mesh.m_numVertices) ||
+                (triangle.m_vertex[1] >= mesh.m_numVertices) ||
+                (triangle.m_vertex[2] >= mesh.m_numVertices))
+            {
+                m_file.close();
+                return (false);
+            }
+        }
+    }
+
+    m_header = header;
+    m_meshes = meshes;
+    m_vertices = (const cSceneVertex*)(data + header->m_vertexOffset);
+    m_triangles = triangles;
+    m_rails = (const cSceneRail*)(data + header->m_railOffset);
+    m_fields = (const cSceneForceField*)(data + header->m_fieldOffset);
+
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Add the vertices and triangles of a mesh to a_target and give it the
+    material and transform stored in the file. The haptic properties
+    depend on the device and are left to the caller.
+
+    \param      a_mesh    Mesh of this file.
+    \param      a_target  Mesh receiving the geometry.
+*/
+//===========================================================================
+void cSceneFile::createMesh(const cSceneMesh& a_mesh, cMesh* a_target) const
+{
+    const cSceneVertex* vertices = getVertices(a_mesh);
+    const cSceneTriangle* triangles = getTriangles(a_mesh);
+
+    // vertices keep the normals and texture coordinates of the file
+    unsigned int firstVertex = a_target->getNumVertices();
+    for (unsigned int i=0; i<a_mesh.m_numVertices; i++)
+    {
+        const cSceneVertex& v = vertices[i];
+        unsigned int index = a_target->newVertex(v.m_pos[0], v.m_pos[1], v.m_pos[2]);
+        cVertex* vertex = a_target->getVertex(index);
+        vertex->setNormal(cVector3d(v.m_normal[0], v.m_normal[1], v.m_normal[2]));
+        vertex->setTexCoord(v.m_texCoord[0], v.m_texCoord[1]);
+    }
+
+    for (unsigned int i=0; i<a_mesh.m_numTriangles; i++)
+    {
+        const cSceneTriangle& t = triangles[i];
+        a_target->newTriangle(firstVertex + t.m_vertex[0],
+                              firstVertex + t.m_vertex[1],
+                              firstVertex + t.m_vertex[2]);
+    }
+
+    // material
+    getMaterial(a_mesh, a_target->m_material);
+
+    // transform
+    cVector3d pos;
+    cMatrix3d rot;
+    getFrame(a_mesh, pos, rot);
+    a_target->setPos(pos);
+    a_target->setRot(rot);
+
+    a_target->computeBoundaryBox(true);
+}
+
+
+//===========================================================================
+/*!
+    Convert the material of a mesh.
+
+    \param      a_mesh      Mesh of the scene.
+    \param      a_material  Material receiving its colors and shininess.
+*/
+//===========================================================================
+void cSceneFile::getMaterial(const cSceneMesh& a_mesh, cMaterial& a_material)
+{
+    const cSceneMaterial& material = a_mesh.m_material;
+    a_material.m_ambient.set(material.m_ambient[0], material.m_ambient[1],
+                             material.m_ambient[2], material.m_ambient[3]);
+    a_material.m_diffuse.set(material.m_diffuse[0], material.m_diffuse[1],
+                             material.m_diffuse[2], material.m_diffuse[3]);
+    a_material.m_specular.set(material.m_specular[0], material.m_specular[1],
+                              material.m_specular[2], material.m_specular[3]);
+    a_material.m_emission.set(material.m_emission[0], material.m_emission[1],
+                              material.m_emission[2], material.m_emission[3]);
+    a_material.setShininess((GLuint)material.m_shininess);
+}
+
+
+//===========================================================================
+/*!
+    Convert the transform of a mesh.
+
+    \param      a_mesh  Mesh of the scene.
+    \param      a_pos   Position of the mesh in the world.
+    \param      a_rot   Rotation of the mesh.
+*/
+//===========================================================================
+void cSceneFile::getFrame(const cSceneMesh& a_mesh, cVector3d& a_pos, cMatrix3d& a_rot)
+{
+    for (int i=0; i<3; i++)
+    {
+        for (int j=0; j<3; j++)
+        {
+            a_rot.m[i][j] = a_mesh.m_rot[3*i + j];
+        }
+    }
+    a_pos.set(a_mesh.m_pos[0], a_mesh.m_pos[1], a_mesh.m_pos[2]);
+}
+
+
+//===========================================================================
+/*!
+    Tell whether two meshes look the same up to their pose: they use the
+    same ranges of the vertex and triangle tables, and the same material.
+
+    \param      a_mesh0  First mesh.
+    \param      a_mesh1  Second mesh.
+    \return     Return true if only their poses and flags may differ.
+*/
+//===========================================================================
+bool cSceneFile::isSameMesh(const cSceneMesh& a_mesh0, const cSceneMesh& a_mesh1)
+{
+    return ((a_mesh0.m_firstVertex == a_mesh1.m_firstVertex) &&
+            (a_mesh0.m_numVertices == a_mesh1.m_numVertices) &&
+            (a_mesh0.m_firstTriangle == a_mesh1.m_firstTriangle) &&
+            (a_mesh0.m_numTriangles == a_mesh1.m_numTriangles) &&
+            (memcmp(&a_mesh0.m_material, &a_mesh1.m_material, sizeof(cSceneMaterial)) == 0));
+}
@@ -0,0 +1,122 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CSceneFile.h
+
+    \brief
+    Scene file mapped into memory and turned into CHAI3D objects.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CSceneFileH
+#define CSceneFileH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CMappedFile.h"
+#include "CSceneFormat.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cSceneFile
+    \brief      Read-only view of a scene file.
+
+    load() maps the file and checks every table and index against its
+    size once, so the accessors return pointers straight into the mapping
+    without further checks or copies. The mapping stays valid until the
+    object is destroyed or another file is loaded.
+
+    createMesh() fills a cMesh from the tables; the vertices are copied
+    once, into the mesh itself.
+*/
+//===========================================================================
+class cSceneFile
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cSceneFile.
+    cSceneFile();
+
+    //! Destructor of cSceneFile.
+    ~cSceneFile() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Map and check a scene file.
+    bool load(const char* a_filename);
+
+    //! Number of meshes.
+    int getNumMeshes() const { return ((m_header != NULL) ? (int)m_header->m_numMeshes : 0); }
+
+    //! Mesh by index.
+    const cSceneMesh& getMesh(int a_index) const { return (m_meshes[a_index]); }
+
+    //! First vertex of a mesh.
+    const cSceneVertex* getVertices(const cSceneMesh& a_mesh) const { return (m_vertices + a_mesh.m_firstVertex); }
+
+    //! First triangle of a mesh.
+    const cSceneTriangle* getTriangles(const cSceneMesh& a_mesh) const { return (m_triangles + a_mesh.m_firstTriangle); }
+
+    //! Number of rails.
+    int getNumRails() const { return ((m_header != NULL) ? (int)m_header->m_numRails : 0); }
+
+    //! Rail by index.
+    const cSceneRail& getRail(int a_index) const { return (m_rails[a_index]); }
+
+    //! Number of force field primitives.
+    int getNumForceFields() const { return ((m_header != NULL) ? (int)m_header->m_numFields : 0); }
+
+    //! Force field primitive by index.
+    const cSceneForceField& getForceField(int a_index) const { return (m_fields[a_index]); }
+
+    //! Add the geometry, material and transform of a mesh to a_target.
+    void createMesh(const cSceneMesh& a_mesh, cMesh* a_target) const;
+
+    //! Material of a mesh.
+    static void getMaterial(const cSceneMesh& a_mesh, cMaterial& a_material);
+
+    //! Position and rotation of a mesh in the world.
+    static void getFrame(const cSceneMesh& a_mesh, cVector3d& a_pos, cMatrix3d& a_rot);
+
+    //! True if two meshes share their vertices, triangles and material.
+    static bool isSameMesh(const cSceneMesh& a_mesh0, const cSceneMesh& a_mesh1);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! True if a table of a_count entries of a_size bytes at a_offset fits in the file.
+    bool checkTable(unsigned long long a_offset, unsigned int a_count, unsigned int a_size) const;
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Mapped file.
+    cMappedFile m_file;
+
+    //! Header and tables inside the mapping.
+    const cSceneFileHeader* m_header;
+    const cSceneMesh* m_meshes;
+    const cSceneVertex* m_vertices;
+    const cSceneTriangle* m_triangles;
+    const cSceneRail* m_rails;
+    const cSceneForceField* m_fields;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CSceneFormat.h
+
+    \brief
+    Binary layout of a scene file: a header followed by tables of meshes,
+    vertices, triangles, rails and force fields, read in place through a
+    memory mapping.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CSceneFormatH
+#define CSceneFormatH
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// first bytes of a scene file ("HSCN" in a little-endian file)
+const unsigned int SCENE_FILE_MAGIC         = 0x4E435348;
+
+// version of the layout below
+const unsigned int SCENE_FILE_VERSION       = 2;
+
+// mesh flags: the tools touch the mesh
+const unsigned int SCENE_MESH_HAPTIC        = 0x01;
+
+// mesh flags: the mesh slides on the rails (the first such mesh is the cube)
+const unsigned int SCENE_MESH_ON_RAILS      = 0x02;
+
+// mesh flags: the mesh is textured with the image rendered by the camera,
+// its texture coordinates being remapped to the aspect of the window
+const unsigned int SCENE_MESH_CAMERA_TEXTURE = 0x04;
+
+// mesh flags: the vertex normals of the mesh are displayed
+const unsigned int SCENE_MESH_SHOW_NORMALS  = 0x08;
+
+// mesh flags: the tools collide with the mesh through a flattened 4-wide
+// hierarchy (cCollisionBVH4) instead of the AABB tree; meant for dense meshes
+const unsigned int SCENE_MESH_BVH4          = 0x10;
+
+// mesh flags: the mesh is a block, a cube aligned with the axes moved on
+// the rails by cBlockPhysics, which pushes the tools and is pushed by them
+// and by the cube
+const unsigned int SCENE_MESH_BLOCK         = 0x20;
+
+// force field kinds: plane (m_pointA normal, m_scalar offset)
+const unsigned int SCENE_FIELD_PLANE        = 0;
+
+// force field kinds: box keeping the tools inside (m_pointA min, m_pointB max)
+const unsigned int SCENE_FIELD_BOX          = 1;
+
+// force field kinds: sphere pushing the tools out (m_pointA center, m_scalar radius)
+const unsigned int SCENE_FIELD_SPHERE       = 2;
+
+// force field kinds: rail pulling the tools onto a segment (m_pointA,
+// m_pointB ends, m_scalar range or 0)
+const unsigned int SCENE_FIELD_RAIL         = 3;
+
+// force field kinds: attractor (m_pointA center, m_scalar range or 0)
+const unsigned int SCENE_FIELD_ATTRACTOR    = 4;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// start of a scene file; all fields are written in native byte order and
+// all offsets are in bytes from the start of the file
+struct cSceneFileHeader
+{
+    // SCENE_FILE_MAGIC and SCENE_FILE_VERSION
+    unsigned int m_magic;
+    unsigned int m_version;
+
+    // size of each table entry in bytes, checked when loading
+    unsigned int m_headerSize;
+    unsigned int m_meshSize;
+    unsigned int m_vertexSize;
+    unsigned int m_triangleSize;
+    unsigned int m_railSize;
+    unsigned int m_fieldSize;
+
+    // number of entries of each table
+    unsigned int m_numMeshes;
+    unsigned int m_numVertices;
+    unsigned int m_numTriangles;
+    unsigned int m_numRails;
+    unsigned int m_numFields;
+    unsigned int m_reserved;
+
+    // position of each table
+    unsigned long long m_meshOffset;
+    unsigned long long m_vertexOffset;
+    unsigned long long m_triangleOffset;
+    unsigned long long m_railOffset;
+    unsigned long long m_fieldOffset;
+};
+
+// surface and haptic properties of a mesh
+struct cSceneMaterial
+{
+    // colors (RGBA)
+    float m_ambient[4];
+    float m_diffuse[4];
+    float m_specular[4];
+    float m_emission[4];
+
+    // shininess of the specular highlight
+    float m_shininess;
+
+    // stiffness as a fraction of the largest stiffness the device renders
+    float m_stiffness;
+
+    // static and dynamic friction coefficients
+    float m_staticFriction;
+    float m_dynamicFriction;
+};
+
+// a mesh, with its vertices and triangles stored as ranges of the tables
+struct cSceneMesh
+{
+    // position and rotation (row-major) of the mesh in the world
+    double m_pos[3];
+    double m_rot[9];
+
+    // surface and haptic properties
+    cSceneMaterial m_material;
+
+    // combination of SCENE_MESH_* flags
+    unsigned int m_flags;
+
+    // range of the vertex table used by the mesh
+    unsigned int m_firstVertex;
+    unsigned int m_numVertices;
+
+    // range of the triangle table used by the mesh
+    unsigned int m_firstTriangle;
+    unsigned int m_numTriangles;
+
+    unsigned int m_reserved;
+};
+
+// a vertex in the local frame of its mesh
+struct cSceneVertex
+{
+    float m_pos[3];
+    float m_normal[3];
+    float m_texCoord[2];
+};
+
+// a triangle; vertex indices are relative to the first vertex of its mesh
+struct cSceneTriangle
+{
+    unsigned int m_vertex[3];
+};
+
+// a straight rail in world coordinates
+struct cSceneRail
+{
+    double m_pointA[3];
+    double m_pointB[3];
+};
+
+// a force field primitive acting on the tools, in world coordinates
+struct cSceneForceField
+{
+    // one of SCENE_FIELD_*
+    unsigned int m_type;
+    unsigned int m_reserved;
+
+    // points and scalar parameter, depending on the kind
+    double m_pointA[3];
+    double m_pointB[3];
+    double m_scalar;
+
+    // stiffness of the field [N/m]
+    double m_stiffness;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
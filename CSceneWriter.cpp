@@ -0,0 +1,235 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CSceneWriter.cpp
+
+    \brief
+    Builder writing scenes in the binary scene file format.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CSceneWriter.h"
+#include <stdio.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// round a file offset up to the alignment of the tables
+static unsigned long long alignOffset(unsigned long long a_offset)
+{
+    return ((a_offset + 7) & ~7ULL);
+}
+
+// write a table and pad it to the next aligned offset
+static bool writeTable(FILE* a_file, const void* a_data, size_t a_size)
+{
+    static const char padding[8] = { 0 };
+
+    if ((a_size > 0) && (fwrite(a_data, 1, a_size, a_file) != a_size)) { return (false); }
+    size_t pad = (size_t)(alignOffset(a_size) - a_size);
+    return ((pad == 0) || (fwrite(padding, 1, pad, a_file) == pad));
+}
+
+
+//===========================================================================
+/*!
+    Start a new mesh. Its vertex and triangle ranges begin at the current
+    end of the tables.
+
+    \param      a_flags     Combination of SCENE_MESH_* flags.
+    \param      a_pos       Position of the mesh in the world.
+    \param      a_rot       Rotation of the mesh (row-major).
+    \param      a_material  Surface and haptic properties.
+    \return     Return the index of the mesh.
+*/
+//===========================================================================
+int cSceneWriter::addMesh(unsigned int a_flags, const double a_pos[3], const double a_rot[9],
+                          const cSceneMaterial& a_material)
+{
+    cSceneMesh mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    memcpy(mesh.m_pos, a_pos, sizeof(mesh.m_pos));
+    memcpy(mesh.m_rot, a_rot, sizeof(mesh.m_rot));
+    mesh.m_material = a_material;
+    mesh.m_flags = a_flags;
+    mesh.m_firstVertex = (unsigned int)m_vertices.size();
+    mesh.m_firstTriangle = (unsigned int)m_triangles.size();
+
+    m_meshes.push_back(mesh);
+    return ((int)m_meshes.size() - 1);
+}
+
+
+//===========================================================================
+/*!
+    Add a copy of an earlier mesh: it uses the same ranges of the vertex
+    and triangle tables, and the same material, so that the reader can
+    tell the copies apart from other meshes and draw them together.
+
+    \param      a_mesh   Index of the mesh to copy.
+    \param      a_flags  Combination of SCENE_MESH_* flags.
+    \param      a_pos    Position of the copy in the world.
+    \param      a_rot    Rotation of the copy (row-major).
+    \return     Return the index of the copy.
+*/
+//===========================================================================
+int cSceneWriter::addInstance(int a_mesh, unsigned int a_flags, const double a_pos[3], const double a_rot[9])
+{
+    cSceneMesh mesh = m_meshes[a_mesh];
+    memcpy(mesh.m_pos, a_pos, sizeof(mesh.m_pos));
+    memcpy(mesh.m_rot, a_rot, sizeof(mesh.m_rot));
+    mesh.m_flags = a_flags;
+
+    m_meshes.push_back(mesh);
+    return ((int)m_meshes.size() - 1);
+}
+
+
+//===========================================================================
+/*!
+    Add a vertex to the last mesh.
+
+    \param      a_x, a_y, a_z     Position in the frame of the mesh.
+    \param      a_nx, a_ny, a_nz  Normal.
+    \param      a_u, a_v          Texture coordinates.
+    \return     Return the index of the vertex within its mesh.
+*/
+//===========================================================================
+unsigned int cSceneWriter::addVertex(double a_x, double a_y, double a_z,
+                                     double a_nx, double a_ny, double a_nz,
+                                     double a_u, double a_v)
+{
+    cSceneVertex vertex;
+    vertex.m_pos[0] = (float)a_x;
+    vertex.m_pos[1] = (float)a_y;
+    vertex.m_pos[2] = (float)a_z;
+    vertex.m_normal[0] = (float)a_nx;
+    vertex.m_normal[1] = (float)a_ny;
+    vertex.m_normal[2] = (float)a_nz;
+    vertex.m_texCoord[0] = (float)a_u;
+    vertex.m_texCoord[1] = (float)a_v;
+    m_vertices.push_back(vertex);
+
+    cSceneMesh& mesh = m_meshes.back();
+    return (mesh.m_numVertices++);
+}
+
+
+//===========================================================================
+/*!
+    Add a triangle to the last mesh.
+
+    \param      a_vertex0, a_vertex1, a_vertex2  Vertex indices within the mesh.
+*/
+//===========================================================================
+void cSceneWriter::addTriangle(unsigned int a_vertex0, unsigned int a_vertex1, unsigned int a_vertex2)
+{
+    cSceneTriangle triangle;
+    triangle.m_vertex[0] = a_vertex0;
+    triangle.m_vertex[1] = a_vertex1;
+    triangle.m_vertex[2] = a_vertex2;
+    m_triangles.push_back(triangle);
+
+    m_meshes.back().m_numTriangles++;
+}
+
+
+//===========================================================================
+/*!
+    Add a rail.
+
+    \param      a_pointA  First end of the rail.
+    \param      a_pointB  Second end of the rail.
+*/
+//===========================================================================
+void cSceneWriter::addRail(const double a_pointA[3], const double a_pointB[3])
+{
+    cSceneRail rail;
+    memcpy(rail.m_pointA, a_pointA, sizeof(rail.m_pointA));
+    memcpy(rail.m_pointB, a_pointB, sizeof(rail.m_pointB));
+    m_rails.push_back(rail);
+}
+
+
+//===========================================================================
+/*!
+    Add a force field primitive; see SCENE_FIELD_* for the meaning of the
+    parameters of each kind.
+
+    \param      a_type       Kind of primitive.
+    \param      a_pointA     First point parameter.
+    \param      a_pointB     Second point parameter.
+    \param      a_scalar     Scalar parameter.
+    \param      a_stiffness  Stiffness [N/m].
+*/
+//===========================================================================
+void cSceneWriter::addForceField(unsigned int a_type, const double a_pointA[3], const double a_pointB[3],
+                                 double a_scalar, double a_stiffness)
+{
+    cSceneForceField field;
+    memset(&field, 0, sizeof(field));
+    field.m_type = a_type;
+    memcpy(field.m_pointA, a_pointA, sizeof(field.m_pointA));
+    memcpy(field.m_pointB, a_pointB, sizeof(field.m_pointB));
+    field.m_scalar = a_scalar;
+    field.m_stiffness = a_stiffness;
+    m_fields.push_back(field);
+}
+
+
+//===========================================================================
+/*!
+    Write the header followed by the mesh, vertex, triangle, rail and
+    force field tables, each starting on an 8-byte boundary.
+
+    \param      a_filename  Path of the scene file.
+    \return     Return true if the file was written.
+*/
+//===========================================================================
+bool cSceneWriter::write(const char* a_filename) const
+{
+    size_t meshBytes = m_meshes.size() * sizeof(cSceneMesh);
+    size_t vertexBytes = m_vertices.size() * sizeof(cSceneVertex);
+    size_t triangleBytes = m_triangles.size() * sizeof(cSceneTriangle);
+    size_t railBytes = m_rails.size() * sizeof(cSceneRail);
+    size_t fieldBytes = m_fields.size() * sizeof(cSceneForceField);
+
+    cSceneFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_magic = SCENE_FILE_MAGIC;
+    header.m_version = SCENE_FILE_VERSION;
+    header.m_headerSize = sizeof(cSceneFileHeader);
+    header.m_meshSize = sizeof(cSceneMesh);
+    header.m_vertexSize = sizeof(cSceneVertex);
+    header.m_triangleSize = sizeof(cSceneTriangle);
+    header.m_railSize = sizeof(cSceneRail);
+    header.m_fieldSize = sizeof(cSceneForceField);
+    header.m_numMeshes = (unsigned int)m_meshes.size();
+    header.m_numVertices = (unsigned int)m_vertices.size();
+    header.m_numTriangles = (unsigned int)m_triangles.size();
+    header.m_numRails = (unsigned int)m_rails.size();
+    header.m_numFields = (unsigned int)m_fields.size();
+    header.m_meshOffset = alignOffset(sizeof(cSceneFileHeader));
+    header.m_vertexOffset = header.m_meshOffset + alignOffset(meshBytes);
+    header.m_triangleOffset = header.m_vertexOffset + alignOffset(vertexBytes);
+    header.m_railOffset = header.m_triangleOffset + alignOffset(triangleBytes);
+    header.m_fieldOffset = header.m_railOffset + alignOffset(railBytes);
+
+    FILE* file = fopen(a_filename, "wb");
+    if (file == NULL) { return (false); }
+
+    bool ok = writeTable(file, &header, sizeof(header)) &&
+              writeTable(file, meshBytes ? &m_meshes[0] : NULL, meshBytes) &&
+              writeTable(file, vertexBytes ? &m_vertices[0] : NULL, vertexBytes) &&
+              writeTable(file, triangleBytes ? &m_triangles[0] : NULL, triangleBytes) &&
+              writeTable(file, railBytes ? &m_rails[0] : NULL, railBytes) &&
+              writeTable(file, fieldBytes ? &m_fields[0] : NULL, fieldBytes);
+
+    if (fclose(file) != 0) { ok = false; }
+    return (ok);
+}
@@ -0,0 +1,93 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CSceneWriter.h
+
+    \brief
+    Builder writing scenes in the binary scene file format.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CSceneWriterH
+#define CSceneWriterH
+//---------------------------------------------------------------------------
+#include "CSceneFormat.h"
+#include <vector>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cSceneWriter
+    \brief      Collects meshes, rails and force fields and writes them as
+                a scene file.
+
+    Vertices and triangles added after addMesh() belong to that mesh;
+    triangle indices are relative to its first vertex. addInstance() adds
+    a mesh sharing the vertices, triangles and material of an earlier one;
+    nothing may be added to it.
+*/
+//===========================================================================
+class cSceneWriter
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cSceneWriter.
+    cSceneWriter() {};
+
+    //! Destructor of cSceneWriter.
+    ~cSceneWriter() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Start a new mesh; returns its index.
+    int addMesh(unsigned int a_flags, const double a_pos[3], const double a_rot[9],
+                const cSceneMaterial& a_material);
+
+    //! Add a copy of mesh a_mesh at another pose; returns its index.
+    int addInstance(int a_mesh, unsigned int a_flags, const double a_pos[3], const double a_rot[9]);
+
+    //! Add a vertex to the last mesh; returns its index within the mesh.
+    unsigned int addVertex(double a_x, double a_y, double a_z,
+                           double a_nx, double a_ny, double a_nz,
+                           double a_u, double a_v);
+
+    //! Add a triangle to the last mesh.
+    void addTriangle(unsigned int a_vertex0, unsigned int a_vertex1, unsigned int a_vertex2);
+
+    //! Add a rail from a_pointA to a_pointB.
+    void addRail(const double a_pointA[3], const double a_pointB[3]);
+
+    //! Add a force field primitive of kind a_type (SCENE_FIELD_*).
+    void addForceField(unsigned int a_type, const double a_pointA[3], const double a_pointB[3],
+                       double a_scalar, double a_stiffness);
+
+    //! Write the scene to a file.
+    bool write(const char* a_filename) const;
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Tables of the scene.
+    std::vector<cSceneMesh> m_meshes;
+    std::vector<cSceneVertex> m_vertices;
+    std::vector<cSceneTriangle> m_triangles;
+    std::vector<cSceneRail> m_rails;
+    std::vector<cSceneForceField> m_fields;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,236 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CScriptedHapticDevice.cpp
+
+    \brief
+    Simulated haptic device that follows a scripted trajectory, used to
+    drive the haptic loop without any hardware attached.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CScriptedHapticDevice.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// physical workspace radius of the simulated device [m]
+const double SCRIPT_WORKSPACE_RADIUS = 0.1;
+
+// amplitude [m] and frequency [Hz] of the horizontal (y) sweep
+const double SCRIPT_AMPLITUDE_Y      = 0.06;
+const double SCRIPT_FREQUENCY_Y      = 0.25;
+
+// center, amplitude [m] and frequency [Hz] of the vertical (z) sweep
+const double SCRIPT_CENTER_Z         = -0.05;
+const double SCRIPT_AMPLITUDE_Z      = 0.02;
+const double SCRIPT_FREQUENCY_Z      = 0.5;
+
+// period [s] and duration [s] of user switch presses
+const double SCRIPT_SWITCH_PERIOD    = 4.0;
+const double SCRIPT_SWITCH_DURATION  = 0.5;
+
+// common period of the two sweeps and of the switch presses [s]
+const double SCRIPT_PERIOD           = 4.0;
+
+
+//===========================================================================
+/*!
+    Constructor of cScriptedHapticDevice.
+*/
+//===========================================================================
+cScriptedHapticDevice::cScriptedHapticDevice()
+{
+    m_specifications.m_manufacturerName   = "none";
+    m_specifications.m_modelName          = "scripted";
+    m_specifications.m_maxForce           = 8.0;     // [N]
+    m_specifications.m_maxForceStiffness  = 2000.0;  // [N/m]
+    m_specifications.m_maxTorque          = 0.0;     // [N*m]
+    m_specifications.m_maxTorqueStiffness = 0.0;     // [N*m/Rad]
+    m_specifications.m_maxLinearDamping   = 20.0;    // [N/(m/s)]
+    m_specifications.m_workspaceRadius    = SCRIPT_WORKSPACE_RADIUS;
+    m_specifications.m_sensedPosition     = true;
+    m_specifications.m_sensedRotation     = false;
+    m_specifications.m_actuatedPosition   = true;
+    m_specifications.m_actuatedRotation   = false;
+    m_specifications.m_rightHand          = true;
+    m_specifications.m_leftHand           = true;
+    m_specifications.m_positionOffset     = 0.0;
+
+    m_systemAvailable = true;
+    m_systemReady = false;
+    m_time = 0.0;
+    m_force.zero();
+    m_numForceCommands = 0;
+    m_transportDelay = 0.0;
+    m_clock.start(true);
+}
+
+
+//===========================================================================
+/*!
+    Open connection to the simulated device.
+
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::open()
+{
+    m_systemReady = true;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Close connection to the simulated device.
+
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::close()
+{
+    m_systemReady = false;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Reset the script time, the stored force and the command counter.
+
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::initialize(const bool a_resetEncoders)
+{
+    m_time = 0.0;
+    m_force.zero();
+    m_numForceCommands = 0;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the position of the end-effector at the current script time.
+
+    \param      a_position  Returned position [m].
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::getPosition(cVector3d& a_position)
+{
+    waitTransport();
+
+    const double wy = 2.0 * CHAI_PI * SCRIPT_FREQUENCY_Y;
+    const double wz = 2.0 * CHAI_PI * SCRIPT_FREQUENCY_Z;
+    a_position.set(0.0,
+                   SCRIPT_AMPLITUDE_Y * sin(wy * m_time),
+                   SCRIPT_CENTER_Z + SCRIPT_AMPLITUDE_Z * sin(wz * m_time));
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the velocity of the end-effector at the current script time.
+
+    \param      a_linearVelocity  Returned velocity [m/s].
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::getLinearVelocity(cVector3d& a_linearVelocity)
+{
+    const double wy = 2.0 * CHAI_PI * SCRIPT_FREQUENCY_Y;
+    const double wz = 2.0 * CHAI_PI * SCRIPT_FREQUENCY_Z;
+    a_linearVelocity.set(0.0,
+                         SCRIPT_AMPLITUDE_Y * wy * cos(wy * m_time),
+                         SCRIPT_AMPLITUDE_Z * wz * cos(wz * m_time));
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the orientation of the end-effector. The simulated device has no
+    rotational degrees of freedom.
+
+    \param      a_rotation  Returned orientation (identity).
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    a_rotation.identity();
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Store the commanded force.
+
+    \param      a_force  Force command [N].
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::setForce(cVector3d& a_force)
+{
+    waitTransport();
+
+    m_force = a_force;
+    m_numForceCommands++;
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Read the status of the user switch, which is pressed for a short while
+    at the start of every script period.
+
+    \param      a_switchIndex  Index of the switch (only 0 is simulated).
+    \param      a_status       Returned status.
+    \return     Always 0.
+*/
+//===========================================================================
+int cScriptedHapticDevice::getUserSwitch(int a_switchIndex, bool& a_status)
+{
+    a_status = (a_switchIndex == 0) &&
+               (fmod(m_time, SCRIPT_SWITCH_PERIOD) < SCRIPT_SWITCH_DURATION);
+    return (0);
+}
+
+
+//===========================================================================
+/*!
+    Time after which the script repeats itself: a run of that many
+    seconds has shown every position and switch state of the script.
+
+    \return     Period of the script [s].
+*/
+//===========================================================================
+double cScriptedHapticDevice::getPeriod()
+{
+    return (SCRIPT_PERIOD);
+}
+
+
+//===========================================================================
+/*!
+    Busy-wait for the transport delay, as a blocking transfer over a bus
+    would.
+*/
+//===========================================================================
+void cScriptedHapticDevice::waitTransport()
+{
+    if (m_transportDelay <= 0.0) { return; }
+
+    double end = m_clock.getCurrentTimeSeconds() + m_transportDelay;
+    while (m_clock.getCurrentTimeSeconds() < end) {}
+}
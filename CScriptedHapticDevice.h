@@ -0,0 +1,125 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CScriptedHapticDevice.h
+
+    \brief
+    Simulated haptic device that follows a scripted trajectory, used to
+    drive the haptic loop without any hardware attached.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CScriptedHapticDeviceH
+#define CScriptedHapticDeviceH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cScriptedHapticDevice
+    \brief      Haptic device whose end-effector sweeps a deterministic
+                Lissajous path through the rails and the cube.
+
+    The trajectory is a function of simulated time only, which is advanced
+    explicitly with step(), so that two runs with the same tick count see
+    exactly the same sequence of positions. Commanded forces are stored and
+    can be read back but have no effect on the motion. A transport delay
+    can be set to make the reads and writes as slow as those of a device
+    on a bus.
+*/
+//===========================================================================
+class cScriptedHapticDevice : public cGenericHapticDevice
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cScriptedHapticDevice.
+    cScriptedHapticDevice();
+
+    //! Destructor of cScriptedHapticDevice.
+    virtual ~cScriptedHapticDevice() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Open connection to the simulated device.
+    virtual int open();
+
+    //! Close connection to the simulated device.
+    virtual int close();
+
+    //! Reset the script to its start.
+    virtual int initialize(const bool a_resetEncoders=false);
+
+    //! Read the position of the device at the current script time.
+    virtual int getPosition(cVector3d& a_position);
+
+    //! Read the velocity of the device at the current script time.
+    virtual int getLinearVelocity(cVector3d& a_linearVelocity);
+
+    //! Read the orientation of the device (always identity).
+    virtual int getRotation(cMatrix3d& a_rotation);
+
+    //! Store the commanded force.
+    virtual int setForce(cVector3d& a_force);
+
+    //! Read the status of the user switch (pressed every few seconds).
+    virtual int getUserSwitch(int a_switchIndex, bool& a_status);
+
+    //! Advance the script by a_timeInterval seconds.
+    void step(double a_timeInterval) { m_time += a_timeInterval; }
+
+    //! Make each position read and force write last a_seconds, like a transfer over USB.
+    void setTransportDelay(double a_seconds) { m_transportDelay = a_seconds; }
+
+    //! Last force commanded to the device.
+    cVector3d getLastForce() const { return (m_force); }
+
+    //! Number of force commands received since initialize().
+    unsigned long getNumForceCommands() const { return (m_numForceCommands); }
+
+    //! Time after which the positions and the switch presses repeat [s].
+    static double getPeriod();
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Busy-wait for the transport delay.
+    void waitTransport();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Current script time in seconds.
+    double m_time;
+
+    //! Last commanded force.
+    cVector3d m_force;
+
+    //! Number of force commands received.
+    unsigned long m_numForceCommands;
+
+    //! Duration of a simulated transfer [s].
+    double m_transportDelay;
+
+    //! Clock measuring the simulated transfers.
+    cPrecisionClock m_clock;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,184 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CStageTimer.cpp
+
+    \brief
+    Low-overhead timers for the stages of the haptic tick, recorded into a
+    lock-free ring and read back for an overlay and a CSV dump.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CStageTimer.h"
+//---------------------------------------------------------------------------
+#include <stdio.h>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// names of the stages, in the order of cHapticStage
+static const char* STAGE_NAMES[NUM_HAPTIC_STAGES] =
+{
+    "globalPositions",
+    "updatePose",
+    "interactionForces",
+    "blockContacts",
+    "applyForces",
+    "objectMotion",
+    "publishPoses"
+};
+
+
+//===========================================================================
+/*!
+    Constructor of cStageTimer. The ring is allocated here, once.
+
+    \param      a_capacity  Minimum number of ticks kept; rounded up to a
+                            power of two.
+*/
+//===========================================================================
+cStageTimer::cStageTimer(unsigned int a_capacity)
+{
+    unsigned long size = 1;
+    while (size < a_capacity) { size <<= 1; }
+
+    cStageSample empty;
+    empty.m_tick = 0;
+    for (int i=0; i<NUM_HAPTIC_STAGES; i++)
+    {
+        empty.m_duration[i] = 0.0;
+    }
+
+    m_samples.assign(size, empty);
+    m_mask = size - 1;
+    m_numTicks.store(0);
+    m_current = &m_samples[0];
+    m_stageStart = std::chrono::steady_clock::now();
+}
+
+
+//===========================================================================
+/*!
+    Compute the mean and maximum duration of each stage over the most recent
+    ticks. Samples overwritten by the writer while they were being read are
+    left out, so a_summary may cover fewer ticks than requested.
+
+    \param      a_numTicks  Number of recent ticks to summarize.
+    \param      a_summary   Receives the statistics.
+*/
+//===========================================================================
+void cStageTimer::computeSummary(int a_numTicks, cStageSummary& a_summary) const
+{
+    a_summary.m_numTicks = 0;
+    a_summary.m_meanTotal = 0.0;
+    a_summary.m_maxTotal = 0.0;
+    for (int s=0; s<NUM_HAPTIC_STAGES; s++)
+    {
+        a_summary.m_mean[s] = 0.0;
+        a_summary.m_max[s] = 0.0;
+    }
+
+    // range of ticks to read, newest first
+    unsigned long end = m_numTicks.load(std::memory_order_acquire);
+    unsigned long count = (unsigned long)a_numTicks;
+    if (count > m_samples.size()) { count = (unsigned long)m_samples.size(); }
+    if (count > end) { count = end; }
+
+    for (unsigned long i=0; i<count; i++)
+    {
+        const cStageSample& sample = m_samples[(end - 1 - i) & m_mask];
+        double total = 0.0;
+        for (int s=0; s<NUM_HAPTIC_STAGES; s++)
+        {
+            double duration = sample.m_duration[s];
+            a_summary.m_mean[s] += duration;
+            if (duration > a_summary.m_max[s]) { a_summary.m_max[s] = duration; }
+            total += duration;
+        }
+        a_summary.m_meanTotal += total;
+        if (total > a_summary.m_maxTotal) { a_summary.m_maxTotal = total; }
+        a_summary.m_numTicks++;
+
+        // stop at the first sample the writer may have reused since; the
+        // slot of tick t is reused by tick t + size, which is being written
+        // once m_numTicks has reached t + size
+        std::atomic_thread_fence(std::memory_order_acquire);
+        unsigned long now = m_numTicks.load(std::memory_order_relaxed);
+        if (now - (end - 1 - i) >= m_samples.size())
+        {
+            a_summary.m_numTicks--;
+            break;
+        }
+    }
+
+    if (a_summary.m_numTicks > 0)
+    {
+        double scale = 1.0 / (double)a_summary.m_numTicks;
+        for (int s=0; s<NUM_HAPTIC_STAGES; s++)
+        {
+            a_summary.m_mean[s] *= scale;
+        }
+        a_summary.m_meanTotal *= scale;
+    }
+}
+
+
+//===========================================================================
+/*!
+    Write the ticks still held in the ring to a CSV file: one line per
+    tick, with the duration of each stage and of the whole tick in
+    microseconds. Meant to be called once the writer has stopped.
+
+    \param      a_filename  Path of the file to write.
+    \return     Return true if the file was written.
+*/
+//===========================================================================
+bool cStageTimer::writeCSV(const char* a_filename) const
+{
+    FILE* file = fopen(a_filename, "w");
+    if (file == NULL) { return (false); }
+
+    fprintf(file, "tick");
+    for (int s=0; s<NUM_HAPTIC_STAGES; s++)
+    {
+        fprintf(file, ",%s_us", STAGE_NAMES[s]);
+    }
+    fprintf(file, ",total_us\n");
+
+    unsigned long end = m_numTicks.load(std::memory_order_acquire);
+    unsigned long begin = (end > m_samples.size()) ? end - m_samples.size() : 0;
+    for (unsigned long t=begin; t<end; t++)
+    {
+        const cStageSample& sample = m_samples[t & m_mask];
+        double total = 0.0;
+        fprintf(file, "%lu", sample.m_tick);
+        for (int s=0; s<NUM_HAPTIC_STAGES; s++)
+        {
+            fprintf(file, ",%.3lf", 1.0e6 * sample.m_duration[s]);
+            total += sample.m_duration[s];
+        }
+        fprintf(file, ",%.3lf\n", 1.0e6 * total);
+    }
+
+    fclose(file);
+    return (true);
+}
+
+
+//===========================================================================
+/*!
+    Short name of a stage, used as column name and in reports.
+
+    \param      a_stage  Stage index.
+    \return     Return the name, or "unknown" for an invalid index.
+*/
+//===========================================================================
+const char* cStageTimer::getStageName(int a_stage)
+{
+    if ((a_stage < 0) || (a_stage >= NUM_HAPTIC_STAGES)) { return ("unknown"); }
+    return (STAGE_NAMES[a_stage]);
+}
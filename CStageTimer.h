@@ -0,0 +1,196 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CStageTimer.h
+
+    \brief
+    Low-overhead timers for the stages of the haptic tick, recorded into a
+    lock-free ring and read back for an overlay and a CSV dump.
+
+    The instrumentation of the haptic loop goes through the HAPTIC_STAGE_*
+    macros, which expand to nothing unless HAPTICS_STAGE_TIMING is defined
+    (CMake option of the same name).
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CStageTimerH
+#define CStageTimerH
+//---------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// stages of the haptic tick, in execution order
+enum cHapticStage
+{
+    // global frames of the objects that moved
+    STAGE_GLOBAL_POSITIONS,
+
+    // tool->updatePose()
+    STAGE_UPDATE_POSE,
+
+    // tool->computeInteractionForces()
+    STAGE_INTERACTION_FORCES,
+
+    // contact of the tool with the blocks near it
+    STAGE_BLOCK_CONTACTS,
+
+    // composition of the forces and the device write
+    STAGE_APPLY_FORCES,
+
+    // exchange of the contact force and the cube position with the physics
+    STAGE_OBJECT_MOTION,
+
+    // hand-off of the poses to the graphics thread
+    STAGE_PUBLISH_POSES,
+
+    NUM_HAPTIC_STAGES
+};
+
+// durations of the stages of one tick
+struct cStageSample
+{
+    // index of the tick since the timer was created
+    unsigned long m_tick;
+
+    // duration of each stage [s]
+    double m_duration[NUM_HAPTIC_STAGES];
+};
+
+// statistics over the most recent ticks
+struct cStageSummary
+{
+    // number of ticks summarized
+    int m_numTicks;
+
+    // mean and maximum duration of each stage [s]
+    double m_mean[NUM_HAPTIC_STAGES];
+    double m_max[NUM_HAPTIC_STAGES];
+
+    // mean and maximum duration of the whole tick [s]
+    double m_meanTotal;
+    double m_maxTotal;
+};
+
+
+//===========================================================================
+/*!
+    \class      cStageTimer
+    \brief      Times the stages of each haptic tick with a steady clock and
+                keeps the most recent ticks in a fixed-size ring.
+
+    The haptics thread brackets its tick with beginTick() and endTick() and
+    calls mark() after each stage. Nothing allocates or locks: a sample is
+    written in place and published by incrementing an atomic tick count,
+    overwriting the oldest sample once the ring is full.
+
+    Other threads read without blocking the writer. A reader copies the
+    samples it wants, then checks the tick count again and drops the ones
+    the writer may have overwritten in the meantime.
+*/
+//===========================================================================
+class cStageTimer
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cStageTimer; keeps at least a_capacity ticks.
+    cStageTimer(unsigned int a_capacity = 16384);
+
+    //! Destructor of cStageTimer.
+    ~cStageTimer() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - WRITER THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Start timing a tick.
+    inline void beginTick()
+    {
+        m_current = &m_samples[m_numTicks.load(std::memory_order_relaxed) & m_mask];
+        m_stageStart = std::chrono::steady_clock::now();
+    }
+
+    //! Close a stage: its duration is the time since the previous mark.
+    inline void mark(cHapticStage a_stage)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        m_current->m_duration[a_stage] = std::chrono::duration<double>(now - m_stageStart).count();
+        m_stageStart = now;
+    }
+
+    //! Publish the tick.
+    inline void endTick()
+    {
+        unsigned long tick = m_numTicks.load(std::memory_order_relaxed);
+        m_current->m_tick = tick;
+        m_numTicks.store(tick + 1, std::memory_order_release);
+    }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - ANY THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Number of ticks published so far.
+    unsigned long getNumTicks() const { return (m_numTicks.load(std::memory_order_acquire)); }
+
+    //! Mean and maximum stage durations over the last a_numTicks ticks.
+    void computeSummary(int a_numTicks, cStageSummary& a_summary) const;
+
+    //! Write the ticks still in the ring to a CSV file, durations in microseconds.
+    bool writeCSV(const char* a_filename) const;
+
+    //! Short name of a stage, used in reports.
+    static const char* getStageName(int a_stage);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Ring of samples; its size is a power of two.
+    std::vector<cStageSample> m_samples;
+
+    //! Size of the ring minus one.
+    unsigned long m_mask;
+
+    //! Number of ticks published; the next tick goes to m_numTicks & m_mask.
+    std::atomic<unsigned long> m_numTicks;
+
+    //! Writer thread: sample being filled and start of the current stage.
+    cStageSample* m_current;
+    std::chrono::steady_clock::time_point m_stageStart;
+};
+
+
+//---------------------------------------------------------------------------
+// INSTRUMENTATION MACROS
+//---------------------------------------------------------------------------
+
+#ifdef HAPTICS_STAGE_TIMING
+#define HAPTIC_STAGE_BEGIN(timer)           (timer).beginTick()
+#define HAPTIC_STAGE_MARK(timer, stage)     (timer).mark(stage)
+#define HAPTIC_STAGE_END(timer)             (timer).endTick()
+#else
+#define HAPTIC_STAGE_BEGIN(timer)           ((void)0)
+#define HAPTIC_STAGE_MARK(timer, stage)     ((void)0)
+#define HAPTIC_STAGE_END(timer)             ((void)0)
+#endif
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
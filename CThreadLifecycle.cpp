@@ -0,0 +1,114 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CThreadLifecycle.cpp
+
+    \brief
+    Start, stop and join of a group of simulation threads.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CThreadLifecycle.h"
+//---------------------------------------------------------------------------
+#include <chrono>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cThreadLifecycle.
+*/
+//===========================================================================
+cThreadLifecycle::cThreadLifecycle() :
+    m_state(LIFECYCLE_IDLE),
+    m_numThreads(0)
+{
+}
+
+
+//===========================================================================
+/*!
+    Let the threads run. Threads created before start() leave their loop
+    at once.
+*/
+//===========================================================================
+void cThreadLifecycle::start()
+{
+    m_state.store(LIFECYCLE_RUNNING, std::memory_order_release);
+}
+
+
+//===========================================================================
+/*!
+    Count a thread about to be created, so that join() waits for it even
+    if it has not reached its loop yet.
+*/
+//===========================================================================
+void cThreadLifecycle::threadStarting()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_numThreads++;
+}
+
+
+//===========================================================================
+/*!
+    Report that the calling thread left its loop. Must be the last access
+    of the thread to anything join() protects.
+*/
+//===========================================================================
+void cThreadLifecycle::threadFinished()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_numThreads--;
+    if (m_numThreads <= 0)
+    {
+        m_finished.notify_all();
+    }
+}
+
+
+//===========================================================================
+/*!
+    Ask the threads to leave their loops. Only the first call after
+    start() has an effect.
+
+    \return     Return true if the threads were running.
+*/
+//===========================================================================
+bool cThreadLifecycle::stop()
+{
+    int expected = LIFECYCLE_RUNNING;
+    return (m_state.compare_exchange_strong(expected, LIFECYCLE_STOPPING));
+}
+
+
+//===========================================================================
+/*!
+    Wait until every counted thread called threadFinished().
+
+    \param      a_timeout  Longest wait [s]; 0 to wait as long as needed.
+    \return     Return true if every thread finished.
+*/
+//===========================================================================
+bool cThreadLifecycle::join(double a_timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (a_timeout > 0.0)
+    {
+        std::chrono::microseconds timeout((long long)(1.0e6 * a_timeout));
+        if (!m_finished.wait_for(lock, timeout, [this] { return (m_numThreads <= 0); }))
+        {
+            return (false);
+        }
+    }
+    else
+    {
+        m_finished.wait(lock, [this] { return (m_numThreads <= 0); });
+    }
+
+    m_state.store(LIFECYCLE_JOINED, std::memory_order_release);
+    return (true);
+}
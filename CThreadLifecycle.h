@@ -0,0 +1,122 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CThreadLifecycle.h
+
+    \brief
+    Start, stop and join of a group of simulation threads.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CThreadLifecycleH
+#define CThreadLifecycleH
+//---------------------------------------------------------------------------
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// states of a group of threads, in order
+enum cThreadLifecycleState
+{
+    // no thread started yet
+    LIFECYCLE_IDLE,
+
+    // the threads run their loops
+    LIFECYCLE_RUNNING,
+
+    // the threads were asked to leave their loops
+    LIFECYCLE_STOPPING,
+
+    // every thread left its loop
+    LIFECYCLE_JOINED
+};
+
+
+//===========================================================================
+/*!
+    \class      cThreadLifecycle
+    \brief      Shared run flag and join of the threads of a simulation.
+
+    The controlling thread calls start(), then threadStarting() before it
+    creates each thread. Each thread loops while isRunning() and calls
+    threadFinished() as its last action. stop() ends the loops and join()
+    sleeps on a condition variable until the last thread finished, so it
+    returns as soon as they are done instead of polling.
+
+    isRunning() is a single atomic load, cheap enough for the condition of
+    a haptic loop.
+*/
+//===========================================================================
+class cThreadLifecycle
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cThreadLifecycle.
+    cThreadLifecycle();
+
+    //! Destructor of cThreadLifecycle.
+    ~cThreadLifecycle() {};
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - CONTROLLING THREAD:
+    //-----------------------------------------------------------------------
+
+    //! Let threads run.
+    void start();
+
+    //! Count a thread about to be created.
+    void threadStarting();
+
+    //! Ask the threads to leave their loops; returns false if they were not running.
+    bool stop();
+
+    //! Wait until every thread finished, at most a_timeout seconds (0: no limit).
+    bool join(double a_timeout = 0.0);
+
+    //! Current state.
+    cThreadLifecycleState getState() const { return ((cThreadLifecycleState)m_state.load()); }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - SIMULATION THREADS:
+    //-----------------------------------------------------------------------
+
+    //! True while the threads should keep running.
+    bool isRunning() const { return (m_state.load(std::memory_order_acquire) == LIFECYCLE_RUNNING); }
+
+    //! Report that the calling thread left its loop.
+    void threadFinished();
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Current state.
+    std::atomic<int> m_state;
+
+    //! Number of threads that have not finished, guarded by m_mutex.
+    int m_numThreads;
+
+    //! Signals the end of the last thread.
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,113 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CTripleBuffer.h
+
+    \brief
+    Wait-free single-producer / single-consumer handoff of a value between
+    two threads running at different rates.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CTripleBufferH
+#define CTripleBufferH
+//---------------------------------------------------------------------------
+#include <atomic>
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    \class      cTripleBuffer
+    \brief      Triple buffer: the producer fills a private back buffer and
+                publishes it by swapping it with the shared middle buffer;
+                the consumer swaps the middle buffer with its private front
+                buffer whenever a new value has been published.
+
+    Neither side ever waits for the other, and each side only touches its
+    own buffer, so the consumer always sees a complete value. Intermediate
+    values published between two reads are dropped, which is the desired
+    behavior when a 1 kHz haptic loop feeds a 60 Hz renderer.
+
+    Exactly one thread may call writeBuffer() / publish() and exactly one
+    other thread may call read().
+*/
+//===========================================================================
+template <class T> class cTripleBuffer
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cTripleBuffer.
+    cTripleBuffer() : m_middle(1), m_back(0), m_front(2) {}
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - PRODUCER:
+    //-----------------------------------------------------------------------
+
+    //! Buffer owned by the producer, to be filled before publish().
+    T& writeBuffer() { return (m_buffers[m_back]); }
+
+    //! Make the content of writeBuffer() available to the consumer.
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+
+    //-----------------------------------------------------------------------
+    // METHODS - CONSUMER:
+    //-----------------------------------------------------------------------
+
+    //! Latest published value; a_isNew is set when it changed since the last read.
+    const T& read(bool& a_isNew)
+    {
+        a_isNew = (m_middle.load(std::memory_order_relaxed) & FRESH_BIT) != 0;
+        if (a_isNew)
+        {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return (m_buffers[m_front]);
+    }
+
+    //! Latest published value.
+    const T& read()
+    {
+        bool isNew;
+        return (read(isNew));
+    }
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Mask of the buffer index stored in m_middle.
+    static const unsigned int INDEX_MASK = 0x3;
+
+    //! Flag set in m_middle when it holds a value not yet read.
+    static const unsigned int FRESH_BIT  = 0x4;
+
+    //! The three buffers.
+    T m_buffers[3];
+
+    //! Index of the shared buffer, with FRESH_BIT.
+    std::atomic<unsigned int> m_middle;
+
+    //! Index of the producer's buffer (producer thread only).
+    unsigned int m_back;
+
+    //! Index of the consumer's buffer (consumer thread only).
+    unsigned int m_front;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,174 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CWorkerPool.cpp
+
+    \brief
+    Fixed set of worker threads sharing loops over many items with the
+    thread that runs them.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "CWorkerPool.h"
+//---------------------------------------------------------------------------
+
+//===========================================================================
+/*!
+    Constructor of cWorkerPool. The pool has no worker until start().
+*/
+//===========================================================================
+cWorkerPool::cWorkerPool() : m_nextItem(0), m_numBusy(0)
+{
+    m_generation = 0;
+    m_stopping = false;
+    m_function = NULL;
+    m_data = NULL;
+    m_numItems = 0;
+    m_chunkSize = 1;
+}
+
+
+//===========================================================================
+/*!
+    Destructor of cWorkerPool.
+*/
+//===========================================================================
+cWorkerPool::~cWorkerPool()
+{
+    stop();
+}
+
+
+//===========================================================================
+/*!
+    Start the worker threads; a pool already running keeps its workers.
+
+    \param      a_numWorkers  Number of threads besides the caller of run().
+*/
+//===========================================================================
+void cWorkerPool::start(int a_numWorkers)
+{
+    if (!m_threads.empty()) { return; }
+
+    m_stopping = false;
+    for (int i=0; i<a_numWorkers; i++)
+    {
+        m_threads.push_back(std::thread(&cWorkerPool::workerLoop, this, m_generation));
+    }
+}
+
+
+//===========================================================================
+/*!
+    Stop the worker threads and wait for them to exit. Must not be called
+    during run().
+*/
+//===========================================================================
+void cWorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (unsigned int i=0; i<m_threads.size(); i++)
+    {
+        m_threads[i].join();
+    }
+    m_threads.clear();
+}
+
+
+//===========================================================================
+/*!
+    Run a loop on the workers and the calling thread, and wait for it to
+    complete.
+
+    \param      a_function   Function processing a range of items.
+    \param      a_data       Argument passed to a_function.
+    \param      a_numItems   Number of items of the loop.
+    \param      a_chunkSize  Number of items taken at once.
+*/
+//===========================================================================
+void cWorkerPool::run(cWorkerFunction a_function, void* a_data, int a_numItems, int a_chunkSize)
+{
+    if (a_numItems <= 0) { return; }
+
+    // not worth waking anybody
+    if (m_threads.empty() || (a_numItems <= a_chunkSize))
+    {
+        a_function(a_data, 0, a_numItems);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = a_function;
+        m_data = a_data;
+        m_numItems = a_numItems;
+        m_chunkSize = (a_chunkSize > 0) ? a_chunkSize : 1;
+        m_nextItem.store(0);
+        m_numBusy.store((int)m_threads.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    processChunks();
+
+    // a worker may still be finishing its last chunk, or not be awake
+    // yet; the next loop must not start before it left this one
+    while (m_numBusy.load(std::memory_order_acquire) > 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+
+//===========================================================================
+/*!
+    Wait for a loop, take part in it, and go back to sleep, until the pool
+    stops.
+
+    \param      a_generation  Number of loops started before the thread.
+*/
+//===========================================================================
+void cWorkerPool::workerLoop(unsigned long a_generation)
+{
+    unsigned long generation = a_generation;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_stopping && (m_generation == generation))
+            {
+                m_wake.wait(lock);
+            }
+            if (m_stopping) { return; }
+            generation = m_generation;
+        }
+
+        processChunks();
+        m_numBusy.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+
+//===========================================================================
+/*!
+    Take chunks of the current loop until every item has been taken.
+*/
+//===========================================================================
+void cWorkerPool::processChunks()
+{
+    while (true)
+    {
+        int begin = m_nextItem.fetch_add(m_chunkSize);
+        if (begin >= m_numItems) { return; }
+
+        int end = begin + m_chunkSize;
+        m_function(m_data, begin, (end < m_numItems) ? end : m_numItems);
+    }
+}
@@ -0,0 +1,121 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       CWorkerPool.h
+
+    \brief
+    Fixed set of worker threads sharing loops over many items with the
+    thread that runs them.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef CWorkerPoolH
+#define CWorkerPoolH
+//---------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// processes the items [a_begin, a_end) of a loop run by a cWorkerPool
+typedef void (*cWorkerFunction)(void* a_data, int a_begin, int a_end);
+
+
+//===========================================================================
+/*!
+    \class      cWorkerPool
+    \brief      Runs the iterations of a loop on several cores.
+
+    run() cuts the items of a loop into chunks, which the workers and the
+    calling thread take in turn until none is left, and returns once every
+    chunk is done. The items of one loop must be independent of each
+    other; everything written by the chunks is visible to the caller when
+    run() returns.
+
+    The workers sleep on a condition variable between two loops. A loop
+    too small to fill two chunks runs on the calling thread alone, as does
+    every loop of a pool without workers. Only one thread may call run().
+*/
+//===========================================================================
+class cWorkerPool
+{
+  public:
+
+    //-----------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //-----------------------------------------------------------------------
+
+    //! Constructor of cWorkerPool.
+    cWorkerPool();
+
+    //! Destructor of cWorkerPool.
+    ~cWorkerPool();
+
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Start a_numWorkers threads besides the caller of run().
+    void start(int a_numWorkers);
+
+    //! Stop and join the workers.
+    void stop();
+
+    //! Number of worker threads.
+    int getNumWorkers() const { return ((int)m_threads.size()); }
+
+    //! Run a_function over a_numItems items, in chunks of a_chunkSize.
+    void run(cWorkerFunction a_function, void* a_data, int a_numItems, int a_chunkSize);
+
+
+  protected:
+
+    //-----------------------------------------------------------------------
+    // METHODS:
+    //-----------------------------------------------------------------------
+
+    //! Body of each worker thread.
+    void workerLoop(unsigned long a_generation);
+
+    //! Take and process chunks of the current loop until none is left.
+    void processChunks();
+
+
+    //-----------------------------------------------------------------------
+    // MEMBERS:
+    //-----------------------------------------------------------------------
+
+    //! Worker threads.
+    std::vector<std::thread> m_threads;
+
+    //! Wakes the workers when a loop starts or the pool stops.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+
+    //! Number of loops started, and stop request (under m_mutex).
+    unsigned long m_generation;
+    bool m_stopping;
+
+    //! Current loop.
+    cWorkerFunction m_function;
+    void* m_data;
+    int m_numItems;
+    int m_chunkSize;
+
+    //! First item not yet taken, and workers still busy with the loop.
+    std::atomic<int> m_nextItem;
+    std::atomic<int> m_numBusy;
+};
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,29 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       GLEntryPoints.h
+
+    \brief
+    Declares the OpenGL entry points newer than 1.1 (buffer objects, pixel
+    and framebuffer objects, shaders, instancing). Mesa and Apple export
+    them directly; other platforms would need to load them at runtime.
+
+    A translation unit calling them includes this header before any other,
+    since the GL headers only declare them when GL_GLEXT_PROTOTYPES is
+    defined the first time they are read.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef GLEntryPointsH
+#define GLEntryPointsH
+//---------------------------------------------------------------------------
+#if defined(_LINUX) || defined(_MACOSX)
+#define GL_GLEXT_PROTOTYPES
+#endif
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
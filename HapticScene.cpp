@@ -0,0 +1,830 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       HapticScene.cpp
+
+    \brief
+    Virtual scene shared by the interactive application and the headless
+    benchmark, together with one iteration of the haptic loop.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "HapticScene.h"
+#include "Realtime.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// a world that contains all displayed objects
+cWorld* displayWorld;
+
+// a camera that renders the world in a window display
+cCamera* camera;
+
+// a light source to illuminate the objects in the virtual scene
+cLight *light;
+
+// a little "chai3d" bitmap logo at the bottom of the screen
+cBitmap* logo;
+
+// one channel per haptic device
+cHapticChannel channels[MAX_DEVICES];
+
+// number of channels in use
+int numChannels = 0;
+
+// radius of the tool proxy
+double proxyRadius;
+
+// the displayed copy of the virtual object
+cMesh* displayObject;
+
+// scene file the worlds are built from
+cSceneFile sceneFile;
+
+// displayed copy of each mesh of the scene file
+std::vector <cBufferedMesh *> displayMeshes;
+
+// meshes of the scene file drawn as instances
+std::vector <cInstancedMesh *> displayInstances;
+
+// a texture showing the image rendered by the camera
+cFeedbackTexture* texture;
+
+// simulation of the motion of the object on the rails
+cRailPhysics cubePhysics;
+
+// simulation of the blocks
+cBlockPhysics blockPhysics;
+
+// displayed copy of each block
+std::vector <cDisplayBlock> displayBlocks;
+
+// root resource path
+string resourceRoot;
+
+// rails along which the object may slide
+cRailNetwork railNetwork;
+
+// displayed rails
+cLineBatch* railLines;
+
+// virtual fixtures felt by every tool
+cForceField forceField;
+
+// objects of the displayed world that moved since their global frames
+// were last computed
+cFrameUpdater displayWorldFrames;
+
+//---------------------------------------------------------------------------
+// DECLARED MACROS
+//---------------------------------------------------------------------------
+// convert to resource path
+#define RESOURCE_PATH(p)    (char*)((resourceRoot+string(p)).c_str())
+
+
+//===========================================================================
+/*
+    Builds the haptic side of a channel: a world of its own holding a tool
+    connected to the given device and a collision copy of each haptic mesh
+    of the scene file. The device may be a physical device, a simulated
+    one or NULL.
+*/
+//===========================================================================
+
+static void createChannel(cHapticChannel& a_channel, cGenericHapticDevice* a_hapticDevice)
+{
+    // create a new world for the haptic simulation of this device. it is
+    // only ever touched by the haptics thread of the device once the
+    // simulation is running.
+    a_channel.m_world = new cWorld();
+    cWorld* world = a_channel.m_world;
+
+
+    //-----------------------------------------------------------------------
+    // HAPTIC DEVICES / TOOLS
+    //-----------------------------------------------------------------------
+
+    // retrieve information about the current haptic device
+    cHapticDeviceInfo info;
+    if (a_hapticDevice)
+    {
+        info = a_hapticDevice->getSpecifications();
+    }
+
+    // create a 3D tool and add it to the world
+    cGeneric3dofPointer* tool = new cGeneric3dofPointer(world);
+    world->addChild(tool);
+    a_channel.m_tool = tool;
+
+    // connect the haptic device to the tool
+    tool->setHapticDevice(a_hapticDevice);
+
+    // initialize tool by connecting to haptic device
+    tool->start();
+
+    // map the physical workspace of the haptic device to a larger virtual workspace.
+    tool->setWorkspaceRadius(1.0);
+
+    // define a radius for the tool (graphical display)
+    tool->setRadius(0.05);
+
+    // hide the device sphere. only show proxy.
+    tool->m_deviceSphere->setShowEnabled(false);
+
+    // set the physical readius of the proxy.
+    proxyRadius = 0.05;
+    tool->m_proxyPointForceModel->setProxyRadius(proxyRadius);
+    tool->m_proxyPointForceModel->m_collisionSettings.m_checkBothSidesOfTriangles = false;
+
+    // enable if objects in the scene are going to rotate of translate
+    // or possibly collide against the tool. If the environment
+    // is entirely static, you can set this parameter to "false"
+    tool->m_proxyPointForceModel->m_useDynamicProxy = true;
+
+    // read the scale factor between the physical workspace of the haptic
+    // device and the virtual workspace defined for the tool
+    double workspaceScaleFactor = tool->getWorkspaceScaleFactor();
+
+    // define a maximum stiffness that can be handled by the current
+    // haptic device. The value is scaled to take into account the
+    // workspace scale factor
+    double stiffnessMax = info.m_maxForceStiffness / workspaceScaleFactor;
+
+    // commands sent to the device stay within the force it can render
+    a_channel.m_forces.configure(info.m_maxForce, FORCE_FILTER_CUTOFF);
+
+
+    //-----------------------------------------------------------------------
+    // COMPOSE THE VIRTUAL SCENE
+    //-----------------------------------------------------------------------
+
+    // build the haptic meshes of the scene; the first one on the rails is
+    // the cube moved by the physics
+    for (int i=0; i<sceneFile.getNumMeshes(); i++)
+    {
+        const cSceneMesh& sceneMesh = sceneFile.getMesh(i);
+        if ((sceneMesh.m_flags & SCENE_MESH_HAPTIC) == 0) { continue; }
+
+        // create a virtual mesh and add it to the world
+        cMesh* object = new cMesh(world);
+        world->addChild(object);
+        sceneFile.createMesh(sceneMesh, object);
+
+        if (((sceneMesh.m_flags & SCENE_MESH_ON_RAILS) != 0) && (a_channel.m_object == NULL))
+        {
+            a_channel.m_object = object;
+        }
+
+        // compute collision detection algorithm; the AABB tree is loaded
+        // from the cache next to the executable when this mesh was seen
+        // before
+        if (sceneMesh.m_flags & SCENE_MESH_BVH4)
+        {
+            cCollisionBVH4::create(object, 1.01 * proxyRadius);
+        }
+        else
+        {
+            cCachedCollisionAABB::create(object, 1.01 * proxyRadius, false, resourceRoot);
+        }
+
+        // define the stiffness of the object, within the limits of this device
+        object->setStiffness(sceneMesh.m_material.m_stiffness * stiffnessMax, true);
+
+        // define friction properties
+        object->setFriction(sceneMesh.m_material.m_staticFriction,
+                            sceneMesh.m_material.m_dynamicFriction, true);
+    }
+
+    // the blocks are felt through the block physics rather than the
+    // proxy; they all take the stiffness of the first one
+    for (int i=0; i<sceneFile.getNumMeshes(); i++)
+    {
+        const cSceneMesh& sceneMesh = sceneFile.getMesh(i);
+        if (sceneMesh.m_flags & SCENE_MESH_BLOCK)
+        {
+            a_channel.m_blockStiffness = sceneMesh.m_material.m_stiffness * stiffnessMax;
+            break;
+        }
+    }
+
+    // compute the initial global frames of the world
+    world->computeGlobalPositions(true);
+}
+
+
+//===========================================================================
+/*
+    Returns half the side of the cube aligned with the axes bounding the
+    vertices of a mesh of the scene file, around its origin.
+*/
+//===========================================================================
+
+static double getHalfSize(const cSceneMesh& a_sceneMesh)
+{
+    const cSceneVertex* vertices = sceneFile.getVertices(a_sceneMesh);
+    double halfSize = 0.0;
+    for (unsigned int i=0; i<a_sceneMesh.m_numVertices; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            halfSize = cMax(halfSize, fabs((double)vertices[i].m_pos[k]));
+        }
+    }
+    return (halfSize);
+}
+
+
+//===========================================================================
+/*
+    Creates the object drawing the instances of a mesh of the scene file,
+    with its geometry and material, and adds it to the displayed world.
+*/
+//===========================================================================
+
+static cInstancedMesh* createInstancedMesh(const cSceneMesh& a_sceneMesh)
+{
+    const cSceneVertex* sceneVertices = sceneFile.getVertices(a_sceneMesh);
+    std::vector<cBufferedVertex> vertices(a_sceneMesh.m_numVertices);
+    for (unsigned int i=0; i<a_sceneMesh.m_numVertices; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            vertices[i].m_pos[k] = sceneVertices[i].m_pos[k];
+            vertices[i].m_normal[k] = sceneVertices[i].m_normal[k];
+        }
+        vertices[i].m_texCoord[0] = sceneVertices[i].m_texCoord[0];
+        vertices[i].m_texCoord[1] = sceneVertices[i].m_texCoord[1];
+    }
+
+    const cSceneTriangle* sceneTriangles = sceneFile.getTriangles(a_sceneMesh);
+    std::vector<unsigned int> indices;
+    indices.reserve(3 * a_sceneMesh.m_numTriangles);
+    for (unsigned int i=0; i<a_sceneMesh.m_numTriangles; i++)
+    {
+        indices.push_back(sceneTriangles[i].m_vertex[0]);
+        indices.push_back(sceneTriangles[i].m_vertex[1]);
+        indices.push_back(sceneTriangles[i].m_vertex[2]);
+    }
+
+    cInstancedMesh* mesh = new cInstancedMesh();
+    displayWorld->addChild(mesh);
+    mesh->setGeometry(vertices, indices);
+    cSceneFile::getMaterial(a_sceneMesh, mesh->m_material);
+    displayInstances.push_back(mesh);
+
+    return (mesh);
+}
+
+
+//===========================================================================
+/*
+    Builds the virtual scene: camera, light and logo, one channel per
+    haptic device, and the meshes and rails of the scene file. The devices
+    may be physical devices or simulated ones.
+*/
+//===========================================================================
+
+bool createScene(const char* a_sceneFilename,
+                 cGenericHapticDevice** a_hapticDevices, int a_numDevices)
+{
+    //-----------------------------------------------------------------------
+    // SCENE FILE
+    //-----------------------------------------------------------------------
+
+    // map the scene; its tables are read in place while the worlds are built
+    if (!sceneFile.load(a_sceneFilename))
+    {
+        printf("cannot read scene %s\n", a_sceneFilename);
+        return (false);
+    }
+
+    // the cube is the first haptic mesh on the rails; the physics, the
+    // haptic loops and the display all need one
+    int cubeIndex = -1;
+    for (int i=0; (i<sceneFile.getNumMeshes()) && (cubeIndex < 0); i++)
+    {
+        unsigned int flags = sceneFile.getMesh(i).m_flags;
+        if (((flags & SCENE_MESH_HAPTIC) != 0) && ((flags & SCENE_MESH_ON_RAILS) != 0))
+        {
+            cubeIndex = i;
+        }
+    }
+    if (cubeIndex < 0)
+    {
+        printf("scene %s has no haptic mesh on the rails\n", a_sceneFilename);
+        return (false);
+    }
+
+
+    //-----------------------------------------------------------------------
+    // 3D - SCENEGRAPH
+    //-----------------------------------------------------------------------
+
+    // create a world holding everything that is displayed. it is only
+    // ever touched by the graphics thread.
+    displayWorld = new cWorld();
+
+    // set the background color of the environment
+    // the color is defined by its (R,G,B) components.
+    displayWorld->setBackgroundColor(1.0, 0.0, 0.0);
+
+    // create a camera and insert it into the displayed world
+    camera = new cCamera(displayWorld);
+    displayWorld->addChild(camera);
+
+    // position and oriente the camera
+    camera->set( cVector3d (3.0, 0.0, 0.0),    // camera position (eye)
+                 cVector3d (0.0, 0.0, 0.0),    // lookat position (target)
+                 cVector3d (0.0, 0.0, 1.0));   // direction of the "up" vector
+
+    // set the near and far clipping planes of the camera
+    // anything in front/behind these clipping planes will not be rendered
+    camera->setClippingPlanes(0.01, 10.0);
+
+    // create a light source and attach it to the camera
+    light = new cLight(displayWorld);
+    camera->addChild(light);                   // attach light to camera
+    light->setEnabled(true);                   // enable light source
+    light->setPos(cVector3d( 2.0, 0.5, 1.0));  // position the light source
+    light->setDir(cVector3d(-2.0, 0.5, 1.0));  // define the direction of the light beam
+
+
+    //-----------------------------------------------------------------------
+    // 2D - WIDGETS
+    //-----------------------------------------------------------------------
+
+    // create a 2D bitmap logo
+    logo = new cBitmap();
+
+    // add logo to the front plane
+    camera->m_front_2Dscene.addChild(logo);
+
+    // load a "chai3d" bitmap image file
+    bool fileload;
+    fileload = logo->m_image.loadFromFile(RESOURCE_PATH("resources/images/chai3d-w.bmp"));
+    if (!fileload)
+    {
+        #if defined(_MSVC)
+        fileload = logo->m_image.loadFromFile("../../../bin/resources/images/chai3d-w.bmp");
+        #endif
+    }
+
+    // position the logo at the bottom left of the screen (pixel coordinates)
+    logo->setPos(10, 10, 0);
+
+    // scale the logo along its horizontal and vertical axis
+    logo->setZoomHV(0.25, 0.25);
+
+    // here we replace all wite pixels (1,1,1) of the logo bitmap
+    // with transparent black pixels (1, 1, 1, 0). This allows us to make
+    // the background of the logo look transparent.
+    logo->m_image.replace(
+                          cColorb(0xff, 0xff, 0xff),         // original RGB color
+                          cColorb(0xff, 0xff, 0xff, 0x00)    // new RGBA color
+                          );
+
+    // enable transparency
+    logo->enableTransparency(true);
+
+
+    //-----------------------------------------------------------------------
+    // HAPTIC DEVICES / TOOLS
+    //-----------------------------------------------------------------------
+
+    // one channel, with its own tool and world, per device
+    numChannels = cClamp(a_numDevices, 1, MAX_DEVICES);
+    for (int i=0; i<numChannels; i++)
+    {
+        createChannel(channels[i], (i < a_numDevices) ? a_hapticDevices[i] : NULL);
+    }
+    cMesh* object = channels[0].m_object;
+
+
+    //-----------------------------------------------------------------------
+    // COMPOSE THE DISPLAYED SCENE
+    //-----------------------------------------------------------------------
+
+    // create a texture fed by the camera
+    texture = new cFeedbackTexture();
+
+    // meshes repeating the geometry and material of another one are drawn
+    // together as instances, unless they need a mesh of their own
+    std::vector<int> batches(sceneFile.getNumMeshes(), -1);
+    std::vector<int> batchFirst, batchSize;
+    for (int i=0; i<sceneFile.getNumMeshes(); i++)
+    {
+        const cSceneMesh& sceneMesh = sceneFile.getMesh(i);
+        if ((i == cubeIndex) ||
+            (sceneMesh.m_flags & (SCENE_MESH_CAMERA_TEXTURE | SCENE_MESH_SHOW_NORMALS))) { continue; }
+
+        for (unsigned int j=0; (j<batchFirst.size()) && (batches[i] < 0); j++)
+        {
+            if (cSceneFile::isSameMesh(sceneMesh, sceneFile.getMesh(batchFirst[j])))
+            {
+                batches[i] = j;
+                batchSize[j]++;
+            }
+        }
+        if (batches[i] < 0)
+        {
+            batches[i] = (int)batchFirst.size();
+            batchFirst.push_back(i);
+            batchSize.push_back(1);
+        }
+    }
+
+    // create the displayed copy of every mesh of the scene
+    displayObject = NULL;
+    std::vector<cInstancedMesh*> batchMeshes(batchFirst.size(), (cInstancedMesh*)NULL);
+    for (int i=0; i<sceneFile.getNumMeshes(); i++)
+    {
+        const cSceneMesh& sceneMesh = sceneFile.getMesh(i);
+        cVector3d pos;
+        cMatrix3d rot;
+        cSceneFile::getFrame(sceneMesh, pos, rot);
+
+        // a block moves with the block physics; past MAX_BLOCKS, it stays
+        // where it is
+        cDisplayBlock block;
+        bool isBlock = false;
+        if (sceneMesh.m_flags & SCENE_MESH_BLOCK)
+        {
+            isBlock = (blockPhysics.addBlock(pos, getHalfSize(sceneMesh)) >= 0);
+            block.m_rot = rot;
+        }
+
+        int batch = batches[i];
+        if ((batch >= 0) && (batchSize[batch] > 1))
+        {
+            if (batchMeshes[batch] == NULL)
+            {
+                batchMeshes[batch] = createInstancedMesh(sceneMesh);
+            }
+            block.m_instances = batchMeshes[batch];
+            block.m_instance = batchMeshes[batch]->getNumInstances();
+            batchMeshes[batch]->addInstance(pos, rot);
+            displayMeshes.push_back(NULL);
+            if (isBlock) { displayBlocks.push_back(block); }
+            continue;
+        }
+
+        cBufferedMesh* mesh = new cBufferedMesh(displayWorld);
+        displayWorld->addChild(mesh);
+        sceneFile.createMesh(sceneMesh, mesh);
+        displayMeshes.push_back(mesh);
+
+        if (isBlock)
+        {
+            block.m_mesh = mesh;
+            displayBlocks.push_back(block);
+        }
+
+        // the displayed cube follows the haptic one
+        if (i == cubeIndex)
+        {
+            displayObject = mesh;
+        }
+
+        if (sceneMesh.m_flags & SCENE_MESH_CAMERA_TEXTURE)
+        {
+            mesh->setTexture(texture);
+            mesh->setUseTexture(true);
+        }
+
+        if (sceneMesh.m_flags & SCENE_MESH_SHOW_NORMALS)
+        {
+            // display triangle normals
+            mesh->setShowNormals(true);
+
+            // set length and color of normals
+            mesh->setNormalsProperties(0.1, cColorf(0.0, 1.0, 0.0), true);
+        }
+    }
+
+    // create a sphere showing the proxy of each tool
+    for (int i=0; i<numChannels; i++)
+    {
+        channels[i].m_proxyCursor = new cShapeSphere(0.05);
+        displayWorld->addChild(channels[i].m_proxyCursor);
+    }
+
+    // create the rails
+    for (int i=0; i<sceneFile.getNumRails(); i++)
+    {
+        const cSceneRail& rail = sceneFile.getRail(i);
+        railNetwork.addSegment(cVector3d(rail.m_pointA[0], rail.m_pointA[1], rail.m_pointA[2]),
+                               cVector3d(rail.m_pointB[0], rail.m_pointB[1], rail.m_pointB[2]));
+    }
+    railNetwork.build();
+
+    // display the rails, all with one draw call
+    railLines = new cLineBatch();
+    displayWorld->addChild(railLines);
+    for (int i=0; i<railNetwork.getNumSegments(); i++)
+    {
+        const cRailSegment& segment = railNetwork.getSegment(i);
+        railLines->addLine(segment.m_pointA, segment.m_pointB);
+    }
+
+    // create the virtual fixtures
+    for (int i=0; i<sceneFile.getNumForceFields(); i++)
+    {
+        const cSceneForceField& field = sceneFile.getForceField(i);
+        cVector3d pointA(field.m_pointA[0], field.m_pointA[1], field.m_pointA[2]);
+        cVector3d pointB(field.m_pointB[0], field.m_pointB[1], field.m_pointB[2]);
+        switch (field.m_type)
+        {
+            case SCENE_FIELD_PLANE:
+                forceField.addPlane(pointA, field.m_scalar, field.m_stiffness);
+                break;
+            case SCENE_FIELD_BOX:
+                forceField.addBox(pointA, pointB, field.m_stiffness);
+                break;
+            case SCENE_FIELD_SPHERE:
+                forceField.addSphere(pointA, field.m_scalar, field.m_stiffness);
+                break;
+            case SCENE_FIELD_RAIL:
+                forceField.addRail(pointA, pointB, field.m_scalar, field.m_stiffness);
+                break;
+            case SCENE_FIELD_ATTRACTOR:
+                forceField.addAttractor(pointA, field.m_scalar, field.m_stiffness);
+                break;
+        }
+    }
+
+    // start the object at rest where it was placed, pushed by every channel
+    cubePhysics.initialize(&railNetwork, object->getPos(), numChannels);
+
+    // the blocks start at rest too, and are pushed by the cube. their loops
+    // run on the cores left by the graphics, physics and haptics threads
+    blockPhysics.setObstacleSize(getHalfSize(sceneFile.getMesh(cubeIndex)));
+    blockPhysics.setObstacle(object->getPos());
+    blockPhysics.initialize(&railNetwork, numChannels);
+    if (blockPhysics.getNumBlocks() > 0)
+    {
+        blockPhysics.startWorkers(cMax(getNumCores() - numChannels - 2, 0));
+    }
+
+    // compute the initial global frames of the displayed world
+    displayWorld->computeGlobalPositions(true);
+
+    return (true);
+}
+
+//---------------------------------------------------------------------------
+
+void mapCameraTexture(double a_uMin, double a_uMax, double a_vMin, double a_vMax)
+{
+    // the base coordinates stay in the mapped scene file, so repeated
+    // calls never accumulate rounding
+    for (int i=0; i<sceneFile.getNumMeshes(); i++)
+    {
+        const cSceneMesh& sceneMesh = sceneFile.getMesh(i);
+        if ((sceneMesh.m_flags & SCENE_MESH_CAMERA_TEXTURE) == 0) { continue; }
+
+        cBufferedMesh* mesh = displayMeshes[i];
+        const cSceneVertex* vertices = sceneFile.getVertices(sceneMesh);
+        for (unsigned int j=0; j<sceneMesh.m_numVertices; j++)
+        {
+            double u = a_uMin + vertices[j].m_texCoord[0] * (a_uMax - a_uMin);
+            double v = a_vMin + vertices[j].m_texCoord[1] * (a_vMax - a_vMin);
+            mesh->getVertex(j)->setTexCoord(u, v);
+        }
+
+        // only the texture coordinates of these vertices are uploaded again
+        mesh->invalidateVertices(0, sceneMesh.m_numVertices);
+    }
+}
+
+//---------------------------------------------------------------------------
+
+void fitCameraTexture(int a_displayW, int a_displayH)
+{
+    if ((a_displayW <= 0) || (a_displayH <= 0)) { return; }
+
+    // show the central square of the image
+    double txMin, txMax, tyMin, tyMax;
+    if (a_displayW >= a_displayH)
+    {
+        double ratio = (double)a_displayW / (double)a_displayH;
+        txMin = 0.5 * (ratio - 1.0) / ratio;
+        txMax = 1.0 - txMin;
+        tyMin = 0.0;
+        tyMax = 1.0;
+    }
+    else
+    {
+        double ratio = (double)a_displayH / (double)a_displayW;
+        txMin = 0.0;
+        txMax = 1.0;
+        tyMin = 0.5 * (ratio - 1.0) / ratio;
+        tyMax = 1.0 - tyMin;
+    }
+
+    mapCameraTexture(txMin, txMax, tyMin, tyMax);
+}
+
+//---------------------------------------------------------------------------
+
+double computeCameraTextureSize(int a_displayH)
+{
+    // a face of a mesh shows the whole square of the camera image, so the
+    // square is displayed about as large as the largest side of the mesh;
+    // the projection of that side at the distance of the nearest face of
+    // the mesh gives its size in pixels
+    double tanHalfAngle = tan(cDegToRad(0.5 * camera->getFieldViewAngle()));
+    cVector3d eye = camera->getGlobalPos();
+    double size = 0.0;
+    for (int i=0; i<sceneFile.getNumMeshes(); i++)
+    {
+        const cSceneMesh& sceneMesh = sceneFile.getMesh(i);
+        if ((sceneMesh.m_flags & SCENE_MESH_CAMERA_TEXTURE) == 0) { continue; }
+
+        cMesh* mesh = displayMeshes[i];
+        cVector3d boundaryMin = mesh->getBoundaryMin();
+        cVector3d boundaryMax = mesh->getBoundaryMax();
+        cVector3d extent = cSub(boundaryMax, boundaryMin);
+        double side = cMax(extent.x, cMax(extent.y, extent.z));
+        cVector3d center = cAdd(mesh->getGlobalPos(),
+                                cMul(mesh->getGlobalRot(), cMul(0.5, cAdd(boundaryMin, boundaryMax))));
+
+        // the camera inside or against the mesh sees it fill the window
+        double distance = cDistance(eye, center) - 0.5 * side;
+        if (distance * tanHalfAngle <= 0.5 * side) { return ((double)a_displayH); }
+
+        size = cMax(size, (double)a_displayH * side / (2.0 * distance * tanHalfAngle));
+    }
+    return (size);
+}
+
+//---------------------------------------------------------------------------
+
+void stepPhysics(double a_elapsed)
+{
+    // the blocks see the cube where its own step left it
+    cubePhysics.update(a_elapsed);
+    blockPhysics.setObstacle(cubePhysics.getPos());
+    blockPhysics.update(a_elapsed);
+}
+
+//===========================================================================
+/*
+    One iteration of the haptic loop of a channel: update the scene graph
+    and the tool, render contact forces, and exchange the contact force and
+    the cube position with the physics.
+*/
+//===========================================================================
+
+void updateHapticsTick(int a_channel, double a_timeInterval)
+{
+    cHapticChannel& channel = channels[a_channel];
+    cGeneric3dofPointer* tool = channel.m_tool;
+    cMesh* object = channel.m_object;
+
+    HAPTIC_STAGE_BEGIN(channel.m_stageTimer);
+
+    // compute global reference frames of the objects moved during the
+    // previous tick; the rest of the world keeps its frames
+    channel.m_frames.update();
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_GLOBAL_POSITIONS);
+
+    // update position and orientation of tool
+    tool->updatePose();
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_UPDATE_POSE);
+
+    // compute interaction forces
+    tool->computeInteractionForces();
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_INTERACTION_FORCES);
+
+    // push of the blocks near the device, which are pushed back in turn
+    cVector3d blockForce = blockPhysics.computeToolForce(a_channel, tool->m_deviceGlobalPos, proxyRadius,
+                                                         channel.m_blockStiffness, a_timeInterval);
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_BLOCK_CONTACTS);
+
+    // sum the contact forces of the proxy and of the blocks and the forces
+    // of the virtual fixtures, in global coordinates
+    cVector3d force = forceField.computeForce(tool->m_deviceGlobalPos);
+    force.add(tool->m_lastComputedGlobalForce);
+    force.add(blockForce);
+
+    // send them to the device as one filtered, saturated command in device
+    // coordinates; this is the only device write of the tick
+    cForceComposer& forces = channel.m_forces;
+    if (channel.m_forceStopped.load(std::memory_order_relaxed) && channel.m_forceStopped.exchange(false))
+    {
+        // the device was stopped while this thread was stuck: come back
+        // softly, the filter ramping up from zero to the force of this tick
+        forces.restartFilter();
+    }
+    forces.begin();
+    forces.add(cMul(cTrans(tool->getGlobalRot()), force));
+    forces.compose(a_timeInterval);
+    forces.send(tool->getHapticDevice());
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_APPLY_FORCES);
+
+    // force applied by the tool on the object
+    cVector3d objectForce(0,0,0);
+
+    // check if tool is touching an object
+    cGenericObject* objectContact = tool->m_proxyPointForceModel->m_contactPoint0->m_object;
+    if (objectContact != NULL)
+    {
+        // get the last force applied to the cursor in global coordinates
+        // we negate the result to obtain the opposite force that is applied on the
+        // object
+        objectForce = cNegate(tool->m_lastComputedGlobalForce);
+    }
+
+    // hand the force over to the physics, which integrates the motion of
+    // the object on its own thread, and place the object where the
+    // physics predicts it to be now
+    cubePhysics.addForce(a_channel, objectForce, a_timeInterval, tool->getUserSwitch(0));
+    object->setPos(cubePhysics.extrapolate(a_channel, a_timeInterval));
+    channel.m_frames.markDirty(object);
+
+    // the tool moves its device and proxy spheres during the tick
+    channel.m_frames.markDirty(tool);
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_OBJECT_MOTION);
+
+    // hand the new poses over to the graphics thread
+    publishPoses(channel);
+    HAPTIC_STAGE_MARK(channel.m_stageTimer, STAGE_PUBLISH_POSES);
+
+    HAPTIC_STAGE_END(channel.m_stageTimer);
+}
+
+//---------------------------------------------------------------------------
+
+void publishPoses(cHapticChannel& a_channel)
+{
+    cGeneric3dofPointer* tool = a_channel.m_tool;
+
+    cPoseSnapshot& snapshot = a_channel.m_poseBuffer.writeBuffer();
+    snapshot.m_objectPos = a_channel.m_object->getGlobalPos();
+    snapshot.m_objectRot = a_channel.m_object->getGlobalRot();
+    snapshot.m_proxyPos = tool->m_proxyPointForceModel->getProxyGlobalPosition();
+    snapshot.m_devicePos = tool->m_deviceGlobalPos;
+    snapshot.m_userSwitch = tool->getUserSwitch(0);
+    snapshot.m_tick = ++a_channel.m_numPublished;
+    a_channel.m_poseBuffer.publish();
+}
+
+//---------------------------------------------------------------------------
+
+bool updateDisplayPoses(void)
+{
+    // take the latest complete snapshot of each channel; never waits for
+    // the haptics threads
+    bool anyNew = false;
+    for (int i=0; i<numChannels; i++)
+    {
+        bool isNew;
+        const cPoseSnapshot& snapshot = channels[i].m_poseBuffer.read(isNew);
+        if (!isNew) { continue; }
+        anyNew = true;
+
+        // every channel sees the same cube; show the pose seen by the first
+        if (i == 0)
+        {
+            displayObject->setPos(snapshot.m_objectPos);
+            displayObject->setRot(snapshot.m_objectRot);
+            displayWorldFrames.markDirty(displayObject);
+        }
+
+        channels[i].m_proxyCursor->setPos(snapshot.m_proxyPos);
+        displayWorldFrames.markDirty(channels[i].m_proxyCursor);
+    }
+
+    // move the blocks that moved since the previous poses
+    bool isNew;
+    const cBlockPoses& poses = blockPhysics.readPoses(isNew);
+    if (isNew)
+    {
+        anyNew = true;
+        for (int i=0; i<poses.m_numBlocks; i++)
+        {
+            cDisplayBlock& block = displayBlocks[i];
+            if (block.m_instances != NULL)
+            {
+                block.m_instances->setInstance(block.m_instance, poses.m_pos[i], block.m_rot);
+            }
+            else
+            {
+                block.m_mesh->setPos(poses.m_pos[i]);
+                displayWorldFrames.markDirty(block.m_mesh);
+            }
+        }
+    }
+
+    // update global frames of the displayed objects that moved
+    displayWorldFrames.update();
+
+    return (anyNew);
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,253 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       HapticScene.h
+
+    \brief
+    Virtual scene shared by the interactive application and the headless
+    benchmark, together with one iteration of the haptic loop.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef HapticSceneH
+#define HapticSceneH
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTripleBuffer.h"
+#include "CRailNetwork.h"
+#include "CFeedbackTexture.h"
+#include "CRailPhysics.h"
+#include "CBlockPhysics.h"
+#include "CStageTimer.h"
+#include "CFrameUpdater.h"
+#include "CSceneFile.h"
+#include "CCachedCollisionAABB.h"
+#include "CCollisionBVH4.h"
+#include "CForceField.h"
+#include "CForceComposer.h"
+#include "CBufferedMesh.h"
+#include "CInstancedMesh.h"
+#include "CLineBatch.h"
+#include <atomic>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// maximum number of haptic devices driven at once; each one feeds the
+// physics of the cube through its own channel
+const int MAX_DEVICES = MAX_PHYSICS_CHANNELS;
+
+// cutoff frequency [Hz] of the low-pass filter on the force commands;
+// well above what a hand feels, well below the haptic rate
+const double FORCE_FILTER_CUTOFF = 250.0;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// poses computed by the haptics thread and displayed by the graphics thread
+struct cPoseSnapshot
+{
+    cPoseSnapshot() : m_objectPos(0,0,0), m_proxyPos(0,0,0), m_devicePos(0,0,0),
+                      m_userSwitch(false), m_tick(0) { m_objectRot.identity(); }
+
+    // position and orientation of the object in global coordinates
+    cVector3d m_objectPos;
+    cMatrix3d m_objectRot;
+
+    // position of the tool proxy and of the device in global coordinates
+    cVector3d m_proxyPos;
+    cVector3d m_devicePos;
+
+    // status of the user switch
+    bool m_userSwitch;
+
+    // haptic tick that produced the snapshot
+    unsigned long m_tick;
+};
+
+// everything driven by the haptics thread of one device. each device has
+// its own world holding its tool and its own collision copy of the cube,
+// so the haptics threads never share scene graph data; the position of
+// the cube is shared through the physics, which hands each channel its
+// own snapshot of the state.
+struct cHapticChannel
+{
+    cHapticChannel() : m_world(NULL), m_tool(NULL), m_object(NULL), m_blockStiffness(0.0),
+                       m_proxyCursor(NULL), m_numPublished(0), m_forceStopped(false) {}
+
+    // world of the device; only its haptics thread may access it while
+    // the simulation is running
+    cWorld* m_world;
+
+    // virtual tool representing the device
+    cGeneric3dofPointer* m_tool;
+
+    // collision copy of the cube; the other haptic meshes of the scene
+    // are static
+    cMesh* m_object;
+
+    // stiffness of the blocks, within the limits of the device
+    double m_blockStiffness;
+
+    // objects of m_world that moved since their global frames were computed
+    cFrameUpdater m_frames;
+
+    // sum of the forces on the tool, sent to the device once per tick
+    cForceComposer m_forces;
+
+    // poses published by the haptics thread for the graphics thread
+    cTripleBuffer<cPoseSnapshot> m_poseBuffer;
+
+    // sphere showing the proxy in the displayed world (graphics thread)
+    cShapeSphere* m_proxyCursor;
+
+    // number of snapshots published so far
+    unsigned long m_numPublished;
+
+    // set by another thread when the tick stalled, before it stops the
+    // force of the device if it can; the next tick restarts the force from
+    // zero
+    std::atomic<bool> m_forceStopped;
+
+    #ifdef HAPTICS_STAGE_TIMING
+    // durations of the stages of the recent haptic ticks
+    cStageTimer m_stageTimer;
+    #endif
+};
+
+// displayed copy of a block: a mesh of its own, or one instance of a mesh
+// drawing several blocks
+struct cDisplayBlock
+{
+    cDisplayBlock() : m_mesh(NULL), m_instances(NULL), m_instance(0) { m_rot.identity(); }
+
+    cBufferedMesh* m_mesh;
+    cInstancedMesh* m_instances;
+    int m_instance;
+
+    // orientation of the block, which only translates
+    cMatrix3d m_rot;
+};
+
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// a world that contains all displayed objects; only the graphics thread
+// may access it while the simulation is running
+extern cWorld* displayWorld;
+
+// a camera that renders the world in a window display
+extern cCamera* camera;
+
+// a light source to illuminate the objects in the virtual scene
+extern cLight *light;
+
+// a little "chai3d" bitmap logo at the bottom of the screen
+extern cBitmap* logo;
+
+// one channel per haptic device
+extern cHapticChannel channels[MAX_DEVICES];
+
+// number of channels in use
+extern int numChannels;
+
+// radius of the tool proxy
+extern double proxyRadius;
+
+// the displayed copy of the virtual object
+extern cMesh* displayObject;
+
+// scene file the worlds are built from; stays mapped while the scene exists
+extern cSceneFile sceneFile;
+
+// displayed copy of each mesh of the scene file, in the order of the file;
+// NULL for the meshes drawn as instances
+extern std::vector <cBufferedMesh *> displayMeshes;
+
+// meshes of the scene file repeating the same geometry and material, each
+// drawn as the instances of one object
+extern std::vector <cInstancedMesh *> displayInstances;
+
+// a texture showing the image rendered by the camera
+extern cFeedbackTexture* texture;
+
+// simulation of the motion of the object on the rails; updated by its
+// own thread, fed and read by the haptics thread of each channel
+extern cRailPhysics cubePhysics;
+
+// simulation of the blocks, pushed by the cube and the tools; updated by
+// the physics thread with the cube, felt by each channel through its own
+// set of nearby blocks
+extern cBlockPhysics blockPhysics;
+
+// displayed copy of each block, in the order of blockPhysics
+extern std::vector <cDisplayBlock> displayBlocks;
+
+// root resource path
+extern string resourceRoot;
+
+// rails along which the object may slide
+extern cRailNetwork railNetwork;
+
+// displayed rails, drawn together
+extern cLineBatch* railLines;
+
+// virtual fixtures felt by every tool; built with the scene and only read
+// by the haptics threads afterwards
+extern cForceField forceField;
+
+// objects of the displayed world that moved since their global frames
+// were last computed
+extern cFrameUpdater displayWorldFrames;
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// build one channel per device in a_hapticDevices (entries may be NULL),
+// the displayed world, and the meshes, rails and force fields of a scene
+// file; returns false if the scene file cannot be loaded or has no mesh
+// on the rails
+bool createScene(const char* a_sceneFilename,
+                 cGenericHapticDevice** a_hapticDevices, int a_numDevices);
+
+// map the base texture coordinates of the meshes showing the camera image
+// to the part [a_uMin,a_uMax]x[a_vMin,a_vMax] of that image
+void mapCameraTexture(double a_uMin, double a_uMax, double a_vMin, double a_vMax);
+
+// map the camera image onto the meshes showing it so that they show the
+// central square of a window of a_displayW x a_displayH pixels
+void fitCameraTexture(int a_displayW, int a_displayH);
+
+// size in pixels at which the square of the camera image appears on the
+// largest mesh showing it, in a window a_displayH pixels high (graphics
+// thread)
+double computeCameraTextureSize(int a_displayH);
+
+// advance the physics of the cube, then that of the blocks pushed by it,
+// by a_elapsed seconds (physics thread)
+void stepPhysics(double a_elapsed);
+
+// run one iteration of the haptic loop of a channel; a_timeInterval is the
+// time in seconds elapsed since the previous iteration of that channel
+void updateHapticsTick(int a_channel, double a_timeInterval);
+
+// publish the current poses of the world of a channel (its haptics thread)
+void publishPoses(cHapticChannel& a_channel);
+
+// copy the latest published poses into the displayed world (graphics
+// thread); returns true if they changed since the previous call
+bool updateDisplayPoses(void);
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
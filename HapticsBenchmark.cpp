@@ -0,0 +1,343 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       HapticsBenchmark.cpp
+
+    \brief
+    Headless benchmark of the haptic loop. Builds the same scene as the
+    interactive application, connects the tool to a scripted simulated
+    device and runs a fixed number of ticks without opening a window,
+    reporting per-tick latency percentiles and the achieved rate.
+
+    usage: HapticsBenchmark [--check-allocations] [ticks] [warmup ticks]
+                            [rate] [recording|-] [scene|-]
+                            [transport delay us] [direct|pipelined]
+
+    With a rate in Hz the ticks are paced by the deadline scheduler and
+    the lateness of each tick is reported as well; by default the loop
+    free-runs. With a recording made by the application (-w), the
+    recorded session is replayed instead of the scripted path, and the
+    largest difference with the recorded forces is reported. The scene
+    file defaults to cube.hscn next to the executable.
+
+    A transport delay makes each position read and force write of the
+    scripted device last that long, like a device on USB. In pipelined
+    mode the device is driven by an I/O thread through a
+    cPipelinedHapticDevice; the delay between the read of a position and
+    the write of the force computed from it is reported with the rate, to
+    weigh the latency added by the pipeline against the throughput gained.
+
+    With --check-allocations, the heap operations of the measured ticks
+    are counted, on the haptics thread only, and the benchmark fails if
+    there is any. The warm-up then covers at least one period of the
+    script, so that every contact configuration of the path has been
+    seen once.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "HapticScene.h"
+#include "CScriptedHapticDevice.h"
+#include "CReplayHapticDevice.h"
+#include "CLatencyHistogram.h"
+#include "CHapticScheduler.h"
+#include "CPipelinedHapticDevice.h"
+#include "Realtime.h"
+#include "AllocationCounter.h"
+#include "CThreadLifecycle.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// default number of measured and warm-up ticks
+const int DEFAULT_NUM_TICKS     = 20000;
+const int DEFAULT_NUM_WARMUP    = 1000;
+
+// simulated time step fed to the script and to the object motion [s]
+const double SCRIPT_TIME_STEP   = 0.001;
+
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// scripted device, when the session is not replayed
+cScriptedHapticDevice* scriptedDevice = NULL;
+
+// pipeline between the tool and the scripted device, in pipelined mode
+cPipelinedHapticDevice* pipelinedDevice = NULL;
+
+// run flag and join of the I/O thread of the pipeline
+cThreadLifecycle ioThreads;
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// exchange loop of the I/O thread in pipelined mode
+void updateDeviceIO(void);
+
+
+//===========================================================================
+
+int main(int argc, char* argv[])
+{
+    //-----------------------------------------------------------------------
+    // INITIALIZATION
+    //-----------------------------------------------------------------------
+
+    // options given by name, removed from the positional arguments
+    bool checkAllocations = false;
+    int numArgs = 1;
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--check-allocations") == 0)
+        {
+            checkAllocations = true;
+            continue;
+        }
+        argv[numArgs++] = argv[i];
+    }
+    argc = numArgs;
+
+    int numTicks  = (argc > 1) ? atoi(argv[1]) : DEFAULT_NUM_TICKS;
+    int numWarmup = (argc > 2) ? atoi(argv[2]) : DEFAULT_NUM_WARMUP;
+    double rate   = (argc > 3) ? atof(argv[3]) : 0.0;
+    const char* replayFilename = ((argc > 4) && (strcmp(argv[4], "-") != 0)) ? argv[4] : NULL;
+    double transportDelay = (argc > 6) ? 1.0e-6 * atof(argv[6]) : 0.0;
+    bool pipelined = (argc > 7) && (strcmp(argv[7], "pipelined") == 0);
+    if ((numTicks <= 0) || (numWarmup < 0) || (rate < 0.0) || (transportDelay < 0.0) ||
+        ((argc > 7) && !pipelined && (strcmp(argv[7], "direct") != 0)) ||
+        (pipelined && (replayFilename != NULL)))
+    {
+        printf("usage: %s [--check-allocations] [ticks] [warmup ticks] [rate] [recording|-] [scene|-] "
+               "[transport delay us] [direct|pipelined]\n", argv[0]);
+        printf("a recording is replayed in direct mode only\n");
+        return (1);
+    }
+
+    // parse first arg to try and locate resources
+    resourceRoot = string(argv[0]).substr(0,string(argv[0]).find_last_of("/\\")+1);
+    string sceneFilename = ((argc > 5) && (strcmp(argv[5], "-") != 0)) ? string(argv[5]) : resourceRoot + "cube.hscn";
+
+    // create a simulated device, scripted or replaying a recording, and
+    // the scene around it
+    cReplayHapticDevice* replayDevice = NULL;
+    cGenericHapticDevice* hapticDevices[1];
+    if (replayFilename != NULL)
+    {
+        replayDevice = new cReplayHapticDevice();
+        if (!replayDevice->load(replayFilename))
+        {
+            printf("cannot read recording %s\n", replayFilename);
+            return (1);
+        }
+        hapticDevices[0] = replayDevice;
+    }
+    else
+    {
+        scriptedDevice = new cScriptedHapticDevice();
+        scriptedDevice->setTransportDelay(transportDelay);
+        hapticDevices[0] = scriptedDevice;
+    }
+    if (pipelined)
+    {
+        pipelinedDevice = new cPipelinedHapticDevice(scriptedDevice);
+        hapticDevices[0] = pipelinedDevice;
+    }
+    if (!createScene(sceneFilename.c_str(), hapticDevices, 1))
+    {
+        return (1);
+    }
+
+
+    //-----------------------------------------------------------------------
+    // RUN BENCHMARK
+    //-----------------------------------------------------------------------
+
+    cLatencyHistogram histogram(numTicks);
+    cLatencyHistogram lateness(numTicks);
+    cLatencyHistogram pipelineLatency(numTicks + numWarmup);
+    cHapticScheduler scheduler(rate);
+    cPrecisionClock clock;
+    clock.start(true);
+
+    // in pipelined mode, the I/O thread exchanges with the device and
+    // steps the script from now on
+    if (pipelinedDevice != NULL)
+    {
+        pipelinedDevice->setLatencyHistogram(&pipelineLatency);
+        ioThreads.start();
+        ioThreads.threadStarting();
+        cThread* ioThread = new cThread();
+        ioThread->set(updateDeviceIO, CHAI_THREAD_PRIORITY_HAPTICS);
+    }
+
+    // every contact configuration of the scripted path grows the buffers
+    // of the collision detection once; see them all before counting
+    if (checkAllocations && (scriptedDevice != NULL))
+    {
+        numWarmup = cMax(numWarmup, (int)ceil(cScriptedHapticDevice::getPeriod() / SCRIPT_TIME_STEP));
+    }
+
+    // warm up caches and collision structures
+    for (int i=0; i<numWarmup; i++)
+    {
+        if ((scriptedDevice != NULL) && (pipelinedDevice == NULL)) { scriptedDevice->step(SCRIPT_TIME_STEP); }
+        updateHapticsTick(0, SCRIPT_TIME_STEP);
+        stepPhysics(SCRIPT_TIME_STEP);
+    }
+
+    // measured ticks
+    scheduler.start();
+    cThreadUsage usageStart;
+    bool hasUsage = getThreadUsage(usageStart);
+    cAllocationCount allocationStart = getAllocationCount();
+    int firstAllocatingTick = -1;
+    double runStart = clock.getCPUTimeSeconds();
+    for (int i=0; i<numTicks; i++)
+    {
+        scheduler.waitForNextTick();
+        lateness.record(scheduler.getLastLateness());
+        if ((scriptedDevice != NULL) && (pipelinedDevice == NULL)) { scriptedDevice->step(SCRIPT_TIME_STEP); }
+
+        // count the heap operations of the tick only, not those of the
+        // measurement or of the physics
+        setAllocationCounting(checkAllocations);
+        double tickStart = clock.getCPUTimeSeconds();
+        updateHapticsTick(0, SCRIPT_TIME_STEP);
+        double tickEnd = clock.getCPUTimeSeconds();
+        setAllocationCounting(false);
+        histogram.record(tickEnd - tickStart);
+
+        cAllocationCount count = getAllocationCount();
+        if ((firstAllocatingTick < 0) &&
+            ((count.m_numAllocations != allocationStart.m_numAllocations) ||
+             (count.m_numDeallocations != allocationStart.m_numDeallocations)))
+        {
+            firstAllocatingTick = i;
+        }
+
+        // the physics runs on its own thread in the application; here it
+        // is stepped in lockstep, outside of the measured time
+        stepPhysics(SCRIPT_TIME_STEP);
+    }
+    double runTime = clock.getCPUTimeSeconds() - runStart;
+    cThreadUsage usageEnd;
+    getThreadUsage(usageEnd);
+
+    // stop the I/O thread before the device is closed
+    if (pipelinedDevice != NULL)
+    {
+        ioThreads.stop();
+        ioThreads.join();
+    }
+
+
+    //-----------------------------------------------------------------------
+    // REPORT
+    //-----------------------------------------------------------------------
+
+    printf("haptic loop benchmark: %d ticks after %d warm-up ticks\n", numTicks, numWarmup);
+    histogram.print(stdout, "tick latency");
+    printf("achieved rate: %.0lf Hz over %.3lf s\n", (double)numTicks / runTime, runTime);
+    if (rate > 0.0)
+    {
+        printf("target rate: %.0lf Hz, overruns: %lu\n", rate, scheduler.getNumOverruns());
+        lateness.print(stdout, "deadline lateness");
+    }
+    if (hasUsage)
+    {
+        printf("page faults: %ld minor, %ld major; context switches: %ld voluntary, %ld involuntary\n",
+               usageEnd.m_minorFaults - usageStart.m_minorFaults,
+               usageEnd.m_majorFaults - usageStart.m_majorFaults,
+               usageEnd.m_voluntarySwitches - usageStart.m_voluntarySwitches,
+               usageEnd.m_involuntarySwitches - usageStart.m_involuntarySwitches);
+    }
+    if (transportDelay > 0.0)
+    {
+        printf("transport delay: %.1lf us per read and per write\n", 1.0e6 * transportDelay);
+    }
+    if (scriptedDevice != NULL)
+    {
+        printf("force commands: %lu\n", scriptedDevice->getNumForceCommands());
+    }
+    if (pipelinedDevice != NULL)
+    {
+        printf("pipelined device I/O: %lu exchanges, %lu repeated forces, %lu ticks reused a position\n",
+               pipelinedDevice->getNumExchanges(), pipelinedDevice->getNumRepeatedCommands(),
+               pipelinedDevice->getNumStaleSamples());
+        pipelineLatency.print(stdout, "position read to force write");
+    }
+    if (replayDevice != NULL)
+    {
+        printf("replayed %lu recorded ticks, largest force deviation: %.6lf N\n",
+               replayDevice->getNumRecords(), replayDevice->getMaxForceDeviation());
+    }
+
+    // heap operations of the measured ticks
+    int result = 0;
+    if (checkAllocations)
+    {
+        cAllocationCount count = getAllocationCount();
+        unsigned long numAllocations = count.m_numAllocations - allocationStart.m_numAllocations;
+        unsigned long numDeallocations = count.m_numDeallocations - allocationStart.m_numDeallocations;
+        if (firstAllocatingTick < 0)
+        {
+            printf("allocation check passed: no heap operation in %d ticks\n", numTicks);
+        }
+        else
+        {
+            printf("allocation check FAILED: %lu allocations (%lu bytes) and %lu deallocations, "
+                   "the first in measured tick %d\n", numAllocations,
+                   (unsigned long)(count.m_numBytes - allocationStart.m_numBytes),
+                   numDeallocations, firstAllocatingTick);
+            result = 2;
+        }
+    }
+
+    #ifdef HAPTICS_STAGE_TIMING
+    // mean and maximum duration of each stage over the measured ticks
+    cStageSummary summary;
+    channels[0].m_stageTimer.computeSummary(numTicks, summary);
+    printf("stage timings over the last %d ticks:\n", summary.m_numTicks);
+    for (int i=0; i<NUM_HAPTIC_STAGES; i++)
+    {
+        printf("  %-18s %8.2lf us avg %8.2lf us max %5.1lf%%\n", cStageTimer::getStageName(i),
+               1.0e6 * summary.m_mean[i], 1.0e6 * summary.m_max[i],
+               (summary.m_meanTotal > 0.0) ? 100.0 * summary.m_mean[i] / summary.m_meanTotal : 0.0);
+    }
+    #endif
+
+    channels[0].m_tool->stop();
+
+    return (result);
+}
+
+//---------------------------------------------------------------------------
+
+void updateDeviceIO(void)
+{
+    // exchange with the device as fast as its transfers allow; the script
+    // advances by one step per exchange, as a hand keeps moving while the
+    // haptics thread computes
+    while (ioThreads.isRunning())
+    {
+        scriptedDevice->step(SCRIPT_TIME_STEP);
+        pipelinedDevice->exchange();
+    }
+
+    // exit I/O thread
+    ioThreads.threadFinished();
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,366 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       HapticsRenderBenchmark.cpp
+
+    \brief
+    Headless benchmark of the rendering of the displayed world. Builds the
+    same scene as the interactive application, without devices, in an
+    offscreen OpenGL context created through EGL, and renders a fixed
+    number of frames at each of a set of resolutions, reporting frame
+    time percentiles.
+
+    usage: HapticsRenderBenchmark [frames] [warmup frames] [scene|-]
+                                  [WxH[,WxH...]]
+
+    Each resolution is measured in every combination of:
+      - camera feedback: none, the synchronous readback of the frame
+        (cCamera::copyImageData, as the original application did) or the
+        copy mode of the application at automatic resolution;
+      - the triangle normals of every mesh shown or hidden.
+
+    A frame is timed from the start of renderView() to the end of
+    glFinish(), feedback included, so the time covers the work of the GL
+    and not only its submission. The scene is static: the haptics and
+    physics threads are not running.
+
+    The context is created on the surfaceless platform of Mesa when it
+    is available, on the default EGL display otherwise, and draws into a
+    pbuffer of the size of each resolution; with Mesa, LIBGL_ALWAYS_SOFTWARE=1
+    measures the software rasterizer.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+// keep EGL from pulling in the X11 headers, whose macros clash with chai3d
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+//---------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+#include "HapticScene.h"
+#include "CLatencyHistogram.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// default number of measured and warm-up frames per configuration
+const int DEFAULT_NUM_FRAMES    = 300;
+const int DEFAULT_NUM_WARMUP    = 30;
+
+// default resolutions
+const char* DEFAULT_RESOLUTIONS = "640x480,1280x720,1920x1080";
+
+// largest number of resolutions measured
+const int MAX_RESOLUTIONS       = 16;
+
+// camera feedback of a configuration
+const int FEEDBACK_NONE         = 0;
+const int FEEDBACK_COPY_IMAGE   = 1;
+const int FEEDBACK_COPY_AUTO    = 2;
+const int NUM_FEEDBACKS         = 3;
+
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// offscreen context and its display
+EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+EGLConfig eglConfig;
+EGLContext eglContext = EGL_NO_CONTEXT;
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// create the offscreen context; returns false if EGL cannot provide one
+bool createContext(void);
+
+// make the context current on a new pbuffer of the given size; returns
+// the surface, or EGL_NO_SURFACE
+EGLSurface createSurface(int a_width, int a_height);
+
+// show or hide the triangle normals of every displayed mesh
+void showNormals(bool a_show);
+
+// render one frame with the given camera feedback, and wait for the GL
+void renderFrame(int a_width, int a_height, int a_feedback);
+
+
+//===========================================================================
+
+int main(int argc, char* argv[])
+{
+    //-----------------------------------------------------------------------
+    // INITIALIZATION
+    //-----------------------------------------------------------------------
+
+    int numFrames = (argc > 1) ? atoi(argv[1]) : DEFAULT_NUM_FRAMES;
+    int numWarmup = (argc > 2) ? atoi(argv[2]) : DEFAULT_NUM_WARMUP;
+    const char* resolutionList = (argc > 4) ? argv[4] : DEFAULT_RESOLUTIONS;
+
+    // resolutions as WxH, separated by commas
+    int widths[MAX_RESOLUTIONS];
+    int heights[MAX_RESOLUTIONS];
+    int numResolutions = 0;
+    bool validResolutions = true;
+    const char* entry = resolutionList;
+    while ((entry != NULL) && (*entry != '\0') && (numResolutions < MAX_RESOLUTIONS))
+    {
+        int width, height;
+        if ((sscanf(entry, "%dx%d", &width, &height) != 2) || (width <= 0) || (height <= 0))
+        {
+            validResolutions = false;
+            break;
+        }
+        widths[numResolutions] = width;
+        heights[numResolutions] = height;
+        numResolutions++;
+
+        entry = strchr(entry, ',');
+        if (entry != NULL) { entry++; }
+    }
+
+    if ((numFrames <= 0) || (numWarmup < 0) || !validResolutions || (numResolutions == 0))
+    {
+        printf("usage: %s [frames] [warmup frames] [scene|-] [WxH[,WxH...]]\n", argv[0]);
+        return (1);
+    }
+
+    // parse first arg to try and locate resources
+    resourceRoot = string(argv[0]).substr(0,string(argv[0]).find_last_of("/\\")+1);
+    string sceneFilename = ((argc > 3) && (strcmp(argv[3], "-") != 0)) ? string(argv[3]) : resourceRoot + "cube.hscn";
+
+    // the context must be current while the scene loads its textures
+    if (!createContext())
+    {
+        return (1);
+    }
+    EGLSurface surface = createSurface(widths[0], heights[0]);
+    if (surface == EGL_NO_SURFACE)
+    {
+        return (1);
+    }
+
+    // the displayed world only; no device is connected
+    cGenericHapticDevice* hapticDevices[1] = { NULL };
+    if (!createScene(sceneFilename.c_str(), hapticDevices, 1))
+    {
+        return (1);
+    }
+
+    printf("render benchmark: %d frames after %d warm-up frames per configuration\n", numFrames, numWarmup);
+    printf("GL renderer: %s, version %s\n", (const char*)glGetString(GL_RENDERER),
+           (const char*)glGetString(GL_VERSION));
+
+    // size of the scene, and the number of objects drawing it
+    int numMeshes = 0, numInstances = 0;
+    for (unsigned int i=0; i<displayMeshes.size(); i++)
+    {
+        if (displayMeshes[i] != NULL) { numMeshes++; }
+    }
+    for (unsigned int i=0; i<displayInstances.size(); i++)
+    {
+        numInstances += displayInstances[i]->getNumInstances();
+    }
+    printf("scene: %d meshes, %d instances in %d batches, %d rails in one batch\n", numMeshes,
+           numInstances, (int)displayInstances.size(), railLines->getNumLines());
+
+
+    //-----------------------------------------------------------------------
+    // RUN BENCHMARK
+    //-----------------------------------------------------------------------
+
+    const char* feedbackNames[NUM_FEEDBACKS] = { "none", "copyImageData", "copy auto" };
+
+    cLatencyHistogram histogram(numFrames);
+    cPrecisionClock clock;
+    clock.start(true);
+
+    printf("%-11s %-14s %-7s %9s %9s %9s %9s %9s\n", "resolution", "feedback", "normals",
+           "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    for (int r=0; r<numResolutions; r++)
+    {
+        int width = widths[r];
+        int height = heights[r];
+
+        // a pbuffer of the size of the frame, as the window would be
+        if (r > 0)
+        {
+            eglDestroySurface(eglDisplay, surface);
+            surface = createSurface(width, height);
+            if (surface == EGL_NO_SURFACE)
+            {
+                return (1);
+            }
+        }
+        glViewport(0, 0, width, height);
+        fitCameraTexture(width, height);
+
+        for (int feedback=0; feedback<NUM_FEEDBACKS; feedback++)
+        {
+            for (int normals=0; normals<2; normals++)
+            {
+                showNormals(normals != 0);
+
+                texture->setFeedbackMode((feedback == FEEDBACK_COPY_IMAGE) ? FEEDBACK_READBACK : FEEDBACK_COPY_TEXTURE);
+                texture->setResolution((feedback == FEEDBACK_COPY_AUTO) ? FEEDBACK_AUTO_RESOLUTION : FEEDBACK_FULL_RESOLUTION);
+
+                for (int i=0; i<numWarmup; i++)
+                {
+                    renderFrame(width, height, feedback);
+                }
+
+                histogram.clear();
+                for (int i=0; i<numFrames; i++)
+                {
+                    double frameStart = clock.getCurrentTimeSeconds();
+                    renderFrame(width, height, feedback);
+                    histogram.record(clock.getCurrentTimeSeconds() - frameStart);
+                }
+
+                char resolution[32];
+                sprintf(resolution, "%dx%d", width, height);
+                printf("%-11s %-14s %-7s %9.3lf %9.3lf %9.3lf %9.3lf %9.3lf\n", resolution,
+                       feedbackNames[feedback], (normals != 0) ? "on" : "off",
+                       1.0e3 * histogram.getTotalSeconds() / (double)histogram.getNumSamples(),
+                       1.0e3 * histogram.getPercentile(50.0), 1.0e3 * histogram.getPercentile(90.0),
+                       1.0e3 * histogram.getPercentile(99.0), 1.0e3 * histogram.getMaxSeconds());
+            }
+        }
+
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR) printf("Error:  %s\n", gluErrorString(err));
+    }
+
+    eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroySurface(eglDisplay, surface);
+    eglDestroyContext(eglDisplay, eglContext);
+    eglTerminate(eglDisplay);
+
+    return (0);
+}
+
+//---------------------------------------------------------------------------
+
+bool createContext(void)
+{
+    // Mesa renders without any window system on its surfaceless platform;
+    // other implementations may still offer pbuffers on their default
+    // display
+    #ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != NULL)
+    {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    #endif
+
+    EGLint major, minor;
+    if ((eglDisplay == EGL_NO_DISPLAY) || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if ((eglDisplay == EGL_NO_DISPLAY) || !eglInitialize(eglDisplay, &major, &minor))
+        {
+            printf("cannot initialize EGL\n");
+            return (false);
+        }
+    }
+
+    // the same buffers as the window of the application
+    const EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE,       EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE,    EGL_OPENGL_BIT,
+        EGL_RED_SIZE,           8,
+        EGL_GREEN_SIZE,         8,
+        EGL_BLUE_SIZE,          8,
+        EGL_DEPTH_SIZE,         16,
+        EGL_NONE
+    };
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &eglConfig, 1, &numConfigs) || (numConfigs == 0))
+    {
+        printf("no EGL configuration with desktop OpenGL and pbuffers\n");
+        return (false);
+    }
+
+    // chai3d uses the fixed pipeline: a compatibility context
+    eglBindAPI(EGL_OPENGL_API);
+    eglContext = eglCreateContext(eglDisplay, eglConfig, EGL_NO_CONTEXT, NULL);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        printf("cannot create an OpenGL context\n");
+        return (false);
+    }
+
+    return (true);
+}
+
+//---------------------------------------------------------------------------
+
+EGLSurface createSurface(int a_width, int a_height)
+{
+    const EGLint surfaceAttributes[] =
+    {
+        EGL_WIDTH,      a_width,
+        EGL_HEIGHT,     a_height,
+        EGL_NONE
+    };
+    EGLSurface surface = eglCreatePbufferSurface(eglDisplay, eglConfig, surfaceAttributes);
+    if ((surface == EGL_NO_SURFACE) || !eglMakeCurrent(eglDisplay, surface, surface, eglContext))
+    {
+        printf("cannot create a %dx%d pbuffer\n", a_width, a_height);
+        return (EGL_NO_SURFACE);
+    }
+    return (surface);
+}
+
+//---------------------------------------------------------------------------
+
+void showNormals(bool a_show)
+{
+    for (unsigned int i=0; i<displayMeshes.size(); i++)
+    {
+        // meshes drawn as instances have no normals to show
+        if (displayMeshes[i] == NULL) { continue; }
+
+        displayMeshes[i]->setShowNormals(a_show);
+        if (a_show)
+        {
+            displayMeshes[i]->setNormalsProperties(0.1, cColorf(0.0, 1.0, 0.0), true);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+
+void renderFrame(int a_width, int a_height, int a_feedback)
+{
+    // render world
+    camera->renderView(a_width, a_height);
+
+    // copy output data to texture, as the application does
+    if (a_feedback != FEEDBACK_NONE)
+    {
+        texture->setDisplayedSize(computeCameraTextureSize(a_height));
+        texture->updateFromFramebuffer(camera, a_width, a_height);
+    }
+
+    // the pbuffer is not swapped; wait for the GL to finish the frame
+    glFinish();
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,386 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       HapticsSceneTool.cpp
+
+    \brief
+    Writes the default scene of the application, the textured cube, the
+    four rails it slides on and the wall keeping the tools in front of the
+    rails, in the binary scene file format.
+
+    usage: HapticsSceneTool [-bvh4] [-grid <n>] [-blocks <n>] [scene file]
+
+    The build runs it to place cube.hscn next to the executables, where
+    the application and the benchmark look for it by default. With -bvh4
+    the tools collide with the cube through cCollisionBVH4. With -grid,
+    a lattice of n x n cells of rails, with a block at each node, stands
+    behind the wall, to load the renderer with thousands of rails and
+    repeated meshes. With -blocks, n blocks spread along the rails can be
+    pushed by the tools and the cube, and push each other.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+#include "CSceneWriter.h"
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// scene file written when no name is given
+const char* DEFAULT_SCENE_FILENAME = "cube.hscn";
+
+// radius of the virtual workspace of the tools; the scene is sized to it
+const double WORKSPACE_RADIUS   = 1.0;
+
+// length of the diagonal of the cube
+const double CUBE_SIZE          = 0.2 * WORKSPACE_RADIUS;
+
+// initial position of the cube
+const double CUBE_POS[3]        = { 0.0, 0.0, -0.5 };
+
+// depth of the plane of the lattice added by -grid, behind the wall
+const double GRID_X             = -0.5 * WORKSPACE_RADIUS;
+
+// largest number of cells of the lattice on a side
+const int GRID_MAX_CELLS        = 256;
+
+// length of the diagonal of the blocks added by -blocks
+const double BLOCK_SIZE         = 0.2 * CUBE_SIZE;
+
+// rails the cube slides on: two vertical ones, two horizontal ones, the
+// lower horizontal rail running through the initial position of the cube
+const double RAILS[4][2][3]     =
+{
+    { { 0,  0.5,                     1                      }, { 0,  0.5,                    -1                      } },
+    { { 0, -0.8 * WORKSPACE_RADIUS,  1                      }, { 0, -0.8 * WORKSPACE_RADIUS, -1                      } },
+    { { 0, -1,                       0.8 * WORKSPACE_RADIUS }, { 0,  1,                       0.8 * WORKSPACE_RADIUS } },
+    { { 0, -1,                      -0.5                    }, { 0,  1,                      -0.5                    } },
+};
+
+
+//===========================================================================
+/*
+    Adds a cube of diagonal a_size at a_pos: four vertices per face so that
+    each face has its own normal and maps the whole camera image. Returns
+    the index of the mesh.
+*/
+//===========================================================================
+
+static int addBox(cSceneWriter& a_writer, unsigned int a_flags, double a_size,
+                  const double a_pos[3], const cSceneMaterial& a_material)
+{
+    const double identity[9] = { 1, 0, 0,  0, 1, 0,  0, 0, 1 };
+    int mesh = a_writer.addMesh(a_flags, a_pos, identity, a_material);
+
+    // corners of each face, counterclockwise seen from outside, followed
+    // by the outward normal of the face
+    const double h = 0.5 * a_size / sqrt(3.0);
+    const double faces[6][5][3] =
+    {
+        // face -x
+        { {-h,  h, -h}, {-h, -h, -h}, {-h, -h,  h}, {-h,  h,  h}, {-1,  0,  0} },
+        // face +x
+        { { h, -h, -h}, { h,  h, -h}, { h,  h,  h}, { h, -h,  h}, { 1,  0,  0} },
+        // face -y
+        { {-h, -h, -h}, { h, -h, -h}, { h, -h,  h}, {-h, -h,  h}, { 0, -1,  0} },
+        // face +y
+        { { h,  h, -h}, {-h,  h, -h}, {-h,  h,  h}, { h,  h,  h}, { 0,  1,  0} },
+        // face -z
+        { {-h, -h, -h}, {-h,  h, -h}, { h,  h, -h}, { h, -h, -h}, { 0,  0, -1} },
+        // face +z
+        { { h, -h,  h}, { h,  h,  h}, {-h,  h,  h}, {-h, -h,  h}, { 0,  0,  1} },
+    };
+
+    // the corners of a face map to the corners of the camera image
+    const double texCoords[4][2] = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+
+    for (int i=0; i<6; i++)
+    {
+        const double* normal = faces[i][4];
+        unsigned int first = 0;
+        for (int j=0; j<4; j++)
+        {
+            const double* corner = faces[i][j];
+            unsigned int index = a_writer.addVertex(corner[0], corner[1], corner[2],
+                                                    normal[0], normal[1], normal[2],
+                                                    texCoords[j][0], texCoords[j][1]);
+            if (j == 0) { first = index; }
+        }
+        a_writer.addTriangle(first, first + 1, first + 2);
+        a_writer.addTriangle(first, first + 2, first + 3);
+    }
+
+    return (mesh);
+}
+
+
+//===========================================================================
+/*
+    Adds the cube, light gray and as stiff as each device allows.
+    a_extraFlags are added to the flags of the cube.
+*/
+//===========================================================================
+
+static void addCube(cSceneWriter& a_writer, unsigned int a_extraFlags)
+{
+    cSceneMaterial material;
+    const float ambient[4]  = { 0.5f, 0.5f, 0.5f, 1.0f };
+    const float diffuse[4]  = { 0.7f, 0.7f, 0.7f, 1.0f };
+    const float specular[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const float emission[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    for (int i=0; i<4; i++)
+    {
+        material.m_ambient[i] = ambient[i];
+        material.m_diffuse[i] = diffuse[i];
+        material.m_specular[i] = specular[i];
+        material.m_emission[i] = emission[i];
+    }
+    material.m_shininess = 64.0f;
+    material.m_stiffness = 1.0f;
+    material.m_staticFriction = 0.2f;
+    material.m_dynamicFriction = 0.5f;
+
+    addBox(a_writer, SCENE_MESH_HAPTIC | SCENE_MESH_ON_RAILS |
+           SCENE_MESH_CAMERA_TEXTURE | SCENE_MESH_SHOW_NORMALS | a_extraFlags,
+           CUBE_SIZE, CUBE_POS, material);
+}
+
+
+//===========================================================================
+/*
+    Adds the rails of the cube.
+*/
+//===========================================================================
+
+static void addRails(cSceneWriter& a_writer)
+{
+    for (int i=0; i<4; i++)
+    {
+        a_writer.addRail(RAILS[i][0], RAILS[i][1]);
+    }
+}
+
+
+//===========================================================================
+/*
+    Adds a_numBlocks blocks evenly spaced along the rails of the cube,
+    leaving out those that would overlap the cube, every block being a copy
+    of the first. Returns the number of blocks added, or -1 if they do not
+    fit on the rails.
+*/
+//===========================================================================
+
+static int addBlocks(cSceneWriter& a_writer, int a_numBlocks)
+{
+    // orange, as stiff as the cube
+    cSceneMaterial material;
+    const float ambient[4]  = { 0.5f, 0.3f, 0.1f, 1.0f };
+    const float diffuse[4]  = { 0.9f, 0.5f, 0.1f, 1.0f };
+    const float specular[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const float emission[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    for (int i=0; i<4; i++)
+    {
+        material.m_ambient[i] = ambient[i];
+        material.m_diffuse[i] = diffuse[i];
+        material.m_specular[i] = specular[i];
+        material.m_emission[i] = emission[i];
+    }
+    material.m_shininess = 64.0f;
+    material.m_stiffness = 1.0f;
+    material.m_staticFriction = 0.0f;
+    material.m_dynamicFriction = 0.0f;
+
+    double lengths[4];
+    double totalLength = 0.0;
+    for (int i=0; i<4; i++)
+    {
+        double d[3];
+        for (int k=0; k<3; k++) { d[k] = RAILS[i][1][k] - RAILS[i][0][k]; }
+        lengths[i] = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+        totalLength += lengths[i];
+    }
+
+    // leave a quarter of their side between two blocks
+    double spacing = totalLength / a_numBlocks;
+    if (spacing < 1.25 * BLOCK_SIZE / sqrt(3.0)) { return (-1); }
+
+    const double identity[9] = { 1, 0, 0,  0, 1, 0,  0, 0, 1 };
+    int block = -1;
+    int numAdded = 0;
+    for (int n=0; n<a_numBlocks; n++)
+    {
+        // rail and point at the curvilinear abscissa of the block
+        double s = (n + 0.5) * spacing;
+        int rail = 0;
+        while ((rail < 3) && (s > lengths[rail]))
+        {
+            s -= lengths[rail];
+            rail++;
+        }
+        double t = (s < lengths[rail]) ? s / lengths[rail] : 1.0;
+        double pos[3];
+        double distance = 0.0;
+        for (int k=0; k<3; k++)
+        {
+            pos[k] = RAILS[rail][0][k] + t * (RAILS[rail][1][k] - RAILS[rail][0][k]);
+            distance += (pos[k] - CUBE_POS[k]) * (pos[k] - CUBE_POS[k]);
+        }
+        if (sqrt(distance) < CUBE_SIZE + BLOCK_SIZE) { continue; }
+
+        if (block < 0)
+        {
+            block = addBox(a_writer, SCENE_MESH_BLOCK, BLOCK_SIZE, pos, material);
+        }
+        else
+        {
+            a_writer.addInstance(block, SCENE_MESH_BLOCK, pos, identity);
+        }
+        numAdded++;
+    }
+
+    return (numAdded);
+}
+
+
+//===========================================================================
+/*
+    Adds a lattice of a_numCells x a_numCells cells in the plane x = GRID_X,
+    across the workspace: one rail per side of each cell, and a block at
+    each node, every block being a copy of the first.
+*/
+//===========================================================================
+
+static void addGrid(cSceneWriter& a_writer, int a_numCells)
+{
+    const double w = WORKSPACE_RADIUS;
+    const double spacing = 2.0 * w / a_numCells;
+
+    // bluish gray, seen but never touched
+    cSceneMaterial material;
+    const float ambient[4]  = { 0.3f, 0.3f, 0.4f, 1.0f };
+    const float diffuse[4]  = { 0.4f, 0.4f, 0.6f, 1.0f };
+    const float specular[4] = { 0.5f, 0.5f, 0.5f, 1.0f };
+    const float emission[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    for (int i=0; i<4; i++)
+    {
+        material.m_ambient[i] = ambient[i];
+        material.m_diffuse[i] = diffuse[i];
+        material.m_specular[i] = specular[i];
+        material.m_emission[i] = emission[i];
+    }
+    material.m_shininess = 32.0f;
+    material.m_stiffness = 0.0f;
+    material.m_staticFriction = 0.0f;
+    material.m_dynamicFriction = 0.0f;
+
+    const double identity[9] = { 1, 0, 0,  0, 1, 0,  0, 0, 1 };
+    int block = -1;
+    for (int i=0; i<=a_numCells; i++)
+    {
+        for (int j=0; j<=a_numCells; j++)
+        {
+            // the node, and the rails to the next nodes along y and z
+            const double node[3]  = { GRID_X, -w + i * spacing, -w + j * spacing };
+            const double nextY[3] = { GRID_X, node[1] + spacing, node[2] };
+            const double nextZ[3] = { GRID_X, node[1], node[2] + spacing };
+            if (i < a_numCells) { a_writer.addRail(node, nextY); }
+            if (j < a_numCells) { a_writer.addRail(node, nextZ); }
+
+            if (block < 0)
+            {
+                block = addBox(a_writer, 0, 0.5 * spacing, node, material);
+            }
+            else
+            {
+                a_writer.addInstance(block, 0, node, identity);
+            }
+        }
+    }
+}
+
+
+//===========================================================================
+/*
+    Adds the force fields: a wall pushing the tools out of the x < 0
+    half-space, behind the rails.
+*/
+//===========================================================================
+
+static void addForceFields(cSceneWriter& a_writer)
+{
+    const double normal[3] = { 1, 0, 0 };
+    const double unused[3] = { 0, 0, 0 };
+    a_writer.addForceField(SCENE_FIELD_PLANE, normal, unused, 0.0, 50.0);
+}
+
+
+//===========================================================================
+
+int main(int argc, char* argv[])
+{
+    const char* filename = DEFAULT_SCENE_FILENAME;
+    unsigned int cubeFlags = 0;
+    int gridCells = 0;
+    int numBlocks = 0;
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-bvh4") == 0) { cubeFlags |= SCENE_MESH_BVH4; }
+        else if ((strcmp(argv[i], "-grid") == 0) && (i+1 < argc))
+        {
+            gridCells = atoi(argv[++i]);
+            if ((gridCells < 1) || (gridCells > GRID_MAX_CELLS))
+            {
+                printf("the grid has 1 to %d cells on a side\n", GRID_MAX_CELLS);
+                return (1);
+            }
+        }
+        else if ((strcmp(argv[i], "-blocks") == 0) && (i+1 < argc))
+        {
+            numBlocks = atoi(argv[++i]);
+            if (numBlocks < 1)
+            {
+                printf("-blocks takes a positive number of blocks\n");
+                return (1);
+            }
+        }
+        else { filename = argv[i]; }
+    }
+
+    cSceneWriter writer;
+    addCube(writer, cubeFlags);
+    addRails(writer);
+    if (numBlocks > 0)
+    {
+        int numAdded = addBlocks(writer, numBlocks);
+        if (numAdded < 0)
+        {
+            printf("%d blocks do not fit on the rails\n", numBlocks);
+            return (1);
+        }
+        printf("%d blocks on the rails\n", numAdded);
+    }
+    if (gridCells > 0)
+    {
+        addGrid(writer, gridCells);
+    }
+    addForceFields(writer);
+
+    if (!writer.write(filename))
+    {
+        printf("cannot write scene %s\n", filename);
+        return (1);
+    }
+
+    printf("scene written to %s\n", filename);
+    return (0);
+}
+
+//---------------------------------------------------------------------------
@@ -26,16 +26,56 @@
 #include <string.h>
 //---------------------------------------------------------------------------
 #include "chai3d.h"
+#include "HapticScene.h"
+#include "CHapticScheduler.h"
+#include "Realtime.h"
+#include "CRecordingHapticDevice.h"
+#include "CReplayHapticDevice.h"
+#include "CPipelinedHapticDevice.h"
+#include "CFramePacer.h"
+#include "CThreadLifecycle.h"
+#include "CHapticWatchdog.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 //---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
 // DECLARED CONSTANTS
 //---------------------------------------------------------------------------
 
+// rate of the object physics thread [Hz]
+const double PHYSICS_RATE       = 250.0;
+
+// default frame rate limit of the graphics loop [Hz]
+const double DEFAULT_FRAME_RATE = 60.0;
+
+// default update rate of the camera feedback texture [Hz]
+const double DEFAULT_FEEDBACK_RATE = 30.0;
+
+// period of the watchdog looking for stalled haptic ticks [s]
+const double WATCHDOG_PERIOD    = 0.0005;
+
+// SCHED_FIFO priority of the haptics threads in real-time mode (-t)
+const int REALTIME_PRIORITY     = 80;
+
+// heap kept resident for the allocations made after the memory is
+// locked in real-time mode [bytes]
+const size_t REALTIME_HEAP_RESERVE = 16 * 1024 * 1024;
+
 // initial size (width/height) in pixels of the display window
 const int WINDOW_SIZE_W         = 512;
 const int WINDOW_SIZE_H         = 512;
 
+// number of haptic ticks a device recording has room for (10 minutes at
+// 1 kHz, about 50 MB)
+const unsigned long RECORDING_CAPACITY = 600000;
+
+#ifdef HAPTICS_STAGE_TIMING
+// number of recent haptic ticks summarized in the stage overlay
+const int STAGE_OVERLAY_TICKS   = 1000;
+#endif
+
 // mouse menu options (right button)
 const int OPTION_FULLSCREEN     = 1;
 const int OPTION_WINDOWDISPLAY  = 2;
@@ -45,18 +85,6 @@ const int OPTION_WINDOWDISPLAY  = 2;
 // DECLARED VARIABLES
 //---------------------------------------------------------------------------
 
-// a world that contains all objects of the virtual environment
-cWorld* world;
-
-// a camera that renders the world in a window display
-cCamera* camera;
-
-// a light source to illuminate the objects in the virtual scene
-cLight *light;
-
-// a little "chai3d" bitmap logo at the bottom of the screen
-cBitmap* logo;
-
 // width and height of the current window display
 int displayW  = 0;
 int displayH  = 0;
@@ -64,50 +92,56 @@ int displayH  = 0;
 // a haptic device handler
 cHapticDeviceHandler* handler;
 
-// a virtual tool representing the haptic device in the scene
-cGeneric3dofPointer* tool;
+// run flag and join of the haptics, I/O, physics and watchdog threads
+cThreadLifecycle simulation;
 
-// radius of the tool proxy
-double proxyRadius;
+// stops the force of a device whose haptic tick stalls
+cHapticWatchdog watchdog;
 
-// a virtual object
-cMesh* object;
+// pace the haptics loop of each device; free-run unless a rate is requested
+cHapticScheduler schedulers[MAX_DEVICES];
 
-// a list of vertices for each face of the cube
-int vertices[6][4];
+// labels to show the haptic loop rate and timing of each device
+cLabel* rateLabels[MAX_DEVICES];
 
-// a texture
-cTexture2D* texture;
+// paces the frames of the graphics loop
+cFramePacer framePacer(DEFAULT_FRAME_RATE);
 
-// rotational velocity of the object
-cVector3d rotVel(0.0, 0.0, 0.0);
+// true while a frame timer is armed
+bool frameTimerPending = false;
 
-// status of the main simulation haptics loop
-bool simulationRunning = false;
+// label to show the frame rate of the graphics loop
+cLabel* frameLabel;
 
-// simulation clock
-cPrecisionClock simClock;
+#ifdef HAPTICS_STAGE_TIMING
+// labels to show the duration of each stage of the haptic tick, and of the tick
+cLabel* stageLabels[NUM_HAPTIC_STAGES+1];
 
-// root resource path
-string resourceRoot;
+// file receiving the stage durations on exit
+const char* stageFilename = "haptic_stages.csv";
+#endif
 
-// has exited haptics simulation thread
-bool simulationFinished = false;
+// core of the first haptics thread in real-time mode (-t), -1 otherwise
+int realtimeCore = -1;
 
-std::vector <cShapeLine *> horizontalLines;
-std::vector <cShapeLine *> verticalLines;
+// next channel to be claimed by a starting haptics thread
+std::atomic<int> nextHapticsChannel(0);
 
-//---------------------------------------------------------------------------
-// DECLARED MACROS
-//---------------------------------------------------------------------------
-// convert to resource path
-#define RESOURCE_PATH(p)    (char*)((resourceRoot+string(p)).c_str())
+// pipeline of each device, whose transfers run on an I/O thread; NULL
+// for a device driven by its haptics thread (-d)
+cPipelinedHapticDevice* pipelinedDevices[MAX_DEVICES];
+
+// next channel to be claimed by a starting I/O thread
+std::atomic<int> nextIOChannel(0);
 
 
 //---------------------------------------------------------------------------
 // DECLARED FUNCTIONS
 //---------------------------------------------------------------------------
 
+// a_base with _<a_index> inserted before its extension, for a_index > 0
+string indexedFilename(const char* a_base, int a_index);
+
 // callback when the window display is resized
 void resizeWindow(int w, int h);
 
@@ -123,9 +157,27 @@ void close(void);
 // main graphics callback
 void updateGraphics(void);
 
+// arm the frame timer for the next deadline of the frame pacer
+void scheduleFrame(void);
+
+// callback of the frame timer: render a frame if one is needed
+void frameTimer(int a_value);
+
 // main haptics loop
 void updateHaptics(void);
 
+// device I/O loop of a pipelined device
+void updateDeviceIO(void);
+
+// object physics loop
+void updatePhysics(void);
+
+// watchdog loop looking for stalled haptic ticks
+void updateWatchdog(void);
+
+// watchdog handler bringing the force of a device to zero
+void stopDeviceForce(int a_channel);
+
 
 //===========================================================================
 /*
@@ -154,81 +206,127 @@ int main(int argc, char* argv[])
     printf ("-----------------------------------\n");
     printf ("\n\n");
     printf ("Keyboard Options:\n\n");
+    printf ("[1] - Run haptics loop at 1 kHz\n");
+    printf ("[2] - Run haptics loop at 2 kHz\n");
+    printf ("[4] - Run haptics loop at 4 kHz\n");
+    printf ("[8] - Run haptics loop at 8 kHz\n");
+    printf ("[0] - Run haptics loop as fast as possible\n");
+    printf ("[f] - Cycle camera feedback mode (copy / async readback / readback)\n");
+    printf ("[c] - Toggle rendering only when the scene changes\n");
+    printf ("[e] - Toggle camera feedback resolution (automatic / full)\n");
     printf ("[x] - Exit application\n");
+    printf ("\n");
+    printf ("Command line options:\n\n");
+    printf ("-r <Hz>   - Rate of the haptics loop\n");
+    printf ("-f <mode> - Camera feedback mode: copy, async or readback\n");
+    printf ("-e <size> - Camera feedback resolution in pixels, auto (default) or 0 for full\n");
+    printf ("-u <Hz>   - Camera feedback update rate (default 30, 0 for every frame)\n");
+    printf ("-w <file> - Record the session of each device into a binary log\n");
+    printf ("-p <file> - Replay a recorded session instead of the devices\n");
+    printf ("-l <file> - Load the scene from a scene file (default cube.hscn)\n");
+    printf ("-d        - Exchange with each device on its haptics thread, without an I/O thread;\n");
+    printf ("            the watchdog then cannot stop the force of a stalled device\n");
+    printf ("-g <Hz>   - Frame rate limit of the graphics (default 60, 0 for none)\n");
+    printf ("-c        - Render only when the scene changes\n");
+    printf ("-t <core> - Real-time mode: haptics threads pinned from <core> on, SCHED_FIFO, memory locked\n");
+    #ifdef HAPTICS_STAGE_TIMING
+    printf ("\nStage timings of the last ticks are written to %s on exit (-s <file>)\n", stageFilename);
+    #endif
     printf ("\n\n");
 
-    // parse first arg to try and locate resources
-    resourceRoot = string(argv[0]).substr(0,string(argv[0]).find_last_of("/\\")+1);
-
-
-    //-----------------------------------------------------------------------
-    // 3D - SCENEGRAPH
-    //-----------------------------------------------------------------------
+    // parse options
+    const char* feedbackModeOption = "copy";
+    int feedbackResolution = FEEDBACK_AUTO_RESOLUTION;
+    double feedbackRate = DEFAULT_FEEDBACK_RATE;
+    const char* recordFilename = NULL;
+    const char* replayFilename = NULL;
+    const char* sceneFilename = NULL;
+    bool pipelineIO = true;
+    for (int i=1; i<argc; i++)
+    {
+        // haptics loop rate in Hz (0 to free-run)
+        if ((strcmp(argv[i], "-r") == 0) && (i+1 < argc))
+        {
+            double rate = atof(argv[++i]);
+            for (int j=0; j<MAX_DEVICES; j++)
+            {
+                schedulers[j].setRate(rate);
+            }
+        }
 
-    // create a new world.
-    world = new cWorld();
+        // camera feedback mode: "copy", "async" or "readback"
+        if ((strcmp(argv[i], "-f") == 0) && (i+1 < argc))
+        {
+            feedbackModeOption = argv[++i];
+        }
 
-    // set the background color of the environment
-    // the color is defined by its (R,G,B) components.
-    world->setBackgroundColor(1.0, 0.0, 0.0);
+        // camera feedback resolution: pixels, "auto" or 0 for full
+        if ((strcmp(argv[i], "-e") == 0) && (i+1 < argc))
+        {
+            i++;
+            feedbackResolution = (strcmp(argv[i], "auto") == 0) ? FEEDBACK_AUTO_RESOLUTION : atoi(argv[i]);
+        }
 
-    // create a camera and insert it into the virtual world
-    camera = new cCamera(world);
-    world->addChild(camera);
+        // camera feedback update rate in Hz (0 for every frame)
+        if ((strcmp(argv[i], "-u") == 0) && (i+1 < argc))
+        {
+            feedbackRate = atof(argv[++i]);
+        }
 
-    // position and oriente the camera
-    camera->set( cVector3d (3.0, 0.0, 0.0),    // camera position (eye)
-                 cVector3d (0.0, 0.0, 0.0),    // lookat position (target)
-                 cVector3d (0.0, 0.0, 1.0));   // direction of the "up" vector
+        // file receiving the recording of each device
+        if ((strcmp(argv[i], "-w") == 0) && (i+1 < argc))
+        {
+            recordFilename = argv[++i];
+        }
 
-    // set the near and far clipping planes of the camera
-    // anything in front/behind these clipping planes will not be rendered
-    camera->setClippingPlanes(0.01, 10.0);
+        // recording replayed instead of the devices
+        if ((strcmp(argv[i], "-p") == 0) && (i+1 < argc))
+        {
+            replayFilename = argv[++i];
+        }
 
-    // create a light source and attach it to the camera
-    light = new cLight(world);
-    camera->addChild(light);                   // attach light to camera
-    light->setEnabled(true);                   // enable light source
-    light->setPos(cVector3d( 2.0, 0.5, 1.0));  // position the light source
-    light->setDir(cVector3d(-2.0, 0.5, 1.0));  // define the direction of the light beam
+        // scene file loaded instead of the default scene
+        if ((strcmp(argv[i], "-l") == 0) && (i+1 < argc))
+        {
+            sceneFilename = argv[++i];
+        }
 
+        // frame rate limit of the graphics in Hz (0 for none)
+        if ((strcmp(argv[i], "-g") == 0) && (i+1 < argc))
+        {
+            framePacer.setRate(atof(argv[++i]));
+        }
 
-    //-----------------------------------------------------------------------
-    // 2D - WIDGETS
-    //-----------------------------------------------------------------------
+        // render only the frames where the poses or the window changed
+        if (strcmp(argv[i], "-c") == 0)
+        {
+            framePacer.setRenderOnChange(true);
+        }
 
-    // create a 2D bitmap logo
-    logo = new cBitmap();
+        // real-time mode, with the first haptics thread on the given core
+        if ((strcmp(argv[i], "-t") == 0) && (i+1 < argc))
+        {
+            realtimeCore = atoi(argv[++i]);
+        }
 
-    // add logo to the front plane
-    camera->m_front_2Dscene.addChild(logo);
+        // transfers with the devices on the haptics threads instead of
+        // I/O threads overlapping their computation
+        if (strcmp(argv[i], "-d") == 0)
+        {
+            pipelineIO = false;
+        }
 
-    // load a "chai3d" bitmap image file
-    bool fileload;
-    fileload = logo->m_image.loadFromFile(RESOURCE_PATH("resources/images/chai3d-w.bmp"));
-    if (!fileload)
-    {
-        #if defined(_MSVC)
-        fileload = logo->m_image.loadFromFile("../../../bin/resources/images/chai3d-w.bmp");
+        #ifdef HAPTICS_STAGE_TIMING
+        // file receiving the stage durations on exit
+        if ((strcmp(argv[i], "-s") == 0) && (i+1 < argc))
+        {
+            stageFilename = argv[++i];
+        }
         #endif
     }
 
-    // position the logo at the bottom left of the screen (pixel coordinates)
-    logo->setPos(10, 10, 0);
-
-    // scale the logo along its horizontal and vertical axis
-    logo->setZoomHV(0.25, 0.25);
-
-    // here we replace all wite pixels (1,1,1) of the logo bitmap
-    // with transparent black pixels (1, 1, 1, 0). This allows us to make
-    // the background of the logo look transparent.
-    logo->m_image.replace(
-                          cColorb(0xff, 0xff, 0xff),         // original RGB color
-                          cColorb(0xff, 0xff, 0xff, 0x00)    // new RGBA color
-                          );
-
-    // enable transparency
-    logo->enableTransparency(true);
+    // parse first arg to try and locate resources
+    resourceRoot = string(argv[0]).substr(0,string(argv[0]).find_last_of("/\\")+1);
 
 
     //-----------------------------------------------------------------------
@@ -238,170 +336,126 @@ int main(int argc, char* argv[])
     // create a haptic device handler
     handler = new cHapticDeviceHandler();
 
-    // get access to the first available haptic device
-    cGenericHapticDevice* hapticDevice;
-    handler->getDevice(hapticDevice, 0);
-
-    // retrieve information about the current haptic device
-    cHapticDeviceInfo info;
-    if (hapticDevice)
+    // get access to every available haptic device; when there is none,
+    // the scene is built with a single channel and no device
+    cGenericHapticDevice* hapticDevices[MAX_DEVICES];
+    int numDevices = cMin((int)handler->getNumDevices(), MAX_DEVICES);
+    for (int i=0; i<numDevices; i++)
+    {
+        handler->getDevice(hapticDevices[i], i);
+    }
+    if (numDevices == 0)
     {
-        info = hapticDevice->getSpecifications();
+        hapticDevices[0] = NULL;
+        numDevices = 1;
     }
 
-    // create a 3D tool and add it to the world
-    tool = new cGeneric3dofPointer(world);
-    world->addChild(tool);
+    // replay a recorded session instead of the devices
+    if (replayFilename != NULL)
+    {
+        cReplayHapticDevice* replayDevice = new cReplayHapticDevice();
+        if (!replayDevice->load(replayFilename))
+        {
+            printf("cannot read recording %s\n", replayFilename);
+            return (1);
+        }
+        printf("replaying %lu ticks from %s\n", replayDevice->getNumRecords(), replayFilename);
+        hapticDevices[0] = replayDevice;
+        numDevices = 1;
+    }
 
-    // connect the haptic device to the tool
-    tool->setHapticDevice(hapticDevice);
+    // record every tick of each device; the log is finished when the
+    // tool stops the device on exit
+    if (recordFilename != NULL)
+    {
+        for (int i=0; i<numDevices; i++)
+        {
+            if (hapticDevices[i] == NULL) { continue; }
 
-    // initialize tool by connecting to haptic device
-    tool->start();
+            string filename = indexedFilename(recordFilename, i);
+            cRecordingHapticDevice* recorder = new cRecordingHapticDevice(hapticDevices[i]);
+            if (recorder->createLog(filename.c_str(), RECORDING_CAPACITY))
+            {
+                printf("recording device %d into %s\n", i, filename.c_str());
+                hapticDevices[i] = recorder;
+            }
+            else
+            {
+                printf("cannot create recording %s\n", filename.c_str());
+                delete recorder;
+            }
+        }
+    }
 
-    // map the physical workspace of the haptic device to a larger virtual workspace.
-    tool->setWorkspaceRadius(1.0);
+    // move the transfers with each device to an I/O thread of its own,
+    // which also gives the watchdog a way to stop the force without
+    // touching the device; wrapped last so that a recording is made on the
+    // I/O thread, of what the device actually exchanged
+    for (int i=0; i<numDevices; i++)
+    {
+        pipelinedDevices[i] = NULL;
+        if (pipelineIO && (hapticDevices[i] != NULL))
+        {
+            pipelinedDevices[i] = new cPipelinedHapticDevice(hapticDevices[i]);
+            hapticDevices[i] = pipelinedDevices[i];
+        }
+    }
 
-    // define a radius for the tool (graphical display)
-    tool->setRadius(0.05);
+    printf("haptic devices: %d\n", numDevices);
 
-    // hide the device sphere. only show proxy.
-    tool->m_deviceSphere->setShowEnabled(false);
 
-    // set the physical readius of the proxy.
-    proxyRadius = 0.05;
-    tool->m_proxyPointForceModel->setProxyRadius(proxyRadius);
-    tool->m_proxyPointForceModel->m_collisionSettings.m_checkBothSidesOfTriangles = false;
+    //-----------------------------------------------------------------------
+    // COMPOSE THE VIRTUAL SCENE
+    //-----------------------------------------------------------------------
 
-    // enable if objects in the scene are going to rotate of translate
-    // or possibly collide against the tool. If the environment
-    // is entirely static, you can set this parameter to "false"
-    tool->m_proxyPointForceModel->m_useDynamicProxy = true;
+    // create the worlds and the tools, and load the cube and the rails
+    string scenePath = (sceneFilename != NULL) ? string(sceneFilename) : resourceRoot + "cube.hscn";
+    if (!createScene(scenePath.c_str(), hapticDevices, numDevices))
+    {
+        return (1);
+    }
 
-    // read the scale factor between the physical workspace of the haptic
-    // device and the virtual workspace defined for the tool
-    double workspaceScaleFactor = tool->getWorkspaceScaleFactor();
+    // select how the camera image reaches the cube texture
+    if (strcmp(feedbackModeOption, "async") == 0)
+    {
+        texture->setFeedbackMode(FEEDBACK_ASYNC_READBACK);
+    }
+    else if (strcmp(feedbackModeOption, "readback") == 0)
+    {
+        texture->setFeedbackMode(FEEDBACK_READBACK);
+    }
+    else
+    {
+        texture->setFeedbackMode(FEEDBACK_COPY_TEXTURE);
+    }
 
-    // define a maximum stiffness that can be handled by the current
-    // haptic device. The value is scaled to take into account the
-    // workspace scale factor
-    double stiffnessMax = info.m_maxForceStiffness / workspaceScaleFactor;
+    // feed the texture at the size the cube shows it, at its own rate
+    texture->setResolution(feedbackResolution);
+    texture->setUpdateRate(feedbackRate);
 
+    // create one label per device that shows its haptic loop update rate
+    for (int i=0; i<numChannels; i++)
+    {
+        rateLabels[i] = new cLabel();
+        rateLabels[i]->setPos(8, 24 + 16 * (numChannels - 1 - i), 0);
+        camera->m_front_2Dscene.addChild(rateLabels[i]);
+    }
 
-    //-----------------------------------------------------------------------
-    // COMPOSE THE VIRTUAL SCENE
-    //-----------------------------------------------------------------------
+    // create a label that shows the frame rate of the graphics, above the
+    // haptic rates
+    frameLabel = new cLabel();
+    frameLabel->setPos(8, 24 + 16 * numChannels, 0);
+    camera->m_front_2Dscene.addChild(frameLabel);
 
-    // create a virtual mesh
-    object = new cMesh(world);
-
-    // add object to world
-    world->addChild(object);
-
-    // set the position of the object at the center of the world
-    object->setPos(0.0, 0.0, -0.5);
-
-
-    /////////////////////////////////////////////////////////////////////////
-    // create a cube
-    /////////////////////////////////////////////////////////////////////////
-    const double HALFSIZE = 0.01;
-
-    // face -x
-    vertices[0][0] = object->newVertex(-HALFSIZE,  HALFSIZE, -HALFSIZE);
-    vertices[0][1] = object->newVertex(-HALFSIZE, -HALFSIZE, -HALFSIZE);
-    vertices[0][2] = object->newVertex(-HALFSIZE, -HALFSIZE,  HALFSIZE);
-    vertices[0][3] = object->newVertex(-HALFSIZE,  HALFSIZE,  HALFSIZE);
-
-    // face +x
-    vertices[1][0] = object->newVertex( HALFSIZE, -HALFSIZE, -HALFSIZE);
-    vertices[1][1] = object->newVertex( HALFSIZE,  HALFSIZE, -HALFSIZE);
-    vertices[1][2] = object->newVertex( HALFSIZE,  HALFSIZE,  HALFSIZE);
-    vertices[1][3] = object->newVertex( HALFSIZE, -HALFSIZE,  HALFSIZE);
-
-    // face -y
-    vertices[2][0] = object->newVertex(-HALFSIZE,  -HALFSIZE, -HALFSIZE);
-    vertices[2][1] = object->newVertex( HALFSIZE,  -HALFSIZE, -HALFSIZE);
-    vertices[2][2] = object->newVertex( HALFSIZE,  -HALFSIZE,  HALFSIZE);
-    vertices[2][3] = object->newVertex(-HALFSIZE,  -HALFSIZE,  HALFSIZE);
-
-    // face +y
-    vertices[3][0] = object->newVertex( HALFSIZE,   HALFSIZE, -HALFSIZE);
-    vertices[3][1] = object->newVertex(-HALFSIZE,   HALFSIZE, -HALFSIZE);
-    vertices[3][2] = object->newVertex(-HALFSIZE,   HALFSIZE,  HALFSIZE);
-    vertices[3][3] = object->newVertex( HALFSIZE,   HALFSIZE,  HALFSIZE);
-
-    // face -z
-    vertices[4][0] = object->newVertex(-HALFSIZE,  -HALFSIZE, -HALFSIZE);
-    vertices[4][1] = object->newVertex(-HALFSIZE,   HALFSIZE, -HALFSIZE);
-    vertices[4][2] = object->newVertex( HALFSIZE,   HALFSIZE, -HALFSIZE);
-    vertices[4][3] = object->newVertex( HALFSIZE,  -HALFSIZE, -HALFSIZE);
-
-    // face +z
-    vertices[5][0] = object->newVertex( HALFSIZE,  -HALFSIZE,  HALFSIZE);
-    vertices[5][1] = object->newVertex( HALFSIZE,   HALFSIZE,  HALFSIZE);
-    vertices[5][2] = object->newVertex(-HALFSIZE,   HALFSIZE,  HALFSIZE);
-    vertices[5][3] = object->newVertex(-HALFSIZE,  -HALFSIZE,  HALFSIZE);
-
-    // create triangles
-    for (int i=0; i<6; i++)
-    {
-        object->newTriangle(vertices[i][0], vertices[i][1], vertices[i][2]);
-        object->newTriangle(vertices[i][0], vertices[i][2], vertices[i][3]);
-    }
-
-    // create a texture
-    texture = new cTexture2D();
-    object->setTexture(texture);
-    object->setUseTexture(true);
-
-    // set material properties to light gray
-    object->m_material.m_ambient.set(0.5f, 0.5f, 0.5f, 1.0f);
-    object->m_material.m_diffuse.set(0.7f, 0.7f, 0.7f, 1.0f);
-    object->m_material.m_specular.set(1.0f, 1.0f, 1.0f, 1.0f);
-    object->m_material.m_emission.set(0.0f, 0.0f, 0.0f, 1.0f);
-
-    // compute normals
-    object->computeAllNormals();
-
-    // display triangle normals
-    object->setShowNormals(true);
-
-    // set length and color of normals
-    object->setNormalsProperties(0.1, cColorf(0.0, 1.0, 0.0), true);
-
-    // compute a boundary box
-    object->computeBoundaryBox(true);
-
-    // get dimensions of object
-    double size = cSub(object->getBoundaryMax(), object->getBoundaryMin()).length();
-    
-    // resize object to screen
-    object->scale( 0.2 * tool->getWorkspaceRadius() / size);
-
-
-    // compute collision detection algorithm
-    object->createAABBCollisionDetector(1.01 * proxyRadius, true, false);
-
-    // define a default stiffness for the object
-    object->setStiffness(stiffnessMax, true);
-
-    // define friction properties
-    object->setFriction(0.2, 0.5, true);
-    double workspace = tool->getWorkspaceRadius();
-    cShapeLine *rightLine = new cShapeLine(cVector3d(0, 0.5, 1),cVector3d(0, 0.5, -1));
-    cShapeLine *leftLine = new cShapeLine(cVector3d(0, -0.8 * workspace, 1),cVector3d(0, -0.8 * workspace, -1));
-    cShapeLine *topLine = new cShapeLine(cVector3d(0, -1, 0.8 * workspace),cVector3d(0, 1, 0.8 * workspace));
-    cShapeLine *bottomLine = new cShapeLine(cVector3d(0, -1, -0.5),cVector3d(0, 1, -0.5));
-    world->addChild(rightLine);
-    world->addChild(leftLine);
-    world->addChild(topLine);
-    world->addChild(bottomLine);
-    
-    verticalLines.push_back(rightLine);
-    verticalLines.push_back(leftLine);
-    horizontalLines.push_back(bottomLine);
-    horizontalLines.push_back(topLine);
+    #ifdef HAPTICS_STAGE_TIMING
+    // create one label per stage of the haptic tick, above the rate
+    for (int i=0; i<=NUM_HAPTIC_STAGES; i++)
+    {
+        stageLabels[i] = new cLabel();
+        stageLabels[i]->setPos(8, 28 + 16 * (numChannels + 1 + NUM_HAPTIC_STAGES - i), 0);
+        camera->m_front_2Dscene.addChild(stageLabels[i]);
+    }
+    #endif
 
 
     //-----------------------------------------------------------------------
@@ -439,12 +493,53 @@ int main(int argc, char* argv[])
     // START SIMULATION
     //-----------------------------------------------------------------------
 
+    // in real-time mode, keep the whole process resident: the scene and
+    // the collision trees the haptics threads walk are built by now
+    if (realtimeCore >= 0)
+    {
+        if (lockMemory(REALTIME_HEAP_RESERVE))
+        {
+            printf("real-time mode: memory locked\n");
+        }
+        else
+        {
+            printf("real-time mode: cannot lock memory (CAP_IPC_LOCK or RLIMIT_MEMLOCK)\n");
+        }
+    }
+
     // simulation in now running
-    simulationRunning = true;
+    simulation.start();
+
+    // create one I/O thread per pipelined device, exchanging with the
+    // device while the haptics threads compute
+    for (int i=0; i<numChannels; i++)
+    {
+        if (pipelinedDevices[i] == NULL) { continue; }
+        simulation.threadStarting();
+        cThread* ioThread = new cThread();
+        ioThread->set(updateDeviceIO, CHAI_THREAD_PRIORITY_HAPTICS);
+    }
 
-    // create a thread which starts the main haptics rendering loop
-    cThread* hapticsThread = new cThread();
-    hapticsThread->set(updateHaptics, CHAI_THREAD_PRIORITY_HAPTICS);
+    // create one thread per device which starts its haptics rendering loop
+    for (int i=0; i<numChannels; i++)
+    {
+        simulation.threadStarting();
+        cThread* hapticsThread = new cThread();
+        hapticsThread->set(updateHaptics, CHAI_THREAD_PRIORITY_HAPTICS);
+    }
+
+    // create a thread which runs the physics of the object at its own rate
+    simulation.threadStarting();
+    cThread* physicsThread = new cThread();
+    physicsThread->set(updatePhysics, CHAI_THREAD_PRIORITY_GRAPHICS);
+
+    // create a thread which stops the force of a device whose haptic tick
+    // stalls; it runs at the priority of the haptics threads so that a
+    // busy haptics thread does not starve it
+    watchdog.setHandler(stopDeviceForce);
+    simulation.threadStarting();
+    cThread* watchdogThread = new cThread();
+    watchdogThread->set(updateWatchdog, CHAI_THREAD_PRIORITY_HAPTICS);
 
     // start the main graphics rendering loop
     glutMainLoop();
@@ -458,6 +553,26 @@ int main(int argc, char* argv[])
 
 //---------------------------------------------------------------------------
 
+string indexedFilename(const char* a_base, int a_index)
+{
+    string filename = a_base;
+    if (a_index > 0)
+    {
+        char suffix[16];
+        sprintf(suffix, "_%d", a_index);
+        size_t dot = filename.find_last_of('.');
+        size_t slash = filename.find_last_of("/\\");
+        if ((dot == string::npos) || ((slash != string::npos) && (dot < slash)))
+        {
+            dot = filename.size();
+        }
+        filename.insert(dot, suffix);
+    }
+    return (filename);
+}
+
+//---------------------------------------------------------------------------
+
 void resizeWindow(int w, int h)
 {
     // update the size of the viewport
@@ -466,32 +581,10 @@ void resizeWindow(int w, int h)
     glViewport(0, 0, displayW, displayH);
 
     // update texture coordinates
-    double txMin, txMax, tyMin, tyMax;
-    if (displayW >= displayH)
-    {
-        double ratio = (double)displayW / (double)displayH;
-        txMin = 0.5 * (ratio - 1.0) / ratio;
-        txMax = 1.0 - txMin;
-        tyMin = 0.0;
-        tyMax = 1.0;
-    }
-    else
-    {
-        double ratio = (double)displayH / (double)displayW;
-        txMin = 0.0;
-        txMax = 1.0;
-        tyMin = 0.5 * (ratio - 1.0) / ratio;
-        tyMax = 1.0 - tyMin;
-    }
+    fitCameraTexture(displayW, displayH);
 
-    // update texture coordinates
-    for (int i=0; i<6; i++)
-    {
-        object->getVertex(vertices[i][0])->setTexCoord(txMin, tyMin);
-        object->getVertex(vertices[i][1])->setTexCoord(txMax, tyMin);
-        object->getVertex(vertices[i][2])->setTexCoord(txMax, tyMax);
-        object->getVertex(vertices[i][3])->setTexCoord(txMin, tyMax);
-    }
+    // the next frame shows the new window
+    framePacer.invalidate();
 }
 
 //---------------------------------------------------------------------------
@@ -507,6 +600,67 @@ void keySelect(unsigned char key, int x, int y)
         // exit application
         exit(0);
     }
+
+    // haptics loop rate
+    double rate = -1.0;
+    if (key == '0') { rate = 0.0; }
+    if (key == '1') { rate = 1000.0; }
+    if (key == '2') { rate = 2000.0; }
+    if (key == '4') { rate = 4000.0; }
+    if (key == '8') { rate = 8000.0; }
+    if (rate >= 0.0)
+    {
+        for (int i=0; i<numChannels; i++)
+        {
+            schedulers[i].setRate(rate);
+        }
+    }
+
+    // camera feedback mode
+    if (key == 'f')
+    {
+        switch (texture->getFeedbackMode())
+        {
+            case FEEDBACK_COPY_TEXTURE:
+                texture->setFeedbackMode(FEEDBACK_ASYNC_READBACK);
+                printf("camera feedback: asynchronous readback\n");
+                break;
+
+            case FEEDBACK_ASYNC_READBACK:
+                texture->setFeedbackMode(FEEDBACK_READBACK);
+                printf("camera feedback: synchronous readback\n");
+                break;
+
+            case FEEDBACK_READBACK:
+                texture->setFeedbackMode(FEEDBACK_COPY_TEXTURE);
+                printf("camera feedback: copy to texture\n");
+                break;
+        }
+        framePacer.invalidate();
+    }
+
+    // camera feedback resolution
+    if (key == 'e')
+    {
+        if (texture->getResolution() == FEEDBACK_FULL_RESOLUTION)
+        {
+            texture->setResolution(FEEDBACK_AUTO_RESOLUTION);
+            printf("camera feedback resolution: automatic\n");
+        }
+        else
+        {
+            texture->setResolution(FEEDBACK_FULL_RESOLUTION);
+            printf("camera feedback resolution: full\n");
+        }
+        framePacer.invalidate();
+    }
+
+    // render-on-change mode
+    if (key == 'c')
+    {
+        framePacer.setRenderOnChange(!framePacer.getRenderOnChange());
+        printf("render on change: %s\n", framePacer.getRenderOnChange() ? "on" : "off");
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -525,32 +679,116 @@ void menuSelect(int value)
             glutReshapeWindow(WINDOW_SIZE_W, WINDOW_SIZE_H);
             break;
     }
+
+    // the menu covered part of the window
+    framePacer.invalidate();
 }
 
 //---------------------------------------------------------------------------
 
 void close(void)
 {
-    // stop the simulation
-    simulationRunning = false;
+    // stop the simulation; only the first call closes everything
+    if (!simulation.stop()) { return; }
+
+    // wait for the haptics, I/O, physics and watchdog loops to terminate
+    simulation.join();
 
-    // wait for graphics and haptics loops to terminate
-    while (!simulationFinished) { cSleepMs(100); }
+    // close haptic devices
+    for (int i=0; i<numChannels; i++)
+    {
+        channels[i].m_tool->stop();
+    }
 
-    // close haptic device
-    tool->stop();
+    // report the haptic ticks the watchdog found stalled
+    for (int i=0; i<numChannels; i++)
+    {
+        if (watchdog.getNumStalls(i) > 0)
+        {
+            printf("device %d: force stopped by the watchdog %lu times\n", i, watchdog.getNumStalls(i));
+        }
+    }
+
+    // report how the pipelined devices exchanged with the haptics threads
+    for (int i=0; i<numChannels; i++)
+    {
+        cPipelinedHapticDevice* device = pipelinedDevices[i];
+        if (device == NULL) { continue; }
+        printf("device %d I/O: %lu exchanges, %lu repeated forces, %lu ticks reused a position, "
+               "position read to force write %.1lf us avg %.1lf us max\n",
+               i, device->getNumExchanges(), device->getNumRepeatedCommands(),
+               device->getNumStaleSamples(), 1.0e6 * device->getMeanLatency(),
+               1.0e6 * device->getMaxLatency());
+    }
+
+    #ifdef HAPTICS_STAGE_TIMING
+    // dump the durations of the last haptic ticks of each device; devices
+    // after the first get their index appended to the file name
+    for (int i=0; i<numChannels; i++)
+    {
+        string filename = indexedFilename(stageFilename, i);
+        if (channels[i].m_stageTimer.writeCSV(filename.c_str()))
+        {
+            printf("haptic stage timings written to %s\n", filename.c_str());
+        }
+    }
+    #endif
 }
 
 //---------------------------------------------------------------------------
 
 void updateGraphics(void)
 {
+    // update the displayed objects with any haptic poses published since
+    // the frame timer looked; GLUT also calls this when the window needs
+    // to be redrawn
+    updateDisplayPoses();
+
+    // update the labels with the haptic refresh rate and timing
+    char buffer[256];
+    for (int i=0; i<numChannels; i++)
+    {
+        cSchedulerStats stats = schedulers[i].readStats();
+        sprintf(buffer, "device %d haptic rate: %.0lf Hz (target %.0lf)  overruns: %lu  late: %.0lf us avg, %.0lf us max"
+                "  faults: %.0lf/s  switches: %.0lf/s  preempted: %.0lf/s  stalls: %lu",
+                i, stats.m_rate, stats.m_targetRate, stats.m_numOverruns,
+                1.0e6 * stats.m_meanLateness, 1.0e6 * stats.m_maxLateness,
+                stats.m_pageFaultRate, stats.m_switchRate, stats.m_preemptionRate,
+                watchdog.getNumStalls(i));
+        rateLabels[i]->m_string = buffer;
+    }
+
+    // update the label with the frame rate of the graphics
+    char limit[32];
+    if (framePacer.getRate() > 0.0) { sprintf(limit, "%.0lf Hz", framePacer.getRate()); }
+    else { sprintf(limit, "none"); }
+    sprintf(buffer, "graphics: %.0lf fps (limit %s)  render on change: %s  skipped: %lu  feedback: %dx%d",
+            framePacer.getFrameRate(), limit, framePacer.getRenderOnChange() ? "on" : "off",
+            framePacer.getNumSkipped(), texture->getImageWidth(), texture->getImageHeight());
+    frameLabel->m_string = buffer;
+
+    #ifdef HAPTICS_STAGE_TIMING
+    // update the labels with the duration of each stage of the haptic tick
+    // of the first device
+    cStageSummary summary;
+    channels[0].m_stageTimer.computeSummary(STAGE_OVERLAY_TICKS, summary);
+    for (int i=0; i<NUM_HAPTIC_STAGES; i++)
+    {
+        sprintf(buffer, "%s: %.1lf us avg, %.1lf us max", cStageTimer::getStageName(i),
+                1.0e6 * summary.m_mean[i], 1.0e6 * summary.m_max[i]);
+        stageLabels[i]->m_string = buffer;
+    }
+    sprintf(buffer, "haptic tick: %.1lf us avg, %.1lf us max (last %d ticks)",
+            1.0e6 * summary.m_meanTotal, 1.0e6 * summary.m_maxTotal, summary.m_numTicks);
+    stageLabels[NUM_HAPTIC_STAGES]->m_string = buffer;
+    #endif
+
     // render world
     camera->renderView(displayW, displayH);
 
-    // copy output data to texture
-    camera->copyImageData(&texture->m_image);
-    texture->markForUpdate();
+    // copy output data to texture, at the resolution the cube shows it
+    texture->setDisplayedSize(computeCameraTextureSize(displayH));
+    texture->updateFromFramebuffer(camera, displayW, displayH);
 
     // Swap buffers
     glutSwapBuffers();
@@ -560,146 +798,182 @@ void updateGraphics(void)
     err = glGetError();
     if (err != GL_NO_ERROR) printf("Error:  %s\n", gluErrorString(err));
 
-    // inform the GLUT window to call updateGraphics again (next frame)
-    if (simulationRunning)
+    // ask for the next frame at the next deadline of the frame pacer,
+    // which is later than now only when the swap did not wait for the
+    // display already
+    framePacer.frameRendered();
+    if (simulation.isRunning())
+    {
+        scheduleFrame();
+    }
+}
+
+//---------------------------------------------------------------------------
+
+void scheduleFrame(void)
+{
+    // a redraw requested by GLUT while a timer is armed must not start a
+    // second chain of timers
+    if (frameTimerPending) { return; }
+
+    frameTimerPending = true;
+    glutTimerFunc((unsigned int)(1000.0 * framePacer.getDelay() + 0.5), frameTimer, 0);
+}
+
+//---------------------------------------------------------------------------
+
+void frameTimer(int a_value)
+{
+    frameTimerPending = false;
+    if (!simulation.isRunning()) { return; }
+
+    // render if the haptic poses changed, or whenever a frame is due
+    // outside of render-on-change mode; otherwise look again later
+    bool changed = updateDisplayPoses();
+    if (framePacer.needFrame(changed))
     {
         glutPostRedisplay();
     }
+    else
+    {
+        scheduleFrame();
+    }
 }
 
 //---------------------------------------------------------------------------
 
 void updateHaptics(void)
 {
-    // reset clock
-    simClock.reset();
+    // claim the next channel; every haptics thread runs this same function
+    int index = nextHapticsChannel++;
+    cHapticScheduler& scheduler = schedulers[index];
+
+    // keep each device on a core of its own, counting down from the last
+    // one so that the first cores stay free for graphics and physics
+    int core = getNumCores() - 1 - index;
+    if (core > 0)
+    {
+        pinCurrentThread(core);
+    }
 
-    // main haptic simulation loop
-    while(simulationRunning)
-    {
-        // compute global reference frames for each object
-        world->computeGlobalPositions(true);
-
-        // update position and orientation of tool
-        tool->updatePose();
-
-        // compute interaction forces
-        tool->computeInteractionForces();
-
-        // send forces to device
-        tool->applyForces();
-
-        // stop the simulation clock
-        simClock.stop();
-
-        // read the time increment in seconds
-        double timeInterval = simClock.getCurrentTimeSeconds();
-
-        // restart the simulation clock
-        simClock.reset();
-        simClock.start();
-	//	new cShapeLine(cVector3d(0, 0.8 * workspace, 1),cVector3d(0, 0.8 * workspace, -1));
-	double workspace = tool->getWorkspaceRadius();
-	cVector3d toolPos = tool->m_deviceGlobalPos;
-	cVector3d force = cVector3d(0,0,0);
-	if (toolPos.x < 0.0) {
-	  force.x = -50 * toolPos.x;
-	}
-	tool->getHapticDevice()->setForce(force);
-        // temp variable to compute rotational acceleration
-        cVector3d rotAcc(0,0,0);
-
-        // check if tool is touching an object
-        cGenericObject* objectContact = tool->m_proxyPointForceModel->m_contactPoint0->m_object;
-        if (objectContact != NULL)
+    // in real-time mode the devices use the cores from the chosen one on,
+    // at a priority no other user thread preempts, with a stack that is
+    // already mapped
+    if (realtimeCore >= 0)
+    {
+        core = realtimeCore + index;
+        if (!pinCurrentThread(core))
+        {
+            printf("real-time mode: cannot pin device %d to core %d\n", index, core);
+        }
+        if (!setRealtimePriority(REALTIME_PRIORITY))
         {
-            // retrieve the root of the object mesh
-            cGenericObject* obj = objectContact->getSuperParent();
+            printf("real-time mode: cannot raise the priority of device %d (CAP_SYS_NICE or RLIMIT_RTPRIO)\n", index);
+        }
+        prefaultStack();
+    }
 
-            // get position of cursor in global coordinates
-            cVector3d toolPos = tool->m_deviceGlobalPos;
+    // start ticking on deadlines
+    scheduler.start();
 
-            // get position of object in global coordinates
-            cVector3d objectPos = obj->getGlobalPos();
+    // main haptic simulation loop
+    while(simulation.isRunning())
+    {
+        // wait for the next deadline and read the time increment in seconds
+        double timeInterval = scheduler.waitForNextTick();
+
+        // compute and render forces, then move the object, under the eye
+        // of the watchdog
+        watchdog.tickStarted(index);
+        updateHapticsTick(index, timeInterval);
+        watchdog.tickFinished(index);
+    }
 
-            // compute a vector from the center of mass of the object (point of rotation) to the tool
-            cVector3d vObjectCMToTool = cSub(toolPos, objectPos);
+    // exit haptics thread
+    simulation.threadFinished();
+}
 
-            // compute acceleration based on the interaction forces
-            // between the tool and the object
-            if (vObjectCMToTool.length() > 0.0)
-            {
-                // get the last force applied to the cursor in global coordinates
-                // we negate the result to obtain the opposite force that is applied on the
-                // object
-                cVector3d toolForce = cNegate(tool->m_lastComputedGlobalForce);
+//---------------------------------------------------------------------------
 
-                // compute effective force to take into account the fact the object
-                // can only rotate around a its center mass and not translate
-                //cVector3d effectiveForce = toolForce - cProject(toolForce, vObjectCMToTool);
+void updateDeviceIO(void)
+{
+    // claim the next pipelined device, in the order the threads were
+    // started
+    int index = nextIOChannel++;
+    while (pipelinedDevices[index] == NULL) { index = nextIOChannel++; }
+    cPipelinedHapticDevice* device = pipelinedDevices[index];
+
+    // real devices block on each transfer; simulated ones are paced at
+    // the rate of the haptics loop
+    cHapticScheduler ioScheduler(schedulers[index].getRate());
+    ioScheduler.start();
+
+    while(simulation.isRunning())
+    {
+        ioScheduler.waitForNextTick();
+        device->exchange();
+    }
 
-                // compute the resulting torque
-                //cVector3d torque =  0.5;//cMul(vObjectCMToTool.length(), cCross( cNormalize(vObjectCMToTool), effectiveForce));
+    // exit I/O thread
+    simulation.threadFinished();
+}
 
-                // update rotational acceleration
-                const double OBJECT_INERTIA = 0.4;
-                rotAcc = (1.0 / OBJECT_INERTIA) * toolForce;
-            }
-	    double newZ = objectPos.z;
-	    double newY = objectPos.y;
-
-	    for(int i = 0; i < verticalLines.size(); i++) {
-	      double point = verticalLines[i]->m_pointA.y;
-	    if(objectPos.y < point + 0.01 &&
-			      objectPos.y > point - 0.01) {
-	      newZ = objectPos.z + rotAcc.z * timeInterval;
-	      }
-	      
-	    }
-	    for(int i = 0; i < horizontalLines.size(); i++) {
-	      double point = horizontalLines[i]->m_pointA.z;
-	      if(objectPos.z < point + 0.01 &&
-			      objectPos.z > point - 0.01) {
-	        newY = objectPos.y + rotAcc.y * timeInterval;
-	      }
-	      
-	    }
-	    cVector3d newPos(objectPos.x, newY, newZ);
-	    
-	    object->setPos(newPos);
-        }
+//---------------------------------------------------------------------------
 
-        // update rotational velocity
-        //rotVel.add(timeInterval * rotAcc);
+void updatePhysics(void)
+{
+    // the physics of the object and of the blocks ticks at a fixed rate
+    // and integrates with a fixed step, independently of the haptics loop
+    cHapticScheduler physicsScheduler(PHYSICS_RATE);
+    physicsScheduler.start();
 
-        // set a threshold on the rotational velocity term
-        const double ROT_VEL_MAX = 10.0;
-        double velMag = rotVel.length();
-        if (velMag > ROT_VEL_MAX)
-        {
-            rotVel.mul(ROT_VEL_MAX / velMag);
-        }
+    while(simulation.isRunning())
+    {
+        double timeInterval = physicsScheduler.waitForNextTick();
+        stepPhysics(timeInterval);
+    }
 
-        // add some damping too
-        const double DAMPING_GAIN = 0.1;
-        rotVel.mul(1.0 - DAMPING_GAIN * timeInterval);
+    // exit physics thread
+    simulation.threadFinished();
+}
 
-        // if user switch is pressed, set velocity to zero
-        if (tool->getUserSwitch(0) == 1)
-        {
-            rotVel.zero();
-        }
+//---------------------------------------------------------------------------
 
-        // compute the next rotation configuration of the object
-        if (rotVel.length() > CHAI_SMALL)
-        {
-	  // object->setPos(obj->getGlobalPos().add(rotVel));
-	  //   object->rotate(cNormalize(rotVel), timeInterval * rotVel.length());
-        }
+void updateWatchdog(void)
+{
+    // a tick is found stalled at most one period after its timeout; the
+    // watchdog sleeps rather than spins, as it has nothing to pace
+    std::chrono::microseconds period((long long)(1.0e6 * WATCHDOG_PERIOD));
+
+    while(simulation.isRunning())
+    {
+        std::this_thread::sleep_for(period);
+        watchdog.check();
+    }
+
+    // exit watchdog thread
+    simulation.threadFinished();
+}
+
+//---------------------------------------------------------------------------
+
+void stopDeviceForce(int a_channel)
+{
+    // called from the watchdog thread while the haptics thread of the
+    // channel is stuck in its tick. the haptics thread restarts the force
+    // softly when it comes back; flagged first, so that it never sends a
+    // force computed before the stall once the hold below is released
+    channels[a_channel].m_forceStopped = true;
+
+    // a pipelined device is stopped by its I/O thread, which keeps writing
+    // zero until the haptics thread computes from a fresh position again.
+    // a device driven directly (-d) belongs to the stuck haptics thread,
+    // and neither its driver nor a recorder wrapping it can take a write
+    // from this thread: its force stays as it is until the tick ends
+    if (pipelinedDevices[a_channel] != NULL)
+    {
+        pipelinedDevices[a_channel]->holdZeroForce();
     }
-    
-    // exit haptics thread
-    simulationFinished = true;
 }
 
 //---------------------------------------------------------------------------
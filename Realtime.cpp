@@ -0,0 +1,193 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       Realtime.cpp
+
+    \brief
+    Platform helpers to place the simulation threads on the processor,
+    run them at a real-time priority and keep their memory resident.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include "Realtime.h"
+//---------------------------------------------------------------------------
+#include <thread>
+//---------------------------------------------------------------------------
+#if defined(_MSVC)
+#include <windows.h>
+#elif defined(_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <malloc.h>
+#endif
+#include <stdlib.h>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// stride used to touch memory; no supported platform has smaller pages
+const size_t REALTIME_PAGE_STRIDE = 4096;
+
+
+//===========================================================================
+/*
+    Number of logical processors reported by the system.
+*/
+//===========================================================================
+
+int getNumCores(void)
+{
+    int numCores = (int)std::thread::hardware_concurrency();
+    return ((numCores > 0) ? numCores : 1);
+}
+
+
+//===========================================================================
+/*
+    Restrict the calling thread to one logical processor, so that it keeps
+    its caches and is not migrated behind another busy thread. Mac OS X
+    only offers affinity hints between threads, so nothing is done there.
+*/
+//===========================================================================
+
+bool pinCurrentThread(int a_core)
+{
+    if ((a_core < 0) || (a_core >= getNumCores())) { return (false); }
+
+    #if defined(_MSVC)
+    DWORD_PTR mask = ((DWORD_PTR)1) << a_core;
+    return (SetThreadAffinityMask(GetCurrentThread(), mask) != 0);
+
+    #elif defined(_LINUX)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(a_core, &cpus);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0);
+
+    #else
+    return (false);
+    #endif
+}
+
+
+//===========================================================================
+/*
+    Run the calling thread at a real-time priority. On Linux the thread
+    becomes SCHED_FIFO: it only yields to threads of higher priority, so
+    a loop that never sleeps (a free-running haptics loop) should stay on
+    a core of its own. This needs CAP_SYS_NICE or a sufficient RLIMIT_RTPRIO.
+*/
+//===========================================================================
+
+bool setRealtimePriority(int a_priority)
+{
+    #if defined(_MSVC)
+    return (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0);
+
+    #elif defined(_LINUX)
+    int minPriority = sched_get_priority_min(SCHED_FIFO);
+    int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    struct sched_param param;
+    param.sched_priority = (a_priority < minPriority) ? minPriority :
+                           (a_priority > maxPriority) ? maxPriority : a_priority;
+    return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0);
+
+    #else
+    return (false);
+    #endif
+}
+
+
+//===========================================================================
+/*
+    Lock the pages of the process in memory. The heap is first grown by a
+    reserve whose pages are touched, and the allocator is told never to
+    give memory back or to serve large blocks with fresh mappings, so the
+    allocations made after the lock reuse resident pages. Needs
+    CAP_IPC_LOCK or a sufficient RLIMIT_MEMLOCK.
+*/
+//===========================================================================
+
+bool lockMemory(size_t a_heapReserve)
+{
+    #if defined(_LINUX)
+    #if defined(__GLIBC__)
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    #endif
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) { return (false); }
+
+    // fault the reserve in, then hand it back to the allocator, which
+    // keeps it
+    if (a_heapReserve > 0)
+    {
+        volatile char* reserve = (volatile char*)malloc(a_heapReserve);
+        if (reserve != NULL)
+        {
+            for (size_t i=0; i<a_heapReserve; i+=REALTIME_PAGE_STRIDE)
+            {
+                reserve[i] = 0;
+            }
+            free((void*)reserve);
+        }
+    }
+    return (true);
+
+    #else
+    return (false);
+    #endif
+}
+
+
+//===========================================================================
+/*
+    Touch the stack of the calling thread below the current frame.
+*/
+//===========================================================================
+
+void prefaultStack(void)
+{
+    volatile char stack[REALTIME_STACK_PREFAULT];
+    for (size_t i=0; i<REALTIME_STACK_PREFAULT; i+=REALTIME_PAGE_STRIDE)
+    {
+        stack[i] = 0;
+    }
+
+    // read it back so that the array is not only set
+    (void)stack[0];
+}
+
+
+//===========================================================================
+/*
+    Resource usage of the calling thread, from getrusage() on Linux.
+*/
+//===========================================================================
+
+bool getThreadUsage(cThreadUsage& a_usage)
+{
+    #if defined(_LINUX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) { return (false); }
+
+    a_usage.m_minorFaults = usage.ru_minflt;
+    a_usage.m_majorFaults = usage.ru_majflt;
+    a_usage.m_voluntarySwitches = usage.ru_nvcsw;
+    a_usage.m_involuntarySwitches = usage.ru_nivcsw;
+    return (true);
+
+    #else
+    a_usage.m_minorFaults = 0;
+    a_usage.m_majorFaults = 0;
+    a_usage.m_voluntarySwitches = 0;
+    a_usage.m_involuntarySwitches = 0;
+    return (false);
+    #endif
+}
@@ -0,0 +1,78 @@
+//===========================================================================
+/*
+    Haptics - cube on rails
+
+    \file       Realtime.h
+
+    \brief
+    Platform helpers to place the simulation threads on the processor,
+    run them at a real-time priority and keep their memory resident.
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#ifndef RealtimeH
+#define RealtimeH
+//---------------------------------------------------------------------------
+#include <stddef.h>
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// bytes of stack touched by prefaultStack()
+const size_t REALTIME_STACK_PREFAULT = 256 * 1024;
+
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// resource usage of the calling thread since it started
+struct cThreadUsage
+{
+    // page faults served without and with I/O
+    long m_minorFaults;
+    long m_majorFaults;
+
+    // context switches where the thread gave up the processor (waiting or
+    // sleeping), and where it was preempted
+    long m_voluntarySwitches;
+    long m_involuntarySwitches;
+};
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// number of logical processors, at least 1
+int getNumCores(void);
+
+// restrict the calling thread to one logical processor; returns false if
+// the platform does not support it or the processor does not exist
+bool pinCurrentThread(int a_core);
+
+// run the calling thread at a real-time priority (SCHED_FIFO on Linux,
+// 1 to 99; time critical on Windows); returns false if the platform does
+// not support it or the process is not allowed to
+bool setRealtimePriority(int a_priority);
+
+// keep every page of the process in memory, now and in the future, after
+// growing the heap by a_heapReserve bytes that later allocations reuse
+// without faulting; returns false if the platform does not support it or
+// the limit on locked memory is too low
+bool lockMemory(size_t a_heapReserve);
+
+// touch REALTIME_STACK_PREFAULT bytes of the stack of the calling thread,
+// so that its loop does not fault when its calls go deeper
+void prefaultStack(void);
+
+// read the resource usage of the calling thread; returns false if the
+// platform does not report it
+bool getThreadUsage(cThreadUsage& a_usage);
+
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------